@@ -0,0 +1,732 @@
+/**
+ * @file bench.c
+ * @brief Microbenchmarks of the window library and of the quotes index.
+ * Every benchmark reports the time per operation and, for the ones drawing a frame,
+ * the bytes and the write syscalls emitted per frame.
+ * Frames go to the null sink, which discards them and has the fallback size,
+ * so only the cost of the layout is measured.
+ * Run with -m to get tab separated values instead of a table,
+ * with -r FILE to record a reference scene through the recording sink, for golden diffs,
+ * with -k to check the reading of escape sequences split across reads.
+ */
+
+#define _DEFAULT_SOURCE // for mkdtemp()
+
+#include <fcntl.h> // for fcntl()
+#include <stdio.h>
+#include <stdlib.h> // for mkdtemp()
+#include <string.h> // for memset()
+#include <time.h>   // for clock_gettime()
+#include <unistd.h> // for rmdir()
+
+#include "terminal.h"
+#include "quotes.h"
+#include "timers.h"
+#include "schedule.h"
+
+static const double BENCH_DURATION = 0.2; // minimum duration of a benchmark, seconds
+static const int BENCH_QUOTES = 1000;     // number of quotes in the generated file
+
+// private functions of terminal.c
+int _windowLinesWrap(Window *w);
+void _windowDrawBorder(Window *w);
+
+/**
+ * @brief Struct containing the result of a benchmark.
+ * 
+ */
+typedef struct
+{
+  double ns_per_op;        /**<  time per operation, nanoseconds */
+  double bytes_per_frame;  /**<  bytes emitted per frame, -1 if no frame is drawn */
+  double writes_per_frame; /**<  write syscalls per frame, -1 if no frame is drawn */
+} Result;
+
+/**
+ * @brief Struct containing the state of a benchmark.
+ * 
+ */
+typedef struct
+{
+  Window *window;     /**<  window being drawn */
+  Dialog *dialog;     /**<  dialog being drawn */
+  Bar *bar;           /**<  progress bar being drawn */
+  Layout *layout;     /**<  layout tree being solved */
+  Timers *timers;     /**<  deadlines being scheduled */
+  Schedule *schedule; /**<  cycle being queried */
+  QuoteIndex *quotes; /**<  quotes index */
+  char *text;         /**<  text of the window */
+  int frame;          /**<  does the operation flush a frame? */
+  int iteration;      /**<  current iteration */
+} Bench;
+
+typedef void (*Operation)(Bench *b);
+
+double now_ns();
+Result run_bench(Operation op, Bench *b);
+void report(FILE *out, int machine, char *name, char *param, Result r);
+void make_text(char *buffer, int len, int multilingual);
+Window *make_window(int width, char *text);
+char *make_quotes_file(char *dir);
+int record_scene(char *path);
+int feed_input(int fd, char *bytes, int expected_event, char expected_key);
+int check_input();
+
+void op_window_show(Bench *b);
+void op_window_show_changing(Bench *b);
+void op_window_show_colors(Bench *b);
+void op_lines_wrap(Bench *b);
+void op_layout_cached(Bench *b);
+void op_draw_border(Bench *b);
+void op_dialog_show(Bench *b);
+void op_hsl_to_rgb(Bench *b);
+void op_hue_to_rgb_fast(Bench *b);
+void op_bar_show(Bench *b);
+void op_place_quote(Bench *b);
+void op_layout_solve_cached(Bench *b);
+void op_layout_solve(Bench *b);
+void op_timers_schedule(Bench *b);
+void op_schedule_at(Bench *b);
+void op_schedule_until(Bench *b);
+
+int main(int argc, char *argv[]);
+
+/**
+ * @brief Returns the time of a monotonic clock, in nanoseconds.
+ * 
+ * @return double
+ */
+double now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Runs an operation, doubling the iterations until the benchmark lasts long enough.
+ * 
+ * @param op operation to run
+ * @param b pointer to benchmark state
+ * @return Result
+ */
+Result run_bench(Operation op, Bench *b)
+{
+  Result r;
+  long long iterations, bytes, writes;
+  double start, elapsed;
+
+  // warm up, the first frame is always a full redraw
+  b->iteration = 0;
+  op(b);
+
+  for (iterations = 16;; iterations *= 2)
+  {
+    bytes = 0;
+    writes = 0;
+    start = now_ns();
+
+    for (long long i = 0; i < iterations; i++)
+    {
+      b->iteration++;
+      op(b);
+
+      if (b->frame)
+      {
+        FrameStats stats = frame_get_stats();
+        bytes += stats.bytes;
+        writes += stats.writes;
+      }
+    }
+
+    elapsed = now_ns() - start;
+    if (elapsed >= BENCH_DURATION * 1e9)
+      break;
+  }
+
+  r.ns_per_op = elapsed / iterations;
+  r.bytes_per_frame = b->frame ? (double)bytes / iterations : -1;
+  r.writes_per_frame = b->frame ? (double)writes / iterations : -1;
+  return r;
+}
+
+/**
+ * @brief Prints the result of a benchmark.
+ * 
+ * @param out destination file
+ * @param machine 1 for tab separated values, 0 for a table
+ * @param name name of the benchmark
+ * @param param parameters of the benchmark
+ * @param r result
+ */
+void report(FILE *out, int machine, char *name, char *param, Result r)
+{
+  if (machine)
+    fprintf(out, "%s\t%s\t%.1f\t%.1f\t%.2f\n", name, param, r.ns_per_op, r.bytes_per_frame, r.writes_per_frame);
+  else if (r.bytes_per_frame < 0)
+    fprintf(out, "%-24s %-16s %12.1f ns/op\n", name, param, r.ns_per_op);
+  else
+    fprintf(out, "%-24s %-16s %12.1f ns/op %10.1f B/frame %6.2f writes/frame\n", name, param, r.ns_per_op, r.bytes_per_frame, r.writes_per_frame);
+
+  fflush(out);
+}
+
+/**
+ * @brief Fills a buffer with words of text.
+ * 
+ * @param buffer destination buffer
+ * @param len length of the text, in bytes
+ * @param multilingual 1 to mix accented, wide and combining characters, 0 for ASCII only
+ */
+void make_text(char *buffer, int len, int multilingual)
+{
+  const char *ascii[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit"};
+  const char *utf8[] = {"lorem", "caf\u00e9", "\u65e5\u672c\u8a9e", "sit", "e\u0301te", "\u30c6\u30ad\u30b9\u30c8", "na\u00efve", "elit"};
+  const char **words = multilingual ? utf8 : ascii;
+  int pos = 0;
+
+  for (int i = 0; pos < len; i++)
+  {
+    const char *word = words[i % 8];
+    for (int j = 0; word[j] != '\0' && pos < len; j++)
+      buffer[pos++] = word[j];
+
+    if (pos < len)
+      buffer[pos++] = ' ';
+  }
+
+  // no truncated characters
+  int last = len;
+  while (last > 0 && (buffer[last - 1] & 0xC0) == 0x80)
+    last--;
+  if (last > 0 && last - 1 + utf8CharLength(buffer[last - 1]) > len)
+    for (int i = last - 1; i < len; i++)
+      buffer[i] = '.';
+
+  // no trailing space
+  if (len > 0 && buffer[len - 1] == ' ')
+    buffer[len - 1] = '.';
+
+  buffer[len] = '\0';
+}
+
+/**
+ * @brief Creates a window with a line of text.
+ * 
+ * @param width width of the window
+ * @param text text of the window
+ * @return Window*
+ */
+Window *make_window(int width, char *text)
+{
+  Window *w = createWindow(0, 0);
+  windowSetPadding(w, 2);
+  windowSetAlignment(w, 0);
+  windowSetAutoWidth(w, 0);
+  windowSetWidth(w, width);
+  windowAddLine(w, text);
+  return w;
+}
+
+/**
+ * @brief Writes a quotes file in a directory.
+ * 
+ * @param dir directory
+ * @return char* path of the file, to be freed
+ */
+char *make_quotes_file(char *dir)
+{
+  char text[200];
+  char *path;
+  FILE *fp;
+
+  path = malloc(strlen(dir) + 16);
+  sprintf(path, "%s/quotes", dir);
+
+  fp = fopen(path, "w");
+  if (fp == NULL)
+    return path;
+
+  for (int i = 0; i < BENCH_QUOTES; i++)
+  {
+    make_text(text, 40 + i % 150, 0);
+    fprintf(fp, "%s@~Author %i\n", text, i);
+  }
+
+  fclose(fp);
+  return path;
+}
+
+/**
+ * @brief Draws an unchanged window and flushes the frame.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_window_show(Bench *b)
+{
+  windowShow(b->window);
+  frame_flush();
+}
+
+/**
+ * @brief Draws a window whose text changes every frame and flushes the frame.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_window_show_changing(Bench *b)
+{
+  // change a single character, like a ticking clock
+  char c = b->text[0];
+  b->text[0] = 'a' + b->iteration % 26;
+  windowDeleteAllLines(b->window);
+  windowAddLine(b->window, b->text);
+  b->text[0] = c;
+
+  windowShow(b->window);
+  frame_flush();
+}
+
+/**
+ * @brief Draws a bold window whose truecolor text color changes every frame and flushes the frame.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_window_show_colors(Bench *b)
+{
+  windowSetFGcolor(b->window, HSLtoStyle(createHSLcolor(b->iteration % 360, 100, 50)));
+  windowShow(b->window);
+  frame_flush();
+}
+
+/**
+ * @brief Wraps the lines of a window.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_lines_wrap(Bench *b)
+{
+  _windowLinesWrap(b->window);
+}
+
+/**
+ * @brief Lays out a window whose text and size have not changed.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_layout_cached(Bench *b)
+{
+  windowAutoResize(b->window);
+}
+
+/**
+ * @brief Draws the border of a window into the frame.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_draw_border(Bench *b)
+{
+  _windowDrawBorder(b->window);
+}
+
+/**
+ * @brief Draws a dialog and flushes the frame.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_dialog_show(Bench *b)
+{
+  dialogShow(b->dialog);
+  frame_flush();
+}
+
+/**
+ * @brief Converts a HSL color to RGB, going around the hue circle.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_hsl_to_rgb(Bench *b)
+{
+  volatile RGB rgb = HSLtoRGB(createHSLcolor(b->iteration % 360, 80, 50));
+  (void)rgb;
+}
+
+/**
+ * @brief Converts a hue to RGB with the lookup table.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_hue_to_rgb_fast(Bench *b)
+{
+  volatile RGB rgb = HUEtoRGBfast(b->iteration % 360);
+  (void)rgb;
+}
+
+/**
+ * @brief Draws a progress bar growing by an eighth of cell every frame and flushes the frame.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_bar_show(Bench *b)
+{
+  barSetProgress(b->bar, (b->iteration % 241) / 240.0);
+  barShow(b->bar);
+  frame_flush();
+}
+
+/**
+ * @brief Picks a random quote and places it into a window.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_place_quote(Bench *b)
+{
+  quoteIndexPlace(b->quotes, quoteIndexPick(b->quotes), b->window);
+}
+
+/**
+ * @brief Solves a layout tree whose windows did not change, keeping the cached geometry.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_layout_solve_cached(Bench *b)
+{
+  layoutSolve(b->layout, 1);
+}
+
+/**
+ * @brief Solves a layout tree after the width of its first window changed, moving all the windows.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_layout_solve(Bench *b)
+{
+  windowChangeLine(b->window, b->iteration % 2 ? "a longer first line" : "first line", 0);
+  layoutSolve(b->layout, 1);
+}
+
+/**
+ * @brief Moves the deadline of one of the timers and looks for the earliest one.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_timers_schedule(Bench *b)
+{
+  // spread along a minute, in an order that keeps the heap moving
+  timersSchedule(b->timers, b->iteration % TIMERS_SIZE, 1 + (b->iteration * 7919ULL) % 60000);
+  volatile unsigned long long next = timersNext(b->timers);
+  (void)next;
+}
+
+/**
+ * @brief Finds the phase running at a time, spread along a week.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_schedule_at(Bench *b)
+{
+  int offset;
+  volatile int entry = scheduleAt(b->schedule, (b->iteration * 7919ULL) % 604800, &offset);
+  (void)entry;
+}
+
+/**
+ * @brief Computes the end of a number of study phases, from any phase of the cycle.
+ * 
+ * @param b pointer to benchmark state
+ */
+void op_schedule_until(Bench *b)
+{
+  volatile long long seconds = scheduleUntilStudied(b->schedule, b->iteration % b->schedule->count, 1 + b->iteration % 100);
+  (void)seconds;
+}
+
+/**
+ * @brief Draws a reference scene through the recording sink and writes the captured bytes to a file.
+ * 
+ * @param path destination file
+ * @return int 0 on success, -1 on error
+ */
+int record_scene(char *path)
+{
+  Output *recording;
+  Window *w;
+  Dialog *d;
+  FILE *fp;
+  char *data;
+  int len, written;
+
+  recording = createRecordingOutput();
+  set_output(recording);
+  clear_terminal();
+
+  w = make_window(48, "Lorem ipsum dolor sit amet, consectetur adipiscing elit.");
+  windowSetPosition(w, 2, 2);
+  windowSetFGcolor(w, fg_RED);
+  windowShow(w);
+  deleteWindow(w);
+
+  w = make_window(48, "Sed do eiusmod tempor incididunt ut labore.");
+  windowSetPosition(w, 2, 12);
+  windowSetFGcolor(w, RGBtoStyle(createRGBcolor(255, 128, 0)));
+  windowSetBGcolor(w, bg_BLUE);
+  windowSetTextStyle(w, text_BOLD);
+  windowShow(w);
+
+  d = createDialog(0, 1);
+  dialogSetPadding(d, 4);
+  dialogSetText(d, "Do you want to skip the current session?", 1);
+  dialogCenter(d, 1, 0);
+  dialogShow(d);
+  frame_flush();
+
+  deleteDialog(d);
+  deleteWindow(w);
+
+  data = outputGetRecording(recording, &len);
+  fp = fopen(path, "w");
+  written = fp != NULL ? fwrite(data, 1, len, fp) : 0;
+  if (fp != NULL)
+    fclose(fp);
+
+  deleteOutput(recording);
+  return written == len ? 0 : -1;
+}
+
+/**
+ * @brief Writes some bytes to the input and checks the event they complete.
+ * A single event is expected, nothing must be left to read after it.
+ * 
+ * @param fd write end of the input
+ * @param bytes bytes to write
+ * @param expected_event event expected from poll_event()
+ * @param expected_key key expected for event_KEY
+ * @return int 0 if the event is the expected one, -1 otherwise
+ */
+int feed_input(int fd, char *bytes, int expected_event, char expected_key)
+{
+  const int len = strlen(bytes);
+  char key = 0;
+  int event, left;
+
+  if (write(fd, bytes, len) != len)
+    return -1;
+
+  event = poll_event(&key);
+  left = poll_event(&key);
+
+  if (event != expected_event || (event == event_KEY && key != expected_key) || left != event_NONE)
+  {
+    fprintf(stderr, "poll_event: got %i and %i, expected %i (key %i)\n", event, left, expected_event, expected_key);
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Checks that escape sequences split across reads are read as a whole.
+ * A pipe stands for the terminal, and every sequence is written in parts,
+ * as it often arrives over SSH or tmux. Then a dialog is driven by a split arrow key,
+ * and it must be drawn again through the recording sink.
+ * 
+ * @return int 0 if every check passed, -1 otherwise
+ */
+int check_input()
+{
+  Output *recording;
+  Dialog *d;
+  int fds[2];
+  int failed = 0;
+  int len;
+  char key;
+
+  if (pipe(fds) == -1 || dup2(fds[0], STDIN_FILENO) == -1)
+    return -1;
+  fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+
+  // a focus in cut after the introducer is not the i key
+  failed |= feed_input(fds[1], "\x1b[", event_NONE, 0);
+  failed |= feed_input(fds[1], "I", event_FOCUS_IN, 0);
+  // a lone escape is dropped on its own, the next key is kept
+  failed |= feed_input(fds[1], "\x1b", event_IGNORED, 0);
+  failed |= feed_input(fds[1], "i", event_KEY, 'i');
+  // escape followed by a key, as sent with alt
+  failed |= feed_input(fds[1], "\x1bx", event_KEY, 'x');
+  // parameters of a control sequence split from its final character
+  failed |= feed_input(fds[1], "\x1b[1;", event_NONE, 0);
+  failed |= feed_input(fds[1], "5C", event_RIGHT, 0);
+
+  recording = createRecordingOutput();
+  set_output(recording);
+  clear_terminal();
+
+  d = createDialog(0, 1);
+  dialogSetPadding(d, 4);
+  dialogSetText(d, "Do you want to skip the current session?", 1);
+  dialogCenter(d, 1, 0);
+  dialogShow(d);
+  frame_flush();
+  outputClearRecording(recording);
+
+  // the right arrow, split in two reads, moves to the second button
+  failed |= feed_input(fds[1], "\x1b[", event_NONE, 0);
+  if (write(fds[1], "C", 1) != 1 || dialogHandleEvent(d, poll_event(&key), key) != -1)
+    failed = -1;
+  dialogShow(d);
+  frame_flush();
+  outputGetRecording(recording, &len);
+  if (len == 0 || dialogHandleEvent(d, event_KEY, '\r') != 1)
+  {
+    fprintf(stderr, "dialog: the split arrow key did not move the active button\n");
+    failed = -1;
+  }
+
+  deleteDialog(d);
+  deleteOutput(recording);
+  close(fds[1]);
+
+  fprintf(stderr, failed ? "input checks failed\n" : "input checks passed\n");
+  return failed ? -1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+  const int widths[] = {24, 48, 78};
+  const int lengths[] = {16, 64, 240};
+  char text[MAX_WIDTH];
+  char param[64];
+  char dir[] = "/tmp/pomoc-bench-XXXXXX";
+  int machine;
+  Output *null;
+  FILE *out;
+  Bench b;
+
+  if (argc > 2 && strcmp(argv[1], "-r") == 0)
+    return record_scene(argv[2]) == 0 ? 0 : 1;
+
+  if (argc > 1 && strcmp(argv[1], "-k") == 0)
+    return check_input() == 0 ? 0 : 1;
+
+  machine = argc > 1 && strcmp(argv[1], "-m") == 0;
+
+  // the report goes to stdout, the frames to the null sink
+  out = stdout;
+  null = createNullOutput();
+  set_output(null);
+
+  if (machine)
+    fprintf(out, "name\tparam\tns_per_op\tbytes_per_frame\twrites_per_frame\n");
+
+  memset(&b, 0, sizeof(Bench));
+  b.text = text;
+
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      sprintf(param, "w=%i len=%i", widths[i], lengths[j]);
+      make_text(text, lengths[j], 0);
+
+      // every benchmark starts from an empty screen
+      clear_terminal();
+      b.window = make_window(widths[i], text);
+      b.frame = 1;
+      report(out, machine, "windowShow", param, run_bench(op_window_show, &b));
+      report(out, machine, "windowShow/changing", param, run_bench(op_window_show_changing, &b));
+      windowSetTextStyle(b.window, text_BOLD);
+      report(out, machine, "windowShow/colors", param, run_bench(op_window_show_colors, &b));
+
+      b.frame = 0;
+      report(out, machine, "_windowLinesWrap", param, run_bench(op_lines_wrap, &b));
+      report(out, machine, "windowAutoResize/cached", param, run_bench(op_layout_cached, &b));
+      deleteWindow(b.window);
+
+      // same length in bytes, fewer columns
+      make_text(text, lengths[j], 1);
+      b.window = make_window(widths[i], text);
+      report(out, machine, "_windowLinesWrap/utf8", param, run_bench(op_lines_wrap, &b));
+      deleteWindow(b.window);
+    }
+
+    sprintf(param, "w=%i", widths[i]);
+    b.window = make_window(widths[i], "-");
+    windowSetHeight(b.window, widths[i] / 4);
+    windowSetAutoHeight(b.window, 0);
+    b.frame = 0;
+    report(out, machine, "_windowDrawBorder", param, run_bench(op_draw_border, &b));
+    deleteWindow(b.window);
+  }
+
+  clear_terminal();
+  b.dialog = createDialog(0, 1);
+  dialogSetPadding(b.dialog, 4);
+  dialogSetText(b.dialog, "Do you want to skip the current session?", 1);
+  dialogCenter(b.dialog, 1, 0);
+  b.frame = 1;
+  report(out, machine, "dialogShow", "-", run_bench(op_dialog_show, &b));
+  deleteDialog(b.dialog);
+
+  clear_terminal();
+  style *ramp = createRamp(0, 60, 64);
+  b.bar = createBar(2, 2);
+  barSetWidth(b.bar, 30);
+  barSetRamp(b.bar, ramp, 64);
+  b.frame = 1;
+  report(out, machine, "barShow", "w=30", run_bench(op_bar_show, &b));
+  deleteBar(b.bar);
+  deleteRamp(ramp);
+
+  // the windows of the timer, without their text
+  Window *windows[5];
+  Layout *top;
+  b.layout = createLayout(layout_COLUMN, 0);
+  top = layoutAddLayout(b.layout, layout_ROW, 1);
+  for (int i = 0; i < 5; i++)
+  {
+    // the first two are sized by their text, the others stretched
+    windows[i] = make_window(48, "first line");
+    windowSetAutoWidth(windows[i], i < 2);
+    layoutAddWindow(i < 2 ? top : b.layout, windows[i], i >= 2);
+  }
+  b.window = windows[0];
+  b.frame = 0;
+  report(out, machine, "layoutSolve/cached", "windows=5", run_bench(op_layout_solve_cached, &b));
+  report(out, machine, "layoutSolve", "windows=5", run_bench(op_layout_solve, &b));
+  deleteLayout(b.layout);
+  for (int i = 0; i < 5; i++)
+    deleteWindow(windows[i]);
+
+  b.timers = createTimers();
+  sprintf(param, "timers=%i", TIMERS_SIZE);
+  report(out, machine, "timersSchedule", param, run_bench(op_timers_schedule, &b));
+  deleteTimers(b.timers);
+
+  b.schedule = createSchedule();
+  scheduleParse(b.schedule, "50/10x3 25/5x2 25/30");
+  sprintf(param, "phases=%i", b.schedule->count);
+  report(out, machine, "scheduleAt", param, run_bench(op_schedule_at, &b));
+  report(out, machine, "scheduleUntilStudied", param, run_bench(op_schedule_until, &b));
+  deleteSchedule(b.schedule);
+
+  report(out, machine, "HSLtoRGB", "-", run_bench(op_hsl_to_rgb, &b));
+  report(out, machine, "HUEtoRGBfast", "-", run_bench(op_hue_to_rgb_fast, &b));
+
+  if (mkdtemp(dir) != NULL)
+  {
+    char *path = make_quotes_file(dir);
+
+    sprintf(param, "quotes=%i", BENCH_QUOTES);
+    b.quotes = createQuoteIndex(path);
+    b.window = make_window(78, "-");
+    report(out, machine, "place_random_quote", param, run_bench(op_place_quote, &b));
+    deleteWindow(b.window);
+    deleteQuoteIndex(b.quotes);
+
+    remove(path);
+    rmdir(dir);
+    free(path);
+  }
+
+  deleteOutput(null);
+  return 0;
+}
@@ -1,4 +1,53 @@
+import argparse
+import struct
+
+from widths import display_width
+
+PACK_MAGIC = b"PQPK"
+PACK_VERSION = 1
+
+
+def write_pack(path, quotes):
+    # layout of the pack, all integers are little endian 32 bit unsigned:
+    # - header: magic, version, number of quotes
+    # - entries: text offset, text length, text width,
+    #            author offset, author length, author width
+    # - strings: NUL terminated UTF-8 strings
+    header_size = 4 + 4 + 4
+    entry_size = 6 * 4
+    strings_start = header_size + entry_size * len(quotes)
+
+    entries = bytearray()
+    strings = bytearray()
+    for line in quotes:
+        text, _, author = line.rpartition("@")
+        if not _:
+            text, author = author, ""
+
+        fields = []
+        for s in (text, author):
+            encoded = s.encode("utf-8")
+            fields += [strings_start + len(strings), len(encoded), display_width(s)]
+            strings += encoded + b"\0"
+
+        entries += struct.pack("<6I", *fields)
+
+    with open(path, "wb") as f:
+        f.write(PACK_MAGIC)
+        f.write(struct.pack("<2I", PACK_VERSION, len(quotes)))
+        f.write(entries)
+        f.write(strings)
+
+
 def main():
+    parser = argparse.ArgumentParser(description="Normalises quotes-raw into .QUOTES")
+    parser.add_argument(
+        "--binary",
+        action="store_true",
+        help="also write the precompiled binary pack .QUOTES_PACK",
+    )
+    args = parser.parse_args()
+
     with open("quotes-raw", "r") as f:
         raw_quotes = f.read().splitlines()
 
@@ -39,6 +88,9 @@ def main():
         for line in quotes:
             f.write(f"{line}\n")
 
+    if args.binary:
+        write_pack(".QUOTES_PACK", quotes)
+
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,119 @@
+/** @file clock.c */
+
+#define _DEFAULT_SOURCE // for clock_gettime()
+
+#include "clock.h"
+
+// system clocks, used by default
+static Clock _system_clock = {.simulated = 0};
+
+// clock currently in use
+static Clock *_clock = &_system_clock;
+
+/**
+ * @brief Creates a virtual clock, standing still until moved.
+ * 
+ * @param wall wall clock time when the clock is created, seconds since epoch
+ * @return Clock* 
+ */
+Clock *createVirtualClock(time_t wall)
+{
+  Clock *c = malloc(sizeof(Clock));
+  if (c == NULL)
+    return NULL;
+
+  *c = (Clock){
+      .simulated = 1,
+      .monotonic = CLOCK_VIRTUAL_START,
+      .wall = wall,
+  };
+
+  return c;
+}
+
+/**
+ * @brief Deletes a clock. The system clocks are used again if it was in use.
+ * 
+ * @param c pointer to clock
+ */
+void deleteClock(Clock *c)
+{
+  if (c == _clock)
+    set_clock(NULL);
+
+  free(c);
+}
+
+/**
+ * @brief Moves a virtual clock forward.
+ * 
+ * @param c pointer to clock
+ * @param ms milliseconds
+ */
+void clockAdvance(Clock *c, unsigned long long ms)
+{
+  c->monotonic += ms;
+}
+
+/**
+ * @brief Moves a virtual clock to a given time. A virtual clock never goes back.
+ * 
+ * @param c pointer to clock
+ * @param monotonic monotonic milliseconds
+ */
+void clockSet(Clock *c, unsigned long long monotonic)
+{
+  if (monotonic > c->monotonic)
+    c->monotonic = monotonic;
+}
+
+/**
+ * @brief Sets the clock used by the timer.
+ * 
+ * @param c pointer to clock, NULL for the system clocks
+ */
+void set_clock(Clock *c)
+{
+  _clock = c != NULL ? c : &_system_clock;
+}
+
+/**
+ * @brief Returns the clock in use.
+ * 
+ * @return Clock* 
+ */
+Clock *get_clock()
+{
+  return _clock;
+}
+
+/**
+ * @brief Returns the time (milliseconds) of the monotonic clock in use.
+ * 
+ * @return unsigned long long 
+ */
+unsigned long long clock_monotonic()
+{
+  struct timespec ts;
+
+  if (_clock->simulated)
+    return _clock->monotonic;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (unsigned long long)(ts.tv_sec) * 1000 +
+         (unsigned long long)(ts.tv_nsec) / 1000000;
+}
+
+/**
+ * @brief Returns the wall clock time of the clock in use.
+ * 
+ * @return time_t seconds since epoch
+ */
+time_t clock_time()
+{
+  if (_clock->simulated)
+    return _clock->wall + (time_t)((_clock->monotonic - CLOCK_VIRTUAL_START) / 1000);
+
+  return time(NULL);
+}
@@ -0,0 +1,37 @@
+/**
+ * @file clock.h
+ * @brief Source of the time of the timer.
+ * By default the time is read from the system clocks. A virtual clock stands still
+ * until it's moved forward, so that days of phases can be simulated in milliseconds.
+ * The clock in use is set with set_clock().
+ */
+
+#ifndef _CLOCK
+#define _CLOCK
+
+#include <stdlib.h> // for malloc() and free()
+#include <time.h>   // for clock_gettime() and time()
+
+static const unsigned long long CLOCK_VIRTUAL_START = 1000; // monotonic milliseconds of a virtual clock when created
+
+/**
+ * @brief Struct containing a clock.
+ * 
+ */
+typedef struct
+{
+  int simulated;                /**<  is the clock virtual? */
+  unsigned long long monotonic; /**<  current monotonic milliseconds of a virtual clock */
+  time_t wall;                  /**<  wall clock time of a virtual clock at CLOCK_VIRTUAL_START */
+} Clock;
+
+Clock *createVirtualClock(time_t wall);
+void deleteClock(Clock *c);
+void clockAdvance(Clock *c, unsigned long long ms);
+void clockSet(Clock *c, unsigned long long monotonic);
+void set_clock(Clock *c);
+Clock *get_clock();
+unsigned long long clock_monotonic();
+time_t clock_time();
+
+#endif
@@ -7,14 +7,47 @@ static const int STUDYDURATION = 45;      // duration of the study phase, minute
 static const int SHORTBREAKDURATION = 15; // duration of the short break, minutes
 static const int LONGBREAKDURATION = 30;  // duration of the long break, minutes
 static const int STUDYSESSIONS = 4;       // number of study sessions before long break
+static const int STUDYGOAL = 8;           // number of study sessions planned for the day
 static const int Y_BORDER = 1;            // Y border window positioning
 static const int PADDING = 2;             // window text padding
 static const int BUFLEN = 250;            // length of the buffers
-static const int SAVEINTERVAL = 1000;     // interval between saves, msec
-static const int SLEEP_INTERVAL = 50;     // threads sleep time, msec
+static const int SAVE_CHECKPOINT = 60000; // interval between saves while nothing changes, msec
+static const int FSYNC_NEVER = 0;         // never wait for saves to reach the disk
+static const int FSYNC_STATE = 1;         // wait for the disk on changes of state only, not on checkpoints
+static const int FSYNC_ALWAYS = 2;        // wait for the disk on every save
+static const int SAVE_FSYNC = 1;          // default fsync policy of the saves, one of the FSYNC_ values
+static const int DIALOG_RESUME = 0;       // dialog asking whether to resume today's session
+static const int DIALOG_SKIP = 1;         // dialog asking whether to skip the current phase
+static const int DIALOG_EXIT = 2;         // dialog asking whether to exit
+static const int STUDY_HUE = 0;           // hue of the progress bar at the start of the study phase
+static const int BREAK_HUE = 120;         // hue of the progress bar at the start of the breaks
+static const int BAR_END_HUE = 60;        // hue of the progress bar at the end of every phase
+static const int BAR_RAMP_SIZE = 64;      // number of colors of the progress bar ramps
+static const int RESIZE_DELAY = 30;       // time without resize events before the windows are laid out again, msec
+static const int COUNTDOWN_TONES = 2;     // number of bells at the end of a countdown
+static const int COUNTDOWN_SPEED = 6;     // speed of the bells at the end of a countdown
+static const int EXPORT_BUFLEN = 65536;   // length of the output buffer of the export, bytes
+static const int SIMULATION_WIDTH = 100;  // width of the screen of the simulations
+static const int SIMULATION_HEIGHT = 30;  // height of the screen of the simulations
 
-static const char *QUOTES_PATH = ".QUOTES";     // file containing the quotes
-static const char *SAVE_PATH = ".SAVE";         // file containing the save for the current sessione
-static const char *SETTINGS_PATH = ".SETTINGS"; // file containing settings
+static const long SIMULATION_START = 1767603600; // wall clock time when the simulations start (2026-01-05 09:00 UTC)
+
+static const char *STUDY_NAME = "study";            // name of the study phase
+static const char *SHORTBREAK_NAME = "short break"; // name of the short break
+static const char *LONGBREAK_NAME = "long break";   // name of the long break
+static const char *STATUS_FORMAT = "%n %r";         // default format of the status line
+
+static const char *QUOTES_PATH = ".QUOTES";             // file containing the quotes
+static const char *QUOTES_PACK_PATH = ".QUOTES_PACK";   // precompiled pack of the quotes, made by quotes.py --binary
+static const char *SAVE_PATH = ".SAVE";                 // file containing the save for the current sessione
+static const char *SETTINGS_PATH = ".SETTINGS";         // file containing settings
+static const char *HISTORY_PATH = ".HISTORY";           // log of all the completed phases
+static const char *HISTORY_DAYS_PATH = ".HISTORY_DAYS"; // daily rollups of the history
+static const char *STATS_PATH = ".STATS";               // dump of the instrumentation, written on SIGUSR1
+static const char *STATS_ENV = "POMOC_STATS";           // environment variable enabling the instrumentation from the start
+static const char *HOOK_ENV = "POMOC_HOOK";             // environment variable holding the command run on phase transitions
+static const char *SYNC_ENV = "POMOC_SYNC";             // environment variable holding the directory shared with the other devices
+static const char *DEVICE_ENV = "POMOC_DEVICE";         // environment variable holding the name of the device, the host name by default
+static const char *FSYNC_ENV = "POMOC_FSYNC";           // environment variable holding the fsync policy of the saves: never, state or always
 
 #endif
\ No newline at end of file
@@ -0,0 +1,653 @@
+/** @file history.c */
+
+#define _DEFAULT_SOURCE // for pread(), pwrite() and localtime_r()
+
+#include "history.h"
+
+// Definition of private functions, so that linter and compiler are happy
+
+void _put32(unsigned char *buffer, uint32_t value);
+void _put64(unsigned char *buffer, uint64_t value);
+uint32_t _get32(unsigned char *buffer);
+uint64_t _get64(unsigned char *buffer);
+int _daysFromCivil(int year, int month, int day);
+void _civilFromDays(int days, int *year, int *month, int *day);
+int _historyWriteDay(History *h, int index);
+int _historyApply(History *h, HistoryRecord *record, uint32_t index);
+int _historyFindDay(History *h, int day, int after);
+History *_historyOpen(const char *log_path, const char *days_path, int read_only);
+void _historyDecode(unsigned char *buffer, HistoryRecord *record);
+
+/**
+ * @internal
+ * @brief Stores a 32 bit integer, little endian.
+ * 
+ * @param buffer destination buffer
+ * @param value value to store
+ */
+void _put32(unsigned char *buffer, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+    buffer[i] = value >> (8 * i);
+}
+
+/**
+ * @internal
+ * @brief Stores a 64 bit integer, little endian.
+ * 
+ * @param buffer destination buffer
+ * @param value value to store
+ */
+void _put64(unsigned char *buffer, uint64_t value)
+{
+  for (int i = 0; i < 8; i++)
+    buffer[i] = value >> (8 * i);
+}
+
+/**
+ * @internal
+ * @brief Loads a 32 bit integer, little endian.
+ * 
+ * @param buffer source buffer
+ * @return uint32_t 
+ */
+uint32_t _get32(unsigned char *buffer)
+{
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++)
+    value |= (uint32_t)buffer[i] << (8 * i);
+  return value;
+}
+
+/**
+ * @internal
+ * @brief Loads a 64 bit integer, little endian.
+ * 
+ * @param buffer source buffer
+ * @return uint64_t 
+ */
+uint64_t _get64(unsigned char *buffer)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++)
+    value |= (uint64_t)buffer[i] << (8 * i);
+  return value;
+}
+
+/**
+ * @internal
+ * @brief Converts a date into the number of days since epoch.
+ * 
+ * @param year year
+ * @param month month, in range [1-12]
+ * @param day day of the month, in range [1-31]
+ * @return int number of days since 1970-01-01
+ */
+int _daysFromCivil(int year, int month, int day)
+{
+  year -= month <= 2;
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const int yoe = year - era * 400;
+  const int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+/**
+ * @internal
+ * @brief Converts a number of days since epoch into a date.
+ * 
+ * @param days number of days since 1970-01-01
+ * @param year pointer to the year
+ * @param month pointer to the month, in range [1-12]
+ * @param day pointer to the day of the month, in range [1-31]
+ */
+void _civilFromDays(int days, int *year, int *month, int *day)
+{
+  days += 719468;
+  const int era = (days >= 0 ? days : days - 146096) / 146097;
+  const int doe = days - era * 146097;
+  const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const int mp = (5 * doy + 2) / 153;
+
+  *day = doy - (153 * mp + 2) / 5 + 1;
+  *month = mp < 10 ? mp + 3 : mp - 9;
+  *year = yoe + era * 400 + (*month <= 2);
+}
+
+/**
+ * @internal
+ * @brief Writes a daily rollup to file, in place.
+ * 
+ * @param h pointer to history
+ * @param index index of the rollup
+ * @return int -1 in case of error, 0 otherwise
+ */
+int _historyWriteDay(History *h, int index)
+{
+  unsigned char buffer[HISTORY_DAY_SIZE];
+  HistoryDay *d = h->days + index;
+
+  _put32(buffer, d->day);
+  _put32(buffer + 4, d->first_record);
+  _put32(buffer + 8, d->records);
+  _put32(buffer + 12, d->study_sessions);
+  _put32(buffer + 16, d->study_seconds);
+  _put32(buffer + 20, d->break_seconds);
+  _put64(buffer + 24, d->cumulative_sessions);
+  _put64(buffer + 32, d->cumulative_seconds);
+
+  if (pwrite(h->days_fd, buffer, HISTORY_DAY_SIZE, (off_t)index * HISTORY_DAY_SIZE) != HISTORY_DAY_SIZE)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * @internal
+ * @brief Accounts a record into the daily rollups.
+ * Records older than the last day are accounted into the last day, to keep the rollups sorted.
+ * 
+ * @param h pointer to history
+ * @param record pointer to the record
+ * @param index index of the record in the log
+ * @return int -1 in case of error, 0 otherwise
+ */
+int _historyApply(History *h, HistoryRecord *record, uint32_t index)
+{
+  const int day = historyDayNumber(record->start);
+
+  if (h->days_count == 0 || day > h->days[h->days_count - 1].day)
+  {
+    if (h->days_count == h->days_size)
+    {
+      // the rollups are left as they were if they can't grow
+      const int days_size = h->days_size > 0 ? h->days_size * 2 : 64;
+      HistoryDay *days = realloc(h->days, sizeof(HistoryDay) * days_size);
+      if (days == NULL)
+        return -1;
+
+      h->days = days;
+      h->days_size = days_size;
+    }
+
+    HistoryDay *previous = h->days_count > 0 ? h->days + h->days_count - 1 : NULL;
+
+    h->days[h->days_count] = (HistoryDay){
+        .day = day,
+        .first_record = index,
+        .records = 0,
+        .study_sessions = 0,
+        .study_seconds = 0,
+        .break_seconds = 0,
+        .cumulative_sessions = previous ? previous->cumulative_sessions : 0,
+        .cumulative_seconds = previous ? previous->cumulative_seconds : 0,
+    };
+    h->days_count++;
+  }
+
+  HistoryDay *d = h->days + h->days_count - 1;
+  d->records++;
+
+  if (record->flags & HISTORY_STUDY)
+  {
+    d->study_sessions++;
+    d->study_seconds += record->duration;
+    d->cumulative_sessions++;
+    d->cumulative_seconds += record->duration;
+  }
+  else
+  {
+    d->break_seconds += record->duration;
+  }
+
+  if (h->read_only)
+    return 0;
+
+  return _historyWriteDay(h, h->days_count - 1);
+}
+
+/**
+ * @internal
+ * @brief Binary searches a daily rollup.
+ * 
+ * @param h pointer to history
+ * @param day day to look for
+ * @param after 1 to find the first rollup not before the day, 0 to find the last rollup not after the day
+ * @return int index of the rollup, -1 if not found
+ */
+int _historyFindDay(History *h, int day, int after)
+{
+  int low, high, found;
+
+  low = 0;
+  high = h->days_count - 1;
+  found = -1;
+
+  while (low <= high)
+  {
+    const int mid = (low + high) / 2;
+
+    if (after ? h->days[mid].day >= day : h->days[mid].day <= day)
+    {
+      found = mid;
+      if (after)
+        high = mid - 1;
+      else
+        low = mid + 1;
+    }
+    else if (after)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid - 1;
+    }
+  }
+
+  return found;
+}
+
+/**
+ * @internal
+ * @brief Decodes a record of the log.
+ * 
+ * @param buffer HISTORY_RECORD_SIZE bytes, as stored in the log
+ * @param record pointer to the record to fill
+ */
+void _historyDecode(unsigned char *buffer, HistoryRecord *record)
+{
+  *record = (HistoryRecord){
+      .start = _get64(buffer),
+      .duration = _get32(buffer + 8),
+      .phase_id = (int16_t)(buffer[12] | buffer[13] << 8),
+      .flags = (int16_t)(buffer[14] | buffer[15] << 8),
+  };
+}
+
+/**
+ * @internal
+ * @brief Opens the history store.
+ * Rollups missing after a crash are recomputed from the tail of the log,
+ * and written back unless the store is read only.
+ * 
+ * @param log_path path of the log
+ * @param days_path path of the daily rollups
+ * @param read_only 1 to never create nor write the files, 0 otherwise
+ * @return History* pointer to history, NULL in case of error
+ */
+History *_historyOpen(const char *log_path, const char *days_path, int read_only)
+{
+  struct stat st;
+  History *h = malloc(sizeof(History));
+  const int flags = read_only ? O_RDONLY | O_CLOEXEC : O_RDWR | O_CREAT | O_CLOEXEC;
+
+  *h = (History){
+      .log_fd = open(log_path, flags, 0644),
+      .days_fd = open(days_path, flags, 0644),
+      .records = 0,
+      .days = NULL,
+      .days_count = 0,
+      .days_size = 0,
+      .read_only = read_only,
+  };
+
+  if (h->log_fd == -1 || h->days_fd == -1)
+  {
+    deleteHistory(h);
+    return NULL;
+  }
+
+  // a partially written record is discarded
+  fstat(h->log_fd, &st);
+  h->records = st.st_size / HISTORY_RECORD_SIZE;
+  if (st.st_size % HISTORY_RECORD_SIZE && !read_only)
+    ftruncate(h->log_fd, (off_t)h->records * HISTORY_RECORD_SIZE);
+
+  // load all the rollups, a few bytes per day
+  fstat(h->days_fd, &st);
+  h->days_count = st.st_size / HISTORY_DAY_SIZE;
+  h->days_size = h->days_count > 0 ? h->days_count : 64;
+  h->days = malloc(sizeof(HistoryDay) * h->days_size);
+
+  if (h->days_count > 0)
+  {
+    unsigned char *buffer = malloc((size_t)h->days_count * HISTORY_DAY_SIZE);
+
+    if (pread(h->days_fd, buffer, (size_t)h->days_count * HISTORY_DAY_SIZE, 0) != (ssize_t)h->days_count * HISTORY_DAY_SIZE)
+      h->days_count = 0;
+
+    for (int i = 0; i < h->days_count; i++)
+    {
+      unsigned char *b = buffer + (size_t)i * HISTORY_DAY_SIZE;
+      h->days[i] = (HistoryDay){
+          .day = _get32(b),
+          .first_record = _get32(b + 4),
+          .records = _get32(b + 8),
+          .study_sessions = _get32(b + 12),
+          .study_seconds = _get32(b + 16),
+          .break_seconds = _get32(b + 20),
+          .cumulative_sessions = _get64(b + 24),
+          .cumulative_seconds = _get64(b + 32),
+      };
+    }
+
+    free(buffer);
+  }
+
+  uint32_t covered = 0;
+  if (h->days_count > 0)
+    covered = h->days[h->days_count - 1].first_record + h->days[h->days_count - 1].records;
+
+  if (covered > h->records)
+  {
+    // the rollups don't match the log, compute them again
+    h->days_count = 0;
+    covered = 0;
+  }
+
+  // the file is left untouched if the rollups are all valid
+  if (!read_only && st.st_size != (off_t)h->days_count * HISTORY_DAY_SIZE)
+    ftruncate(h->days_fd, (off_t)h->days_count * HISTORY_DAY_SIZE);
+
+  // account the records appended after the last rollup update
+  for (uint32_t i = covered; i < h->records; i++)
+  {
+    HistoryRecord record;
+    if (historyReadRecord(h, i, &record) == 0)
+      _historyApply(h, &record, i);
+  }
+
+  return h;
+}
+
+/**
+ * @brief Opens the history store, creating the files if needed.
+ * Rollups missing after a crash are recomputed from the tail of the log.
+ * 
+ * @param log_path path of the log
+ * @param days_path path of the daily rollups
+ * @return History* pointer to history, NULL in case of error
+ */
+History *createHistory(const char *log_path, const char *days_path)
+{
+  return _historyOpen(log_path, days_path, 0);
+}
+
+/**
+ * @brief Opens the history store for reading only, leaving the files untouched.
+ * Rollups missing after a crash are recomputed in memory.
+ * Appending to a store opened this way fails.
+ * 
+ * @param log_path path of the log
+ * @param days_path path of the daily rollups
+ * @return History* pointer to history, NULL in case of error or if the files don't exist
+ */
+History *createHistoryReader(const char *log_path, const char *days_path)
+{
+  return _historyOpen(log_path, days_path, 1);
+}
+
+/**
+ * @brief Closes the history store, freeing the memory.
+ * 
+ * @param h pointer to history
+ */
+void deleteHistory(History *h)
+{
+  if (!h)
+    return;
+
+  if (h->log_fd != -1)
+    close(h->log_fd);
+  if (h->days_fd != -1)
+    close(h->days_fd);
+
+  free(h->days);
+  free(h);
+}
+
+/**
+ * @brief Appends a record to the log, updating the rollup of its day.
+ * 
+ * @param h pointer to history
+ * @param record record to append
+ * @return int -1 in case of error, 0 otherwise
+ */
+int historyAppend(History *h, HistoryRecord record)
+{
+  unsigned char buffer[HISTORY_RECORD_SIZE];
+
+  _put64(buffer, record.start);
+  _put32(buffer + 8, record.duration);
+  buffer[12] = record.phase_id & 0xFF;
+  buffer[13] = (record.phase_id >> 8) & 0xFF;
+  buffer[14] = record.flags & 0xFF;
+  buffer[15] = (record.flags >> 8) & 0xFF;
+
+  if (pwrite(h->log_fd, buffer, HISTORY_RECORD_SIZE, (off_t)h->records * HISTORY_RECORD_SIZE) != HISTORY_RECORD_SIZE)
+    return -1;
+
+  h->records++;
+  return _historyApply(h, &record, h->records - 1);
+}
+
+/**
+ * @brief Reads a record from the log.
+ * 
+ * @param h pointer to history
+ * @param index index of the record
+ * @param record pointer to the record to fill
+ * @return int -1 in case of error, 0 otherwise
+ */
+int historyReadRecord(History *h, uint32_t index, HistoryRecord *record)
+{
+  unsigned char buffer[HISTORY_RECORD_SIZE];
+
+  if (index >= h->records)
+    return -1;
+
+  if (pread(h->log_fd, buffer, HISTORY_RECORD_SIZE, (off_t)index * HISTORY_RECORD_SIZE) != HISTORY_RECORD_SIZE)
+    return -1;
+
+  _historyDecode(buffer, record);
+  return 0;
+}
+
+/**
+ * @brief Reads consecutive records from the log, with a single read.
+ * 
+ * @param h pointer to history
+ * @param index index of the first record
+ * @param records array of records to fill
+ * @param count maximum number of records to read, at most HISTORY_BATCH_SIZE
+ * @return int number of read records, 0 past the end of the log, -1 in case of error
+ */
+int historyReadRecords(History *h, uint32_t index, HistoryRecord *records, int count)
+{
+  unsigned char buffer[HISTORY_BATCH_SIZE * HISTORY_RECORD_SIZE];
+  ssize_t read_bytes;
+
+  if (index >= h->records)
+    return 0;
+
+  if (count > HISTORY_BATCH_SIZE)
+    count = HISTORY_BATCH_SIZE;
+  if ((uint32_t)count > h->records - index)
+    count = h->records - index;
+
+  read_bytes = pread(h->log_fd, buffer, (size_t)count * HISTORY_RECORD_SIZE, (off_t)index * HISTORY_RECORD_SIZE);
+  if (read_bytes < 0)
+    return -1;
+
+  count = read_bytes / HISTORY_RECORD_SIZE;
+  for (int i = 0; i < count; i++)
+    _historyDecode(buffer + i * HISTORY_RECORD_SIZE, records + i);
+
+  return count;
+}
+
+/**
+ * @brief Finds the records of a range of days in the log, without scanning it.
+ * Records are grouped by the rollup they were accounted into,
+ * so a record older than the day it was appended in belongs to the latter.
+ * 
+ * @param h pointer to history
+ * @param first_day first day of the range, included
+ * @param last_day last day of the range, included
+ * @param first_record pointer to the index of the first record of the range
+ * @param records pointer to the number of records of the range
+ * @return int -1 if nothing was recorded in the range, 0 otherwise
+ */
+int historyRange(History *h, int first_day, int last_day, uint32_t *first_record, uint32_t *records)
+{
+  const int first = _historyFindDay(h, first_day, 1);
+  const int last = _historyFindDay(h, last_day, 0);
+
+  *first_record = 0;
+  *records = 0;
+
+  if (first == -1 || last == -1 || first > last)
+    return -1;
+
+  *first_record = h->days[first].first_record;
+  *records = h->days[last].first_record + h->days[last].records - *first_record;
+  return 0;
+}
+
+/**
+ * @brief Waits for the log and the rollups to reach the disk.
+ * 
+ * @param h pointer to history
+ * @return int -1 in case of error, 0 otherwise
+ */
+int historySync(History *h)
+{
+  if (fsync(h->log_fd) != 0 || fsync(h->days_fd) != 0)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * @brief Gets the rollup of a day.
+ * 
+ * @param h pointer to history
+ * @param day day, as returned by historyDayNumber()
+ * @return HistoryDay* pointer to the rollup, NULL if nothing was recorded in the day
+ */
+HistoryDay *historyGetDay(History *h, int day)
+{
+  const int index = _historyFindDay(h, day, 1);
+
+  if (index == -1 || h->days[index].day != day)
+    return NULL;
+
+  return h->days + index;
+}
+
+/**
+ * @brief Gets the totals over a range of days, without scanning the log.
+ * 
+ * @param h pointer to history
+ * @param first_day first day of the range, included
+ * @param last_day last day of the range, included
+ * @return HistoryTotals 
+ */
+HistoryTotals historyGetTotals(History *h, int first_day, int last_day)
+{
+  const int first = _historyFindDay(h, first_day, 1);
+  const int last = _historyFindDay(h, last_day, 0);
+
+  if (first == -1 || last == -1 || first > last)
+    return (HistoryTotals){.study_sessions = 0, .study_seconds = 0};
+
+  HistoryDay *f = h->days + first;
+  HistoryDay *l = h->days + last;
+
+  return (HistoryTotals){
+      .study_sessions = l->cumulative_sessions - f->cumulative_sessions + f->study_sessions,
+      .study_seconds = l->cumulative_seconds - f->cumulative_seconds + f->study_seconds,
+  };
+}
+
+/**
+ * @brief Returns the day (local time) of a timestamp, as number of days since epoch.
+ * 
+ * @param t timestamp, seconds since epoch
+ * @return int number of days since 1970-01-01
+ */
+int historyDayNumber(time_t t)
+{
+  struct tm tm;
+  localtime_r(&t, &tm);
+  return _daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+/**
+ * @brief Parses a date in the YYYY-MM-DD format.
+ * 
+ * @param s string to parse
+ * @param day pointer to the number of days since epoch
+ * @return int -1 if the string is not a valid date, 0 otherwise
+ */
+int historyParseDay(const char *s, int *day)
+{
+  int year, month, month_day, len = 0;
+  int y, m, d;
+
+  if (sscanf(s, "%4d-%2d-%2d%n", &year, &month, &month_day, &len) != 3 || s[len] != '\0')
+    return -1;
+
+  if (month < 1 || month > 12 || month_day < 1 || month_day > 31)
+    return -1;
+
+  // days past the end of the month would roll over to the next one
+  *day = _daysFromCivil(year, month, month_day);
+  _civilFromDays(*day, &y, &m, &d);
+  if (y != year || m != month || d != month_day)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * @brief Returns the first day (monday) of the week of a day.
+ * 
+ * @param day number of days since epoch
+ * @return int 
+ */
+int historyWeekStart(int day)
+{
+  // 1970-01-01 was a thursday
+  const int weekday = ((day + 3) % 7 + 7) % 7;
+  return day - weekday;
+}
+
+/**
+ * @brief Returns the first day of the month of a day.
+ * 
+ * @param day number of days since epoch
+ * @return int 
+ */
+int historyMonthStart(int day)
+{
+  int year, month, month_day;
+  _civilFromDays(day, &year, &month, &month_day);
+  return _daysFromCivil(year, month, 1);
+}
+
+/**
+ * @brief Returns the first day of the year of a day.
+ * 
+ * @param day number of days since epoch
+ * @return int 
+ */
+int historyYearStart(int day)
+{
+  int year, month, month_day;
+  _civilFromDays(day, &year, &month, &month_day);
+  return _daysFromCivil(year, 1, 1);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file history.h
+ * @brief Append-only log of the completed phases.
+ * Every completed phase is appended to a binary log, while a second file holds
+ * a rollup for each day, along with running totals. Totals over any range of days
+ * are then computed from two rollups, without scanning the log.
+ * All integers are stored little endian, so that files can be moved across machines.
+ */
+
+#ifndef _HISTORY
+#define _HISTORY
+
+#include <stdio.h>     // for sscanf()
+#include <stdlib.h>    // for malloc() and free()
+#include <string.h>    // for memset()
+#include <fcntl.h>     // for open()
+#include <unistd.h>    // for pread() and pwrite()
+#include <sys/stat.h>  // for fstat()
+#include <time.h>      // for localtime_r()
+#include <stdint.h>    // for int64_t
+
+static const int HISTORY_RECORD_SIZE = 16; // size of a record of the log
+static const int HISTORY_DAY_SIZE = 40;    // size of a daily rollup
+static const int HISTORY_STUDY = 1;        // flag of the records of study phases
+
+#define HISTORY_BATCH_SIZE 256 // maximum number of records read at once
+
+/**
+ * @brief Struct containing a record of the log, a completed phase.
+ * 
+ */
+typedef struct
+{
+  int64_t start;    /**<  start of the phase, seconds since epoch */
+  int32_t duration; /**<  duration of the phase, seconds */
+  int16_t phase_id; /**<  id of the phase */
+  int16_t flags;    /**<  flags of the phase, HISTORY_STUDY for study phases */
+} HistoryRecord;
+
+/**
+ * @brief Struct containing the rollup of a day.
+ * 
+ */
+typedef struct
+{
+  int32_t day;                   /**<  day, as number of days since epoch (local time) */
+  uint32_t first_record;         /**<  index of the first record of the day in the log */
+  uint32_t records;              /**<  number of records of the day */
+  int32_t study_sessions;        /**<  number of study phases completed in the day */
+  int32_t study_seconds;         /**<  seconds studied in the day */
+  int32_t break_seconds;         /**<  seconds of break in the day */
+  int64_t cumulative_sessions;   /**<  study phases completed up to this day, included */
+  int64_t cumulative_seconds;    /**<  seconds studied up to this day, included */
+} HistoryDay;
+
+/**
+ * @brief Struct containing totals over a range of days.
+ * 
+ */
+typedef struct
+{
+  int64_t study_sessions; /**<  number of study phases completed */
+  int64_t study_seconds;  /**<  seconds studied */
+} HistoryTotals;
+
+/**
+ * @brief Struct containing the history store.
+ * 
+ */
+typedef struct
+{
+  int log_fd;       /**<  file descriptor of the log */
+  int days_fd;      /**<  file descriptor of the daily rollups */
+  uint32_t records; /**<  number of records in the log */
+  HistoryDay *days; /**<  daily rollups, sorted by day */
+  int days_count;   /**<  number of daily rollups */
+  int days_size;    /**<  allocated number of daily rollups */
+  int read_only;    /**<  are the files left untouched? */
+} History;
+
+History *createHistory(const char *log_path, const char *days_path);
+History *createHistoryReader(const char *log_path, const char *days_path);
+void deleteHistory(History *h);
+int historyAppend(History *h, HistoryRecord record);
+int historyReadRecord(History *h, uint32_t index, HistoryRecord *record);
+int historyReadRecords(History *h, uint32_t index, HistoryRecord *records, int count);
+int historyRange(History *h, int first_day, int last_day, uint32_t *first_record, uint32_t *records);
+int historySync(History *h);
+HistoryDay *historyGetDay(History *h, int day);
+HistoryTotals historyGetTotals(History *h, int first_day, int last_day);
+int historyDayNumber(time_t t);
+int historyParseDay(const char *s, int *day);
+int historyWeekStart(int day);
+int historyMonthStart(int day);
+int historyYearStart(int day);
+
+#endif
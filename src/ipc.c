@@ -0,0 +1,438 @@
+/** @file ipc.c */
+
+#define _GNU_SOURCE // for accept4()
+
+#include "ipc.h"
+
+// Definition of private functions, so that linter and compiler are happy
+
+int _ipcAddress(char *path, struct sockaddr_un *address);
+int _ipcPrivateDir(char *path);
+int _ipcPeerIsUser(int fd);
+void _serverDrop(Server *s, int index);
+
+/**
+ * @internal
+ * @brief Fills the address of a socket.
+ * 
+ * @param path path of the socket
+ * @param address pointer to the address
+ * @return int -1 if the path is too long, 0 otherwise
+ */
+int _ipcAddress(char *path, struct sockaddr_un *address)
+{
+  if (strlen(path) >= sizeof(address->sun_path))
+    return -1;
+
+  memset(address, 0, sizeof(struct sockaddr_un));
+  address->sun_family = AF_UNIX;
+  strcpy(address->sun_path, path);
+  return 0;
+}
+
+/**
+ * @internal
+ * @brief Creates a directory only the current user can use, or checks an existing one.
+ * The directory must not be a link, must belong to the user and must be closed to everybody else,
+ * so that nobody can place a socket in it.
+ * 
+ * @param path path of the directory
+ * @return int -1 if the directory cannot be trusted, 0 otherwise
+ */
+int _ipcPrivateDir(char *path)
+{
+  struct stat st;
+
+  if (mkdir(path, 0700) != 0 && errno != EEXIST)
+    return -1;
+
+  if (lstat(path, &st) != 0)
+    return -1;
+
+  if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077) != 0)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * @internal
+ * @brief Checks that the process at the other end of a socket belongs to the current user.
+ * 
+ * @param fd connected socket
+ * @return int 1 if it does, 0 otherwise
+ */
+int _ipcPeerIsUser(int fd)
+{
+  struct ucred credentials;
+  socklen_t len = sizeof(credentials);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &len) != 0)
+    return 0;
+
+  return credentials.uid == getuid();
+}
+
+/**
+ * @internal
+ * @brief Disconnects a client.
+ * 
+ * @param s pointer to server
+ * @param index index of the client
+ */
+void _serverDrop(Server *s, int index)
+{
+  close(s->clients[index]);
+  // keep the clients packed
+  s->clients[index] = s->clients[s->clients_count - 1];
+  s->clients_count--;
+}
+
+/**
+ * @brief Gets the path of the socket of the current user.
+ * The socket lives in $XDG_RUNTIME_DIR, or in a private directory of /tmp if it's not set.
+ * The directory is created if needed, and refused if another user could write into it.
+ * 
+ * @param buffer destination buffer
+ * @param size size of the buffer
+ * @return int -1 if the path does not fit the buffer or the directory cannot be trusted, its length otherwise
+ */
+int ipcSocketPath(char *buffer, int size)
+{
+  char dir[IPC_PATH_SIZE];
+  char *runtime_dir;
+  int len;
+
+  runtime_dir = getenv("XDG_RUNTIME_DIR");
+  if (runtime_dir != NULL && runtime_dir[0] != '\0')
+    len = snprintf(dir, IPC_PATH_SIZE, "%s", runtime_dir);
+  else
+    len = snprintf(dir, IPC_PATH_SIZE, "/tmp/pomoc-%u", (unsigned)getuid());
+
+  if (len >= IPC_PATH_SIZE || _ipcPrivateDir(dir) != 0)
+    return -1;
+
+  len = snprintf(buffer, size, "%s/%s", dir, IPC_SOCKET_NAME);
+  if (len >= size || len >= IPC_PATH_SIZE)
+    return -1;
+
+  return len;
+}
+
+/**
+ * @brief Formats a successful response containing the state.
+ * 
+ * @param buffer destination buffer
+ * @param size size of the buffer
+ * @param state pointer to state
+ * @return int length of the response
+ */
+int ipcFormatState(char *buffer, int size, TimerState *state)
+{
+  int len;
+
+  len = snprintf(buffer, size, "OK %i %i %i %i %i %llu %i %i %i %i %i %i %i %i %i %i %i %i %s",
+                 IPC_VERSION,
+                 state->phase_id,
+                 state->time_paused,
+                 state->phase_elapsed,
+                 state->phase_remaining,
+                 state->deadline,
+                 state->study_elapsed,
+                 state->study_phases,
+                 state->goal_remaining,
+                 state->phase_completed,
+                 state->phase_repetitions,
+                 state->phase_duration,
+                 state->phase_is_study,
+                 state->phase_fg_color,
+                 state->quote_id,
+                 state->transitions,
+                 state->tone_repetitions,
+                 state->tone_speed,
+                 state->phase_name);
+
+  return len < size ? len : size - 1;
+}
+
+/**
+ * @brief Parses a response containing the state.
+ * 
+ * @param buffer NUL terminated response
+ * @param state pointer to destination state
+ * @return int -1 if the response is an error, -2 if it's not valid, -3 if the version does not match, 0 otherwise
+ */
+int ipcParseState(char *buffer, TimerState *state)
+{
+  int version, name_offset;
+
+  if (strncmp(buffer, "OK ", 3) != 0)
+    return -1;
+
+  name_offset = -1;
+  if (sscanf(buffer + 3, "%i %i %i %i %i %llu %i %i %i %i %i %i %i %i %i %i %i %i %n",
+             &version,
+             &state->phase_id,
+             &state->time_paused,
+             &state->phase_elapsed,
+             &state->phase_remaining,
+             &state->deadline,
+             &state->study_elapsed,
+             &state->study_phases,
+             &state->goal_remaining,
+             &state->phase_completed,
+             &state->phase_repetitions,
+             &state->phase_duration,
+             &state->phase_is_study,
+             &state->phase_fg_color,
+             &state->quote_id,
+             &state->transitions,
+             &state->tone_repetitions,
+             &state->tone_speed,
+             &name_offset) != 18 ||
+      name_offset == -1)
+    return -2;
+
+  if (version != IPC_VERSION)
+    return -3;
+
+  strncpy(state->phase_name, buffer + 3 + name_offset, SNAPSHOT_NAME_SIZE - 1);
+  state->phase_name[SNAPSHOT_NAME_SIZE - 1] = '\0';
+  return 0;
+}
+
+/**
+ * @brief Creates a server listening on a socket.
+ * A stale socket left by a crashed process is replaced.
+ * 
+ * @param path path of the socket
+ * @return Server* NULL if another server is listening on the socket or in case of error
+ */
+Server *createServer(char *path)
+{
+  struct sockaddr_un address;
+  Server *s;
+  int fd;
+
+  if (_ipcAddress(path, &address) != 0)
+    return NULL;
+
+  // check if another timer is already listening
+  fd = clientConnect(path);
+  if (fd != -1)
+  {
+    clientClose(fd);
+    errno = EADDRINUSE;
+    return NULL;
+  }
+
+  // the socket, if any, is stale
+  unlink(path);
+
+  fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1)
+    return NULL;
+
+  if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, IPC_MAX_CLIENTS) != 0)
+  {
+    close(fd);
+    return NULL;
+  }
+
+  s = malloc(sizeof(Server));
+  s->fd = fd;
+  s->clients_count = 0;
+  strcpy(s->path, path);
+
+  return s;
+}
+
+/**
+ * @brief Disconnects all the clients and removes the socket.
+ * 
+ * @param s pointer to server
+ */
+void deleteServer(Server *s)
+{
+  if (s == NULL)
+    return;
+
+  while (s->clients_count > 0)
+    _serverDrop(s, 0);
+
+  close(s->fd);
+  unlink(s->path);
+  free(s);
+}
+
+/**
+ * @brief Fills the poll file descriptors of the server: the listening socket, followed by the clients.
+ * Must be called before every poll, as clients connect and disconnect.
+ * 
+ * @param s pointer to server
+ * @param fds destination array, at least IPC_MAX_CLIENTS + 1 long
+ * @return int number of file descriptors
+ */
+int serverPollFds(Server *s, struct pollfd *fds)
+{
+  fds[0] = (struct pollfd){.fd = s->fd, .events = POLLIN};
+
+  for (int i = 0; i < s->clients_count; i++)
+    fds[i + 1] = (struct pollfd){.fd = s->clients[i], .events = POLLIN};
+
+  return s->clients_count + 1;
+}
+
+/**
+ * @brief Accepts new clients and answers their requests. Never blocks.
+ * 
+ * @param s pointer to server
+ * @param fds poll file descriptors filled by serverPollFds()
+ * @param count number of file descriptors
+ * @param handler function handling each request
+ * @param args arguments of the handler
+ */
+void serverHandle(Server *s, struct pollfd *fds, int count, RequestHandler handler, void *args)
+{
+  char request[IPC_MESSAGE_SIZE];
+  char response[IPC_MESSAGE_SIZE];
+
+  // go backwards, as dropping a client moves the last one
+  for (int i = count - 1; i > 0; i--)
+  {
+    if (!fds[i].revents)
+      continue;
+
+    int client = -1;
+    for (int j = 0; j < s->clients_count; j++)
+    {
+      if (s->clients[j] == fds[i].fd)
+      {
+        client = j;
+        break;
+      }
+    }
+
+    if (client == -1)
+      continue;
+
+    ssize_t len = recv(fds[i].fd, request, IPC_MESSAGE_SIZE - 1, MSG_DONTWAIT);
+    if (len == -1 && (errno == EAGAIN || errno == EINTR))
+      continue;
+
+    if (len <= 0)
+    {
+      // the client has disconnected
+      _serverDrop(s, client);
+      continue;
+    }
+
+    request[len] = '\0';
+    // ignore trailing newlines, so that the socket can be used by hand
+    while (len > 0 && (request[len - 1] == '\n' || request[len - 1] == '\r'))
+      request[--len] = '\0';
+
+    len = handler(args, request, response, IPC_MESSAGE_SIZE);
+    if (send(fds[i].fd, response, len, MSG_DONTWAIT | MSG_NOSIGNAL) != len)
+      _serverDrop(s, client);
+  }
+
+  if (fds[0].revents & POLLIN)
+  {
+    int fd;
+
+    while ((fd = accept4(s->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+    {
+      // no room for another client, or not one of the user's processes
+      if (s->clients_count == IPC_MAX_CLIENTS || !_ipcPeerIsUser(fd))
+      {
+        close(fd);
+        continue;
+      }
+
+      s->clients[s->clients_count++] = fd;
+    }
+  }
+}
+
+/**
+ * @brief Connects to a timer.
+ * Timers run by other users are refused, so that their answers are never trusted.
+ * 
+ * @param path path of the socket
+ * @return int socket file descriptor, -1 if no timer of the user is listening
+ */
+int clientConnect(char *path)
+{
+  struct sockaddr_un address;
+  int fd;
+
+  if (_ipcAddress(path, &address) != 0)
+    return -1;
+
+  fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd == -1)
+    return -1;
+
+  if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || !_ipcPeerIsUser(fd))
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/**
+ * @brief Sends a request and waits for its response.
+ * A response arriving after the timeout is discarded by the next request, so that responses never get mixed up.
+ * 
+ * @param fd socket file descriptor
+ * @param request NUL terminated request
+ * @param response destination buffer, the response is NUL terminated
+ * @param size size of the buffer
+ * @return int -1 if the connection is closed or broken, 0 if the timer did not answer in time, length of the response otherwise
+ */
+int clientRequest(int fd, char *request, char *response, int size)
+{
+  struct pollfd pfd = {.fd = fd, .events = POLLIN};
+  ssize_t len;
+  int ret;
+
+  // late responses to the requests that timed out
+  while ((len = recv(fd, response, size - 1, MSG_DONTWAIT)) > 0)
+    ;
+
+  if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+    return -1;
+
+  len = strlen(request);
+  if (send(fd, request, len, MSG_NOSIGNAL) != len)
+    return -1;
+
+  // the timer answers right away, unless it's busy
+  ret = poll(&pfd, 1, IPC_TIMEOUT);
+  if (ret == 0 || (ret == -1 && errno == EINTR))
+    return 0;
+  if (ret == -1)
+    return -1;
+
+  // a closed connection reads as end of file
+  len = recv(fd, response, size - 1, 0);
+  if (len <= 0)
+    return -1;
+
+  response[len] = '\0';
+  return len;
+}
+
+/**
+ * @brief Closes a connection to a timer.
+ * 
+ * @param fd socket file descriptor
+ */
+void clientClose(int fd)
+{
+  if (fd != -1)
+    close(fd);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file ipc.h
+ * @brief Query and control protocol of the timer, over a UNIX socket.
+ * The process owning the timer (the daemon or a standalone interface) listens on a
+ * sequenced packet socket, so that each request and each response is exactly one message.
+ * A request is a single command word: status, pause, resume, toggle, skip or quote.
+ * A response is either "ERR <reason>" or "OK" followed by the state, as space separated fields:
+ * version, phase id, paused, elapsed, remaining, deadline, study elapsed, study phases, goal remaining,
+ * completed, repetitions, duration, is study, color, quote id, transitions,
+ * tone repetitions, tone speed and phase name, the last one being the only one that may contain spaces.
+ * Requests starting with "timer" are about the countdowns, and are answered by "OK" followed
+ * by one line for each countdown: seconds left, paused and name.
+ */
+
+#ifndef _IPC
+#define _IPC
+
+#include <stdio.h>      // for snprintf()
+#include <stdlib.h>     // for getenv()
+#include <string.h>     // for strncpy()
+#include <unistd.h>     // for close()
+#include <errno.h>      // for errno
+#include <poll.h>       // for poll()
+#include <sys/socket.h> // for socket()
+#include <sys/stat.h>   // for mkdir()
+#include <sys/un.h>     // for sockaddr_un
+
+#include "snapshot.h"
+
+#define IPC_SOCKET_NAME "pomoc.sock"
+
+static const int IPC_VERSION = 2;        // version of the protocol
+static const int IPC_MESSAGE_SIZE = 256; // maximum size of a request or response
+static const int IPC_TIMEOUT = 1000;     // maximum time (milliseconds) to wait for a response
+#define IPC_MAX_CLIENTS 16 // maximum number of connected clients
+#define IPC_PATH_SIZE 108  // maximum size of a socket path
+
+/**
+ * @brief Function handling a request, writing the response into the buffer.
+ * Returns the length of the response.
+ * 
+ */
+typedef int (*RequestHandler)(void *args, char *request, char *response, int size);
+
+/**
+ * @brief Struct containing a listening socket and its clients.
+ * 
+ */
+typedef struct
+{
+  int fd;                       /**<  listening socket */
+  int clients[IPC_MAX_CLIENTS]; /**<  connected clients */
+  int clients_count;            /**<  number of connected clients */
+  char path[IPC_PATH_SIZE];     /**<  path of the socket */
+} Server;
+
+int ipcSocketPath(char *buffer, int size);
+int ipcFormatState(char *buffer, int size, TimerState *state);
+int ipcParseState(char *buffer, TimerState *state);
+
+Server *createServer(char *path);
+void deleteServer(Server *s);
+int serverPollFds(Server *s, struct pollfd *fds);
+void serverHandle(Server *s, struct pollfd *fds, int count, RequestHandler handler, void *args);
+
+int clientConnect(char *path);
+int clientRequest(int fd, char *request, char *response, int size);
+void clientClose(int fd);
+
+#endif
@@ -1,65 +1,115 @@
 #define _DEFAULT_SOURCE // for nanosleep
 
 #include <stdio.h>
-#include <sys/time.h> // for gettimeofday
-#include <time.h>     // for timespec
-#include <signal.h>   // for signal()
-#include <unistd.h>   // for nanosleep()
-#include <pthread.h>  // for multithread
-#include <string.h>   // for strlen()
-#include <stdlib.h>   // for malloc() and free() and rand()
+#include <sys/time.h>     // for gettimeofday
+#include <time.h>         // for timespec
+#include <signal.h>       // for sigprocmask()
+#include <unistd.h>       // for nanosleep()
+#include <pthread.h>      // for multithread
+#include <poll.h>         // for poll()
+#include <errno.h>        // for EINTR
+#include <sys/signalfd.h> // for signalfd()
+#include <sys/timerfd.h>  // for timerfd_create()
+#include <fcntl.h>        // for open()
+#include <string.h>       // for strlen()
+#include <stdlib.h>       // for malloc() and free() and rand()
 
 #include "terminal.h"
+#include "quotes.h"
+#include "history.h"
+#include "snapshot.h"
+#include "ipc.h"
+#include "stats.h"
+#include "notify.h"
+#include "timers.h"
+#include "clock.h"
+#include "schedule.h"
+#include "sync.h"
 #include "constants.h"
 #include "structures.h"
 
-// global variables are bad but there's no other way to pass data from interrupts
-volatile int sigint_called;   // flag for sigint
-volatile int sigwinch_called; // flag for sigwinch
-
 int file_read_line(char *buffer, int max_bytes, FILE *fp);
-int file_count_lines(FILE *fp);
-
-int check_savefile();
-int load_savefile(Parameters *p, Phase *phases);
-int save_savefile(Parameters *p);
 
-int check_settings();
-int load_settings(int *durations);
-int save_settings(int *durations);
+int read_savefile(Save *save);
+int load_savefile(Parameters *p, Save *save);
+int save_savefile(Parameters *p, int state_changed);
+int parse_fsync_policy(const char *value);
+int checkpoint_savefile(Parameters *p);
 
-void SIGWINCH_handler();
-void SIGINT_handler();
+void default_settings(Settings *settings);
+int load_settings(Settings *settings);
+int save_settings(Settings *settings);
 
 unsigned long long epoch();
+unsigned long long monotonic();
 void ms_sleep(int ms);
 void s_sleep(int sec);
 
-Phase *init_phases(Phase *phases, int argc, char *argv[]);
+void parse_arguments(Settings *settings, int argc, char *argv[]);
+void init_phases(Phase *phases, Schedule *schedule, int argc, char *argv[]);
+void create_phases(Phase *phases);
+void create_schedule(Schedule *schedule, Settings *settings);
 Windows *init_windows();
-Parameters *init_parameters(Phase *current_phase, Windows *windows);
+Parameters *init_parameters(Phase *phases, Schedule *schedule, Windows *windows, QuoteIndex *quotes, History *history);
 void delete_parameters(Parameters *p);
 Phase *set_initial_phase(Phase *phases);
+void set_phase(Parameters *p, int entry);
+void update_forecast(Parameters *p);
 void reset_current_time(Parameters *p);
+void schedule_phase(Parameters *p);
 void start_time(Parameters *p);
 void pause_time(Parameters *p);
-void next_phase(Parameters *p);
+void next_phase(Parameters *p, int skipped);
+unsigned long long phase_elapsed_ms(Parameters *p);
+unsigned long long phase_deadline(Parameters *p);
 int phase_time_remaining();
 
 void format_elapsed_time(char *buffer, int elapsed);
 void format_date(char *buffer);
 void format_time_delta(char *buffer, int delta_seconds);
 
-int place_random_quote(Window *w);
 void set_windows_visibility(Parameters *p, int visibility);
 
-void *beep_async(void *args);
-void *show_routine(void *args);
-void *advance_routine(void *args);
-void *save_routine(void *args);
-void *keypress_routine(void *args);
-int check_routines(Parameters *p);
-
+void publish_state(Parameters *p);
+int send_command(Parameters *p, char *command);
+int handle_request(void *args, char *request, char *response, int size);
+void lock_terminal(Parameters *p);
+void notify_transition(Parameters *p, char *event);
+void start_sync(Parameters *p);
+void record_sync(Parameters *p, int type, int elapsed);
+void follow_sync(Parameters *p, SyncRecord *record);
+void handle_sync(void *args, SyncRecord *record);
+void expire_timers(Parameters *p);
+int format_timers(Parameters *p, char *buffer, int size);
+int handle_timer_request(Parameters *p, char *request, char *response, int size);
+void draw_windows(Parameters *p);
+int resize_pending(Parameters *p);
+void update_time(Parameters *p);
+int show_dialog(Parameters *p, int action, char *text);
+void draw_dialog(Parameters *p);
+void answer_dialog(Parameters *p, int answer);
+int session_started(Parameters *p);
+void start_session(Parameters *p, int discarded);
+void handle_keypress(Parameters *p, char key);
+void handle_focus(Parameters *p, int focused);
+void handle_signal(Parameters *p, int signal_number);
+void arm_timer(Parameters *p, int timer_fd);
+int event_loop(Parameters *p);
+
+int load_status(TimerState *state);
+int format_status(char *buffer, int size, char *format, TimerState *state);
+
+void block_signals();
+int run_status(int argc, char *argv[]);
+int run_timer(int argc, char *argv[]);
+int format_record(char *buffer, HistoryRecord *record, int ndjson);
+int run_export(int argc, char *argv[]);
+int parse_delay(const char *s, unsigned long long *ms);
+void simulate_step(Parameters *p, const char *event, int *transitions);
+void simulate_until(Parameters *p, Clock *c, unsigned long long target, int *transitions);
+int run_simulation(int argc, char *argv[]);
+int run_daemon(int argc, char *argv[]);
+int run_interface(int argc, char *argv[]);
 int main(int argc, char *argv[]);
 
 /**
@@ -82,136 +132,121 @@ int file_read_line(char *buffer, int max_bytes, FILE *fp)
 }
 
 /**
- * @brief Counts number of lines in a file.
- * 
- * @param fp pointer to file
- * @return int number of lines in file
- */
-int file_count_lines(FILE *fp)
-{
-  fpos_t old_pos;
-  int lines;
-
-  // save old position
-  fgetpos(fp, &old_pos);
-  // reset to start
-  rewind(fp);
-
-  lines = 0;
-  while (!feof(fp))
-  {
-    char ch = fgetc(fp);
-    if (ch == '\n')
-      lines++;
-  }
-
-  // return to old position
-  fsetpos(fp, &old_pos);
-
-  return lines;
-}
-
-/**
- * @brief Checks if a save from today is already present.
+ * @brief Reads the save file, with a single pass.
  * 
- * @return int -1 if file is not found, -2 is save is from another day, 1 if save is valid
+ * @param save pointer to the content of the save
+ * @return int -1 if file is not found, -2 is save is from another day, -3 if it's not valid, 1 if save is valid
  */
-int check_savefile()
+int read_savefile(Save *save)
 {
   FILE *fp;
   char buffer[BUFLEN];
   char r_buffer[BUFLEN];
+  int values[5], ret;
 
   fp = fopen(SAVE_PATH, "r");
   if (fp == NULL)
     return -1;
 
-  // read date
-  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
-    return -1;
-
-  // format current date
+  // read date, then compare it with the current one
   format_date(buffer);
+  ret = 1;
+  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
+    ret = -3;
+  else if (strcmp(buffer, r_buffer) != 0)
+    ret = -2;
 
-  if (strcmp(buffer, r_buffer) != 0)
-    return -2;
+  // read phase elapsed, study elapsed, study phases, phase id and phase completed
+  for (int i = 0; i < 5 && ret == 1; i++)
+  {
+    if (file_read_line(r_buffer, BUFLEN, fp) == -1)
+      ret = -3;
+    else
+      values[i] = atoi(r_buffer);
+  }
 
   fclose(fp);
 
+  if (ret != 1)
+    return ret;
+
+  *save = (Save){
+      .phase_elapsed = values[0],
+      .study_elapsed = values[1],
+      .study_phases = values[2],
+      .phase_id = values[3],
+      .phase_completed = values[4],
+  };
+
   return 1;
 }
 
 /**
- * @brief Loads save from file.
+ * @brief Loads a save, as read by read_savefile().
+ * Today's totals are looked up in the history, if available.
  * 
  * @param p pointer to parameters structs
- * @param phases pointer to phases
- * @return int -1 if file is not found, negative values for other errors, 0 if save is correctly loaded
+ * @param save pointer to the content of the save
+ * @return int -1 if the saved phase is not valid, 0 if save is correctly loaded
  */
-int load_savefile(Parameters *p, Phase *phases)
+int load_savefile(Parameters *p, Save *save)
 {
-  FILE *fp;
-  char r_buffer[BUFLEN];
-  int num_buffer;
+  int entry;
 
-  // if the save is not from today, return
-  if (check_savefile() == -1)
-    return -2;
-
-  fp = fopen(SAVE_PATH, "r");
-  if (fp == NULL)
-    return -1;
+  // the saved phase is looked up in the cycle, which might have changed since
+  entry = scheduleFind(p->schedule, save->phase_id, save->phase_completed);
+  if (entry == -1)
+    entry = scheduleFind(p->schedule, save->phase_id, -1);
 
-  // read date, discarding first line
-  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
+  if (entry == -1)
     return -1;
 
-  // read phase elapsed
-  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
-    return -2;
-
-  // update the parameters struct
-  p->phase_elapsed = atoi(r_buffer);
-
-  // read total study elapsed
-  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
-    return -3;
-  // update the parameters struct
-  p->previous_elapsed = atoi(r_buffer);
-
-  // read total study phases
-  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
-    return -4;
   // update the parameters struct
-  p->study_phases = atoi(r_buffer);
+  set_phase(p, entry);
+  p->phase_elapsed = save->phase_elapsed;
+  p->previous_elapsed = save->study_elapsed;
+  p->study_phases = save->study_phases;
 
-  // read current phase id
-  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
-    return -5;
+  // resume the phase from where it was left
+  reset_current_time(p);
+  p->current_phase->started -= (unsigned long long)p->phase_elapsed * 1000;
 
-  // update the parameters struct
-  num_buffer = atoi(r_buffer);
-  // cycle to find the correct phase
-  for (int i = 0; i < 3; i++)
+  HistoryDay *today = p->history ? historyGetDay(p->history, historyDayNumber(clock_time())) : NULL;
+  if (today != NULL)
   {
-    if (phases[i].id == num_buffer)
-    {
-      p->current_phase = phases + i;
-      break;
-    }
-
-    return -6;
+    // completed phases are in the history
+    p->previous_elapsed = today->study_seconds;
+    p->study_phases = today->study_sessions;
+  }
+  else if (p->current_phase->is_study)
+  {
+    // the saved total includes the current phase
+    p->previous_elapsed -= p->phase_elapsed;
   }
 
-  // read current phase completed
-  if (file_read_line(r_buffer, BUFLEN, fp) == -1)
-    return -7;
-  // update the parameters struct
-  p->current_phase->completed = atoi(r_buffer);
+  update_forecast(p);
+  return 0;
+}
 
-  fclose(fp);
+/**
+ * @brief Parses the fsync policy of the saves.
+ * 
+ * @param value policy, one of "never", "state" and "always", may be NULL
+ * @return int one of the FSYNC_ values, SAVE_FSYNC if the policy is unknown or missing
+ */
+int parse_fsync_policy(const char *value)
+{
+  if (value == NULL)
+    return SAVE_FSYNC;
 
-  return 0;
+  if (strcmp(value, "never") == 0)
+    return FSYNC_NEVER;
+  if (strcmp(value, "state") == 0)
+    return FSYNC_STATE;
+  if (strcmp(value, "always") == 0)
+    return FSYNC_ALWAYS;
+
+  return SAVE_FSYNC;
 }
 
 /**
@@ -222,18 +257,27 @@ int load_savefile(Parameters *p, Phase *phases)
   - total study elapsed
   - total study phases
   - current phase id
-  - current phase completed
+  - study phases of the cycle before the current phase
   - current phase started
+  The file is written to a temporary file first and then renamed,
+  so a crash can never leave a truncated save behind.
  * 
  * @param p pointer to parameters
+ * @param state_changed 1 if the save follows a change of state (phase change, pause), 0 for a checkpoint
  * @return int -1 in case of error, 0 in case of success
  */
-int save_savefile(Parameters *p)
+int save_savefile(Parameters *p, int state_changed)
 {
   FILE *fp;
   char w_buffer[BUFLEN];
+  char tmp_path[BUFLEN];
+  int sync;
 
-  fp = fopen(SAVE_PATH, "w");
+  // should the data reach the disk before returning?
+  sync = p->fsync == FSYNC_ALWAYS || (p->fsync == FSYNC_STATE && state_changed);
+
+  snprintf(tmp_path, BUFLEN, "%s.tmp", SAVE_PATH);
+  fp = fopen(tmp_path, "w");
   if (fp == NULL)
     return -1;
 
@@ -258,137 +302,175 @@ int save_savefile(Parameters *p)
   sprintf(w_buffer, "%i\n", p->current_phase->id);
   fputs(w_buffer, fp);
 
-  // save current completed phases
-  sprintf(w_buffer, "%i\n", p->current_phase->completed);
+  // save position in the cycle
+  sprintf(w_buffer, "%i\n", p->schedule->entries[p->entry].studied);
   fputs(w_buffer, fp);
 
-  // save current phase started
-  sprintf(w_buffer, "%li\n", p->current_phase->started);
+  // save current phase started, as wall clock time
+  sprintf(w_buffer, "%li\n", (long)clock_time() - p->phase_elapsed);
   fputs(w_buffer, fp);
 
+  if (fflush(fp) != 0 || (sync && fsync(fileno(fp)) != 0))
+  {
+    fclose(fp);
+    remove(tmp_path);
+    return -1;
+  }
+
   fclose(fp);
 
+  // atomically replace the old save
+  if (rename(tmp_path, SAVE_PATH) != 0)
+  {
+    remove(tmp_path);
+    return -1;
+  }
+
+  if (sync && p->history)
+    historySync(p->history);
+
+  if (sync)
+  {
+    // make the rename itself durable
+    int dir_fd = open(".", O_RDONLY);
+    if (dir_fd != -1)
+    {
+      fsync(dir_fd);
+      close(dir_fd);
+    }
+  }
+
+  p->save_pending = 0;
+  p->last_save = monotonic();
+
   return 0;
 }
 
 /**
- * @brief Checks if settings file exists.
+ * @brief Saves stats to file, only if something worth saving has happened.
+ * A save is performed after a change of state or, while time is running, after a checkpoint interval.
  * 
- * @return int -1 if file does not exist, -2 if it's not valid, 0 if it's valid
+ * @param p pointer to parameters
+ * @return int -1 in case of error, 0 if the file was saved, 1 if there was nothing to save
  */
-int check_settings()
+int checkpoint_savefile(Parameters *p)
 {
-  FILE *fp;
-
-  fp = fopen(SETTINGS_PATH, "r");
+  unsigned long long start;
+  int ret;
 
-  if (fp == NULL)
-    return -1;
+  start = statsStart(p->stats);
 
-  // check if there are enough lines
-  if (file_count_lines(fp) < 4)
-    return -2;
+  if (p->save_pending)
+    ret = save_savefile(p, 1);
+  else if (!p->time_paused && monotonic() - p->last_save >= SAVE_CHECKPOINT)
+    ret = save_savefile(p, 0);
+  else
+    return 1;
 
-  fclose(fp);
+  statsRecord(p->stats, &p->stats->save, start);
+  return ret;
+}
 
-  return 0;
+/**
+ * @brief Fills the settings with the default values.
+ * 
+ * @param settings pointer to settings
+ */
+void default_settings(Settings *settings)
+{
+  memset(settings, 0, sizeof(Settings));
+  settings->durations[0] = STUDYDURATION;
+  settings->durations[1] = SHORTBREAKDURATION;
+  settings->durations[2] = LONGBREAKDURATION;
+  settings->durations[3] = STUDYSESSIONS;
+  settings->goal = STUDYGOAL;
 }
 
 /**
- * @brief Loads settings from file.
+ * @brief Loads settings from file, with a single pass.
+  Structure of the settings file:
+  - study duration
+  - short break duration
+  - long break duration
+  - study sessions
+  - optionally, "goal" followed by the study sessions planned for the day
+  - optionally, "cycle" followed by the description of the cycle
+  The settings are left untouched unless the file is valid.
  * 
- * @param durations pointer to array to hold the lines
+ * @param settings pointer to settings
  * @return int -1 if file does not exist, -2 if it's not valid, 0 if it's valid
  */
-int load_settings(int *durations)
+int load_settings(Settings *settings)
 {
   FILE *fp;
   char r_buffer[BUFLEN];
+  Settings loaded;
+  int ret;
 
   fp = fopen(SETTINGS_PATH, "r");
 
   if (fp == NULL)
     return -1;
 
-  // check if there are enough lines
-  if (file_count_lines(fp) < 4)
-    return -2;
+  // the missing lines keep the default values
+  default_settings(&loaded);
 
   // populate array with integers loaded from file
-  for (int i = 0; i < 4; i++)
+  ret = 0;
+  for (int i = 0; i < 4 && ret == 0; i++)
   {
-    file_read_line(r_buffer, BUFLEN, fp);
-    int val = atoi(r_buffer);
-    if (val == 0)
-    {
-      // atoi returns 0 if the number is not valid
-      // in that case, return
-      return -3;
-    }
-    *(durations + i) = val;
+    // atoi returns 0 if the number is not valid
+    if (file_read_line(r_buffer, BUFLEN, fp) == -1 || (loaded.durations[i] = atoi(r_buffer)) <= 0)
+      ret = -2;
+  }
+
+  // the other lines start with their name, unknown ones are skipped
+  while (ret == 0 && file_read_line(r_buffer, BUFLEN, fp) != -1)
+  {
+    if (strncmp(r_buffer, "goal ", 5) == 0 && atoi(r_buffer + 5) > 0)
+      loaded.goal = atoi(r_buffer + 5);
+    else if (strncmp(r_buffer, "cycle ", 6) == 0)
+      strncpy(loaded.cycle, r_buffer + 6, SCHEDULE_SPEC_SIZE - 1);
   }
 
   fclose(fp);
 
-  return 0;
+  if (ret == 0)
+    *settings = loaded;
+
+  return ret;
 }
 
 /**
  * @brief Save settings to file.
  * 
- * @param durations pointer to duration 
+ * @param settings pointer to settings
  * @return int -1 if file is not writeable, 0 otherwise
  */
-int save_settings(int *durations)
+int save_settings(Settings *settings)
 {
   FILE *fp;
-  char w_buffer[BUFLEN];
 
   fp = fopen(SETTINGS_PATH, "w");
   if (fp == NULL)
     return -1;
 
-  // save study duration
-  sprintf(w_buffer, "%i\n", *durations);
-  fputs(w_buffer, fp);
-
-  // save short break duration
-  sprintf(w_buffer, "%i\n", *(durations + 1));
-  fputs(w_buffer, fp);
+  // save durations and study sessions
+  for (int i = 0; i < 4; i++)
+    fprintf(fp, "%i\n", settings->durations[i]);
 
-  // save long break duration
-  sprintf(w_buffer, "%i\n", *(durations + 2));
-  fputs(w_buffer, fp);
+  // save the goal of the day
+  fprintf(fp, "goal %i\n", settings->goal);
 
-  // save study sessions
-  sprintf(w_buffer, "%i\n", *(durations + 3));
-  fputs(w_buffer, fp);
+  // save the cycle, if any
+  if (settings->cycle[0] != '\0')
+    fprintf(fp, "cycle %s\n", settings->cycle);
 
   fclose(fp);
 
   return 0;
 }
 
-/**
- * @brief Handler for CTRL+C.
- * 
- */
-void SIGINT_handler()
-{
-  sigint_called = 1;
-  return;
-}
-
-/**
- * @brief Handler for terminal resize.
- * 
- */
-void SIGWINCH_handler()
-{
-  sigwinch_called = 1;
-  return;
-}
-
 /**
  * @brief Returns time (milliseconds) since epoch
  * 
@@ -407,6 +489,18 @@ unsigned long long epoch()
   return ms_since_epoch;
 }
 
+/**
+ * @brief Returns time (milliseconds) of a monotonic clock.
+ * Unlike epoch(), it is not affected by changes of the system clock.
+ * The time is read from the clock in use, virtual while simulating.
+ * 
+ * @return unsigned long long 
+ */
+unsigned long long monotonic()
+{
+  return clock_monotonic();
+}
+
 /**
  * @brief Sleeps a set amount of time (milliseconds).
  * 
@@ -441,93 +535,146 @@ void s_sleep(int s)
   ms_sleep(s * 1000);
 }
 
+/**
+ * @brief Reads the settings passed as arguments:
+ * either the durations, or the description of the cycle such as "50/10x3 25/5 25/30".
+ * 
+ * @param settings pointer to the settings, left untouched if not valid
+ * @param argc 
+ * @param argv 
+ */
+void parse_arguments(Settings *settings, int argc, char *argv[])
+{
+  if (argc > 1 && strchr(argv[1], '/') != NULL)
+  {
+    char cycle[SCHEDULE_SPEC_SIZE] = {0};
+    Schedule schedule = {0};
+    int len = 0;
+
+    // the description might be split into many arguments
+    for (int i = 1; i < argc && len < SCHEDULE_SPEC_SIZE; i++)
+      len += snprintf(cycle + len, SCHEDULE_SPEC_SIZE - len, i > 1 ? " %s" : "%s", argv[i]);
+
+    // a truncated or invalid description is skipped
+    if (len < SCHEDULE_SPEC_SIZE && scheduleParse(&schedule, cycle) == 0)
+      memcpy(settings->cycle, cycle, SCHEDULE_SPEC_SIZE);
+
+    return;
+  }
+
+  for (int i = 1; i < argc && i < 5; i++)
+  {
+    int val = atoi(argv[i]);
+    if (val == 0 || val < 0)
+    {
+      // atoi does not check for validity, but returns 0 for invalid numbers
+      // skip negative values aswell
+      continue;
+    }
+    settings->durations[i - 1] = val;
+  }
+}
+
 /**
  * @brief Assigns all the variables needed to run the timer.
  * 
  * @param phases pointer to phases array
+ * @param schedule pointer to the schedule, compiled from the settings
  * @param argc 
  * @param argv 
- * @return Phase* current phase
  */
-Phase *init_phases(Phase *phases, int argc, char *argv[])
+void init_phases(Phase *phases, Schedule *schedule, int argc, char *argv[])
 {
-  // preload durations to default values
-  int durations[] = {
-      STUDYDURATION,
-      SHORTBREAKDURATION,
-      LONGBREAKDURATION,
-      STUDYSESSIONS,
-  };
+  Settings settings, saved;
+  int loaded;
+
+  // preload settings to default values
+  default_settings(&settings);
+
+  // the settings file is read once, and written only if it has to change
+  loaded = load_settings(&saved) == 0;
 
   if (argc > 1)
   {
-    // if arguments have been passed, load them
+    // if arguments have been passed, load them, the goal is kept
     if (strcmp(argv[1], "reset") != 0)
     {
-      for (int i = 1; i < argc && i < 5; i++)
-      {
-        int val = atoi(argv[i]);
-        if (val == 0 || val < 0)
-        {
-          // atoi does not check for validity, but returns 0 for invalid numbers
-          // skip negative values aswell
-          continue;
-        }
-        durations[i - 1] = val;
-      }
+      if (loaded)
+        settings.goal = saved.goal;
+      parse_arguments(&settings, argc, argv);
     }
   }
-  else if (check_settings() == 0)
+  else if (loaded)
   {
     // otherwise, just load from file
-    load_settings(durations);
+    settings = saved;
   }
 
-  save_settings(durations);
+  if (!loaded || memcmp(&settings, &saved, sizeof(Settings)) != 0)
+    save_settings(&settings);
+
+  create_phases(phases);
+  create_schedule(schedule, &settings);
+}
 
+/**
+ * @brief Creates the phases of the timer, one for each kind.
+ * Their durations are set by the schedule, as they are entered.
+ * 
+ * @param phases pointer to phases array
+ */
+void create_phases(Phase *phases)
+{
   // create array of phases
   phases[0] = (Phase){
-      .name = "study",
-      .id = 0,
-      .duration = durations[0],
-      .repetitions = durations[3],
-      .completed = 0,
+      .name = STUDY_NAME,
+      .id = SCHEDULE_STUDY,
+      .duration = 0,
       .started = 0,
+      .paused = 0,
       .is_study = 1,
-      .next = phases + 1,
-      .next_after = phases + 2,
       .fg_color = fg_RED,
       .bg_color = bg_DEFAULT,
   };
 
   phases[1] = (Phase){
-      .name = "short break",
-      .id = 1,
-      .duration = durations[1],
-      .repetitions = 0,
-      .completed = 0,
+      .name = SHORTBREAK_NAME,
+      .id = SCHEDULE_SHORTBREAK,
+      .duration = 0,
       .started = 0,
+      .paused = 0,
       .is_study = 0,
-      .next = phases,
       .fg_color = fg_GREEN,
       .bg_color = bg_DEFAULT,
   };
 
   phases[2] = (Phase){
-      .name = "long break",
-      .id = 2,
-      .duration = durations[2],
-      .repetitions = 0,
-      .completed = 0,
+      .name = LONGBREAK_NAME,
+      .id = SCHEDULE_LONGBREAK,
+      .duration = 0,
       .started = 0,
+      .paused = 0,
       .is_study = 0,
-      .next = phases,
       .fg_color = fg_GREEN,
       .bg_color = bg_DEFAULT,
   };
+}
+
+/**
+ * @brief Compiles the cycle of the phases.
+ * 
+ * @param schedule pointer to the schedule
+ * @param settings pointer to settings
+ */
+void create_schedule(Schedule *schedule, Settings *settings)
+{
+  const int *d = settings->durations;
 
-  phases->started = time(NULL);
-  return phases; // returns current phase
+  // the durations make the classic cycle, unless another one is described
+  if (settings->cycle[0] == '\0' || scheduleParse(schedule, settings->cycle) == -1)
+    scheduleDefault(schedule, d[0], d[1], d[2], d[3]);
+
+  schedule->goal = settings->goal;
 }
 
 /**
@@ -537,7 +684,8 @@ Phase *init_phases(Phase *phases, int argc, char *argv[])
  */
 Windows *init_windows()
 {
-  Window *w_phase, *w_total, *w_quote, *w_controls, *w_paused;
+  Window *w_phase, *w_total, *w_timers, *w_quote, *w_controls, *w_paused, *w_debug;
+  Bar *b_phase;
   Windows *w;
 
   // first, allocate space for the windows struct
@@ -557,6 +705,14 @@ Windows *init_windows()
   windowSetPadding(w_total, PADDING);
   windowSetFGcolor(w_total, fg_BRIGHT_YELLOW);
 
+  // window listing the countdowns, hidden while there are none
+  w_timers = createWindow(0, 0);
+  windowSetAlignment(w_timers, -1);
+  windowSetPadding(w_timers, PADDING);
+  windowSetAutoWidth(w_timers, 0);
+  windowSetFGcolor(w_timers, fg_BRIGHT_MAGENTA);
+  windowSetVisibility(w_timers, 0);
+
   // w_quote with... a quote
   w_quote = createWindow(0, Y_BORDER);
   windowSetAlignment(w_quote, 0);
@@ -564,7 +720,8 @@ Windows *init_windows()
   windowSetAutoWidth(w_quote, 0);
   windowSetFGcolor(w_quote, fg_BRIGHT_BLUE);
   windowSetTextStyle(w_quote, text_ITALIC);
-  place_random_quote(w_quote);
+  // shown once the quotes are loaded
+  windowSetVisibility(w_quote, 0);
 
   // window with info
   w_controls = createWindow(0, 0);
@@ -582,15 +739,51 @@ Windows *init_windows()
   windowSetAutoHeight(w_paused, 0);
   windowSetFGcolor(w_paused, fg_BRIGHT_RED);
   windowSetTextStyle(w_paused, text_BLINKING);
+  windowSetHeight(w_paused, 3);
   windowSetVisibility(w_paused, 0);
   windowAddLine(w_paused, "WARNING, TIMER IS CURRENTLY PAUSED");
 
+  // hidden window showing the instrumentation, toggled by D
+  w_debug = createWindow(0, 0);
+  windowSetAlignment(w_debug, -1);
+  windowSetPadding(w_debug, PADDING);
+  windowSetAutoWidth(w_debug, 0);
+  windowSetFGcolor(w_debug, fg_BRIGHT_BLACK);
+  windowSetVisibility(w_debug, 0);
+
+  // progress of the current phase, placed below w_phase
+  b_phase = createBar(0, 0);
+  barSetFGcolor(b_phase, fg_BRIGHT_BLACK);
+
   // assign the windows to the struct
   w->w_phase = w_phase;
   w->w_total = w_total;
+  w->w_timers = w_timers;
   w->w_quote = w_quote;
   w->w_controls = w_controls;
   w->w_paused = w_paused;
+  w->w_debug = w_debug;
+  w->b_phase = b_phase;
+
+  // the colors of the bar are computed once, the ramps are indexed by phase id
+  w->ramps[0] = createRamp(STUDY_HUE, BAR_END_HUE, BAR_RAMP_SIZE);
+  w->ramps[1] = createRamp(BREAK_HUE, BAR_END_HUE, BAR_RAMP_SIZE);
+  w->ramps[2] = createRamp(BREAK_HUE, BAR_END_HUE, BAR_RAMP_SIZE);
+
+  // w_phase and w_total side by side, the progress bar below w_phase,
+  // then all the other windows stacked, as wide as the first two
+  Layout *top, *phase;
+  w->layout = createLayout(layout_COLUMN, 0);
+  top = layoutAddLayout(w->layout, layout_ROW, 1);
+  phase = layoutAddLayout(top, layout_COLUMN, 0);
+  layoutAddWindow(phase, w_phase, 0);
+  layoutAddBar(phase, b_phase, 1);
+  layoutAddWindow(top, w_total, 0);
+  layoutAddWindow(w->layout, w_timers, 1);
+  layoutAddWindow(w->layout, w_quote, 1);
+  layoutAddWindow(w->layout, w_controls, 1);
+  layoutAddWindow(w->layout, w_paused, 1);
+  layoutAddWindow(w->layout, w_debug, 1);
 
   // return pointer to window
   return w;
@@ -599,10 +792,14 @@ Windows *init_windows()
 /**
  * @brief Inits parameters.
  * 
- * @param current_phase 
+ * @param phases phases of the timer, NULL if the timer is remote
+ * @param schedule cycle of the phases, NULL if the timer is remote
+ * @param windows 
+ * @param quotes 
+ * @param history 
  * @return Parameters* 
  */
-Parameters *init_parameters(Phase *current_phase, Windows *windows)
+Parameters *init_parameters(Phase *phases, Schedule *schedule, Windows *windows, QuoteIndex *quotes, History *history)
 {
   // allocate space for all parameters
   Parameters *p = malloc(sizeof(Parameters));
@@ -612,29 +809,71 @@ Parameters *init_parameters(Phase *current_phase, Windows *windows)
 
   // create windows
   p->windows = windows;
+  p->quotes = quotes;
+  p->history = history;
 
   // create tone
   p->tone = malloc(sizeof(Tone));
   p->tone->repetitions = 0;
   p->tone->speed = 0;
 
-  // create return values
-  p->return_values = malloc(sizeof(ReturnValues));
-  p->return_values->show_routine = 1;
-  p->return_values->advance_routine = 1;
-  p->return_values->save_routine = 1;
-  p->return_values->keypress_routine = 1;
+  // create the snapshot of the timer state
+  p->snapshot = createSnapshot();
+
+  // the instrumentation records only if asked to
+  p->stats = createStats(getenv(STATS_ENV) != NULL);
+
+  // the saves wait for the disk as asked, on changes of state by default
+  p->fsync = parse_fsync_policy(getenv(FSYNC_ENV));
+
+  // the notifications are started once the mode is known
+  p->notifier = NULL;
+
+  // nothing is scheduled until the time starts
+  p->timers = createTimers();
+
+  // the other devices are followed once the session is loaded
+  p->sync = NULL;
+
+  // the timer is local until attached to a remote one
+  p->headless = 0;
+  p->focused = 1;
+  p->simulated = 0;
+  p->remote = -1;
+  p->server = NULL;
+  p->transitions = 0;
+
+  // the quotes are loaded after the first frame
+  p->quote_pending = 1;
+  p->quote_id = -1;
+  p->quote_shown = -2;
 
   // init all other parameters
-  p->current_phase = current_phase;
+  p->current_phase = NULL;
+  p->phases = phases;
+  p->schedule = schedule;
+  p->entry = 0;
+  p->goal_left = -1;
   p->study_phases = 0;
   p->study_elapsed = 0;
   p->windows_force_reload = 1;
+  p->resize_due = 0;
   p->phase_elapsed = 0;
   p->study_elapsed = 0;
   p->previous_elapsed = 0;
   p->time_paused = 1;
-  p->frozen_elapsed = 0;
+  p->paused_at = 0;
+  p->save_pending = 0;
+  p->last_save = 0;
+  p->started = 0;
+
+  // no question is asked yet
+  p->dialog = NULL;
+  p->dialog_action = DIALOG_RESUME;
+
+  // the day starts from the first phase of the cycle
+  if (phases != NULL)
+    set_phase(p, 0);
 
   return p;
 }
@@ -646,6 +885,9 @@ Parameters *init_parameters(Phase *current_phase, Windows *windows)
  */
 void delete_parameters(Parameters *p)
 {
+  // stop the notifications, they use the terminal lock
+  deleteNotifier(p->notifier);
+
   // free memory and delete mutex
   pthread_mutex_destroy(p->terminal_lock);
   free(p->terminal_lock);
@@ -653,21 +895,83 @@ void delete_parameters(Parameters *p)
   // free memory and delete windows
   deleteWindow(p->windows->w_phase);
   deleteWindow(p->windows->w_total);
+  deleteWindow(p->windows->w_timers);
   deleteWindow(p->windows->w_quote);
   deleteWindow(p->windows->w_controls);
   deleteWindow(p->windows->w_paused);
+  deleteWindow(p->windows->w_debug);
+  deleteBar(p->windows->b_phase);
+  deleteLayout(p->windows->layout);
+  for (int i = 0; i < 3; i++)
+    deleteRamp(p->windows->ramps[i]);
   free(p->windows);
 
+  // free memory from quotes
+  deleteQuoteIndex(p->quotes);
+
+  // close history
+  deleteHistory(p->history);
+
   // free memory from tone
   free(p->tone);
 
-  // free memory from return values
-  free(p->return_values);
+  // the dialog might have been left unanswered
+  if (p->dialog != NULL)
+    deleteDialog(p->dialog);
+
+  // free memory from the snapshot
+  deleteSnapshot(p->snapshot);
+
+  // free memory from the instrumentation
+  deleteStats(p->stats);
+
+  // free memory from the deadlines
+  deleteTimers(p->timers);
+
+  // free memory from the cycle
+  deleteSchedule(p->schedule);
+
+  // close the logs shared with the other devices
+  deleteSync(p->sync);
+
+  // close the sockets
+  deleteServer(p->server);
+  clientClose(p->remote);
 
   // free memory from parameters
   free(p);
 }
 
+/**
+ * @brief Enters a phase of the cycle.
+ * 
+ * @param p pointer to parameters struct
+ * @param entry position of the phase in the cycle
+ */
+void set_phase(Parameters *p, int entry)
+{
+  const ScheduleEntry *e = p->schedule->entries + entry;
+
+  p->entry = entry;
+  p->current_phase = p->phases + e->phase_id;
+  p->current_phase->duration = e->duration;
+  update_forecast(p);
+}
+
+/**
+ * @brief Computes when the study phases planned for the day are completed,
+ * provided that no phase is paused nor skipped.
+ * Called only when the phase or the study phases change, never for a frame.
+ * 
+ * @param p pointer to parameters struct
+ */
+void update_forecast(Parameters *p)
+{
+  const int left = p->schedule->goal - p->study_phases;
+
+  p->goal_left = left > 0 ? scheduleUntilStudied(p->schedule, p->entry, left) : -1;
+}
+
 /**
  * @brief Resets current phase time.
  * 
@@ -675,7 +979,24 @@ void delete_parameters(Parameters *p)
  */
 void reset_current_time(Parameters *p)
 {
-  p->current_phase->started = time(NULL);
+  unsigned long long now = monotonic();
+
+  p->current_phase->started = now;
+  p->current_phase->paused = 0;
+  // if the time is paused, the new phase is paused from now on
+  p->paused_at = now;
+  schedule_phase(p);
+}
+
+/**
+ * @brief Schedules the end of the current phase along with the other deadlines.
+ * While paused, the phase has no deadline.
+ * 
+ * @param p pointer to parameters struct
+ */
+void schedule_phase(Parameters *p)
+{
+  timersSchedule(p->timers, TIMERS_PHASE, p->time_paused ? 0 : phase_deadline(p));
 }
 
 /**
@@ -685,7 +1006,20 @@ void reset_current_time(Parameters *p)
  */
 void start_time(Parameters *p)
 {
+  const int resumed = p->time_paused;
+
+  // the time spent paused does not count toward the phase
+  if (p->time_paused)
+  {
+    p->current_phase->paused += monotonic() - p->paused_at;
+    p->save_pending = 1;
+  }
+
   p->time_paused = 0;
+  schedule_phase(p);
+
+  if (resumed)
+    record_sync(p, SYNC_RESUME, p->phase_elapsed);
 }
 
 /**
@@ -695,71 +1029,138 @@ void start_time(Parameters *p)
  */
 void pause_time(Parameters *p)
 {
+  // already paused, keep the original pause time
+  if (p->time_paused)
+    return;
+
+  p->paused_at = monotonic();
   p->time_paused = 1;
-  p->frozen_elapsed = (time(NULL) - p->current_phase->started);
+  p->phase_elapsed = phase_elapsed_ms(p) / 1000;
+  p->save_pending = 1;
+  schedule_phase(p);
+  record_sync(p, SYNC_PAUSE, p->phase_elapsed);
 }
 
 /**
  * @brief Advances to next phase.
  * 
  * @param p pointer to parameters struct
+ * @param skipped 1 if the phase has been skipped by the user, 0 if it has ended
  */
-void next_phase(Parameters *p)
+void next_phase(Parameters *p, int skipped)
 {
-  pthread_t beep_thread;
-  pthread_create(&beep_thread, NULL, beep_async, p);
-  pthread_detach(beep_thread);
+  // a phase ending while another device leads is counted by that device
+  const int counted = skipped || p->sync == NULL || !syncFollowing(p->sync);
+  const int was_study = p->current_phase->is_study;
+
+  if (skipped)
+  {
+    // a single tone to acknowledge the skip
+    p->tone->speed = 10;
+    p->tone->repetitions = 1;
+  }
+  else if (p->current_phase->is_study)
+  {
+    // next phase is a pause, set tone accordingly
+    p->tone->speed = 3;
+    p->tone->repetitions = 3;
+  }
+  else
+  {
+    // the next phase is a study phase, set tone accordingly
+    p->tone->speed = 10;
+    p->tone->repetitions = 5;
+  }
 
-  // one phase has been completed
-  p->current_phase->completed++;
+  // record the phase into the history
+  if (p->history && counted)
+  {
+    historyAppend(p->history, (HistoryRecord){
+                                  .start = clock_time() - p->phase_elapsed,
+                                  .duration = p->phase_elapsed,
+                                  .phase_id = p->current_phase->id,
+                                  .flags = p->current_phase->is_study ? HISTORY_STUDY : 0,
+                              });
+  }
 
   // shall the phase count toward the maximum?
   // yes
-  if (p->current_phase->is_study)
+  if (p->current_phase->is_study && counted)
   {
     p->study_phases++;
     // update the total time until now
     p->previous_elapsed += p->phase_elapsed;
   }
 
-  // check if this phase must be repeated
-  if (p->current_phase->completed >= p->current_phase->repetitions && p->current_phase->repetitions)
-  {
-    // repetitions have ended
-    p->current_phase->completed = 0;
-    p->current_phase = p->current_phase->next_after;
-  }
-  else
-  {
-    // no repetitions or repetitions already finished
-    p->current_phase = p->current_phase->next;
-  }
+  // the completed phase is shared before the new one
+  if (p->sync != NULL && counted && was_study)
+    syncAppend(p->sync, SYNC_SESSION, 0, SCHEDULE_STUDY, p->entry, p->phase_elapsed, clock_time() - p->phase_elapsed);
+
+  // the cycle starts over after its last phase
+  set_phase(p, (p->entry + 1) % p->schedule->count);
 
   reset_current_time(p);
+  p->phase_elapsed = 0;
+  p->transitions++;
+  p->save_pending = 1;
+
+  if (counted)
+    record_sync(p, SYNC_PHASE, 0);
+
+  // the tone is read from the snapshot
+  publish_state(p);
+  notify_transition(p, skipped ? "skip" : "end");
 }
 
 /**
- * @brief Returns remaining time (seconds) in current phase
+ * @brief Returns elapsed time (milliseconds) in current phase, not counting pauses
  * 
  * @param p parameters pointer
- * @return int 
+ * @return unsigned long long 
  */
-int phase_time_remaining(Parameters *p)
+unsigned long long phase_elapsed_ms(Parameters *p)
 {
-  return p->current_phase->duration * 60 - (time(NULL) - p->current_phase->started);
+  unsigned long long now;
+
+  // while paused, time is stopped at the pause
+  now = p->time_paused ? p->paused_at : monotonic();
+  return now - p->current_phase->started - p->current_phase->paused;
 }
 
 /**
- * @brief Formats elapsed time.
+ * @brief Returns the time (monotonic milliseconds) when the current phase ends, provided it's not paused
  * 
- * @param buffer pointer to buffer string
- * @param elapsed elapsed time in seconds
+ * @param p parameters pointer
+ * @return unsigned long long 
  */
-void format_elapsed_time(char *buffer, int elapsed)
+unsigned long long phase_deadline(Parameters *p)
 {
-  int seconds, minutes, hours;
-  // unpack time into hours, minutes, seconds
-  hours = elapsed / 3600;
+  return p->current_phase->started + p->current_phase->paused +
+         (unsigned long long)p->current_phase->duration * 60000;
+}
+
+/**
+ * @brief Returns remaining time (seconds) in current phase
+ * 
+ * @param p parameters pointer
+ * @return int 
+ */
+int phase_time_remaining(Parameters *p)
+{
+  return p->current_phase->duration * 60 - phase_elapsed_ms(p) / 1000;
+}
+
+/**
+ * @brief Formats elapsed time.
+ * 
+ * @param buffer pointer to buffer string
+ * @param elapsed elapsed time in seconds
+ */
+void format_elapsed_time(char *buffer, int elapsed)
+{
+  int seconds, minutes, hours;
+  // unpack time into hours, minutes, seconds
+  hours = elapsed / 3600;
   minutes = (elapsed % 3600) / 60;
   seconds = elapsed % 60;
 
@@ -787,7 +1188,7 @@ void format_time_delta(char *buffer, int delta_seconds)
 {
   time_t now;
   struct tm tm;
-  now = time(NULL) + (time_t)delta_seconds;
+  now = clock_time() + (time_t)delta_seconds;
   tm = *localtime(&now);
   sprintf(buffer, "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
   return;
@@ -802,97 +1203,11 @@ void format_date(char *buffer)
 {
   time_t now;
   struct tm tm;
-  now = time(NULL);
+  now = clock_time();
   tm = *localtime(&now);
   sprintf(buffer, "%d-%02d-%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
 }
 
-/**
- * @brief Gets random quote and saves it into window.
- * 
- * @param w pointer to window
- * @return int -1 if file is not readable, 0 in case of success
- */
-int place_random_quote(Window *w)
-{
-  char r_buffer[BUFLEN], l_buffer[BUFLEN];
-  int rindex, count;
-  FILE *fp;
-
-  count = 0;
-  fp = fopen(QUOTES_PATH, "r");
-
-  if (fp == NULL)
-  {
-    // if the quotes file is somehow not found,
-    // add a gimmick quote to panel
-    windowAddLine(w, "God is dead and we killed him.");
-    windowAddLine(w, "~Harambe");
-    return -1;
-  }
-
-  // reset quotes window
-  windowDeleteAllLines(w);
-
-  // calculate the number of lines
-  const int quotes_num = file_count_lines(fp);
-  rindex = random() % quotes_num;
-
-  while (fgets(r_buffer, BUFLEN, fp) != NULL)
-  {
-
-    if (count == rindex)
-    {
-      int line_end;
-      // remove newline and find end
-      for (int i = 0; i < BUFLEN; i++)
-      {
-        if (r_buffer[i] == '\n')
-        {
-          line_end = i;
-          break;
-        }
-      }
-
-      // find author and remove it from string
-      int author_start;
-      for (int i = line_end; i >= 0; i--)
-      {
-        if (r_buffer[i] == '@')
-        {
-          author_start = i + 1;
-          break;
-        }
-      }
-
-      // copy quote to buffer
-      for (int i = 0; i < author_start - 1; i++)
-        l_buffer[i] = r_buffer[i];
-      l_buffer[author_start - 1] = '\0';
-
-      // copy quote into destination
-      windowAddLine(w, l_buffer);
-
-      // copy author to buffer
-      for (int i = author_start; i < line_end; i++)
-      {
-        l_buffer[i - author_start] = r_buffer[i];
-      }
-      l_buffer[line_end - author_start] = '\0';
-      // copy author into destination
-      windowAddLine(w, l_buffer);
-
-      break;
-    }
-
-    count++;
-  }
-
-  fclose(fp);
-
-  return 0;
-}
-
 /* hides/shows all windows on screen */
 /**
  * @brief Sets the windows visibility.
@@ -907,494 +1222,1848 @@ void set_windows_visibility(Parameters *p, int visibility)
   windowSetVisibility(p->windows->w_total, visibility);
   windowSetVisibility(p->windows->w_quote, visibility);
   windowSetVisibility(p->windows->w_paused, visibility);
+  barSetVisibility(p->windows->b_phase, visibility);
 }
 
 /**
- * @brief Async beeping.
+ * @brief Publishes the timer state, so that it can be read without locks.
+ * Must be called only by the event loop.
  * 
- * @param args 
- * @return void* 
+ * @param p pointer to parameters
  */
-void *beep_async(void *args)
+void publish_state(Parameters *p)
 {
-  Parameters *p = args;
-  const int delay = (1 - p->tone->speed / 10.0) * 700 + 300;
-  for (int i = 0; i < p->tone->repetitions; i++)
-  {
-    pthread_mutex_lock(p->terminal_lock);
-    terminal_beep();
-    pthread_mutex_unlock(p->terminal_lock);
-    ms_sleep(delay);
-  }
-  pthread_exit(0);
+  const ScheduleEntry *entry = p->schedule->entries + p->entry;
+  TimerState state;
+  unsigned long long elapsed_ms;
+
+  elapsed_ms = phase_elapsed_ms(p);
+
+  state = (TimerState){
+      .phase_id = p->current_phase->id,
+      .phase_duration = p->current_phase->duration,
+      .phase_completed = entry->studied,
+      .phase_repetitions = p->current_phase->is_study ? p->schedule->sessions : 0,
+      .phase_is_study = p->current_phase->is_study,
+      .phase_fg_color = p->current_phase->fg_color,
+      .phase_elapsed = elapsed_ms / 1000,
+      .phase_remaining = phase_time_remaining(p),
+      .study_elapsed = p->study_elapsed,
+      .study_phases = p->study_phases,
+      .goal_remaining = p->goal_left == -1 ? -1 : p->goal_left - (int)(elapsed_ms / 1000),
+      .time_paused = p->time_paused,
+      .deadline = p->time_paused ? 0 : phase_deadline(p),
+      .quote_id = p->quote_id,
+      .transitions = p->transitions,
+      .tone_repetitions = p->tone->repetitions,
+      .tone_speed = p->tone->speed,
+  };
+
+  strncpy(state.phase_name, p->current_phase->name, SNAPSHOT_NAME_SIZE - 1);
+  state.phase_name[SNAPSHOT_NAME_SIZE - 1] = '\0';
+
+  snapshotPublish(p->snapshot, &state);
 }
 
 /**
- * @brief Routine handling terminal output.
+ * @brief Sends a command to the remote timer, publishing the state it returns.
  * 
- * @param args 
- * @return void* 
+ * @param p pointer to parameters
+ * @param command command to send
+ * @return int -1 if the remote timer is gone, 1 if it has not answered in time or not with a state, 0 otherwise
  */
-void *show_routine(void *args)
+int send_command(Parameters *p, char *command)
 {
-  Parameters *p = args;
-  unsigned long long last_updated = 0;
+  char response[IPC_MESSAGE_SIZE];
+  TimerState state, old_state;
+  int transition, len;
 
-  while (p->loop)
-  {
+  if ((len = clientRequest(p->remote, command, response, IPC_MESSAGE_SIZE)) <= 0)
+    return len == 0 ? 1 : -1;
 
-    // update 4 times a second
-    if (epoch() - last_updated > 250)
-    {
-      last_updated = epoch();
+  if (ipcParseState(response, &state) != 0)
+    return 1;
 
-      char buffer[BUFLEN];
-      char num_buffer[BUFLEN];
+  snapshotRead(p->snapshot, &old_state);
 
-      // remove old lines
-      windowDeleteAllLines(p->windows->w_phase);
-      windowDeleteAllLines(p->windows->w_total);
+  // the first answer is never a transition
+  transition = p->quote_shown != -2 && state.transitions != p->transitions;
+  if (transition || state.time_paused != old_state.time_paused)
+    p->windows_force_reload = 1;
 
-      // update windows color
-      windowSetFGcolor(p->windows->w_phase, p->current_phase->fg_color);
+  p->transitions = state.transitions;
+  snapshotPublish(p->snapshot, &state);
 
-      // first line of phase window
-      if (p->current_phase->repetitions > 0)
-        sprintf(buffer, "current phase: %s [%i/%i]", p->current_phase->name, p->current_phase->completed + 1, p->current_phase->repetitions);
-      else
-        sprintf(buffer, "current phase: %s", p->current_phase->name);
-      windowAddLine(p->windows->w_phase, buffer);
-
-      // second line of phase window
-      sprintf(buffer, "phase duration: %i minutes", p->current_phase->duration);
-      windowAddLine(p->windows->w_phase, buffer);
-
-      // format time
-      format_elapsed_time(num_buffer, p->phase_elapsed);
-      // third line of phase window
-      sprintf(buffer, "elapsed time: %s", num_buffer);
-      windowAddLine(p->windows->w_phase, buffer);
-
-      // first line of w_total
-      sprintf(buffer, "total study sessions: %i", p->study_phases);
-      windowAddLine(p->windows->w_total, buffer);
-
-      // second line of w_total
-      format_elapsed_time(num_buffer, p->study_elapsed);
-      sprintf(buffer, "total time studied: %s", num_buffer);
-      windowAddLine(p->windows->w_total, buffer);
-
-      // third line of w_total
-      int time_remaining = phase_time_remaining(p);
-      format_time_delta(num_buffer, time_remaining);
-      sprintf(buffer, "phase ending: %s", num_buffer);
-      windowAddLine(p->windows->w_total, buffer);
-
-      // wait for exclusive terminal use
-      pthread_mutex_lock(p->terminal_lock);
-      windowShow(p->windows->w_phase);
-      windowShow(p->windows->w_total);
-      pthread_mutex_unlock(p->terminal_lock);
-    }
+  if (transition)
+    notify_transition(p, "end");
 
-    if (p->windows_force_reload)
-    {
-      // get largest window
-      int largest, terminal_width, dx;
-      largest = windowGetSize(p->windows->w_phase).width + windowGetSize(p->windows->w_total).width + 1;
-      // now get terminal width
-      terminal_width = get_terminal_size().width;
-      // now calculate displacement
-      dx = (terminal_width - largest) / 2;
-
-      // set position of w_phase
-      windowSetPosition(p->windows->w_phase, dx, Y_BORDER);
-      // set position of w_total
-      windowSetPosition(p->windows->w_total, windowGetBottomRight(p->windows->w_phase).x + 1, Y_BORDER);
-      windowAutoResize(p->windows->w_total); // trigger resize to get the actual width
-
-      Position total_br_corner = windowGetBottomRight(p->windows->w_total);
-      // set position of w_quote
-      windowSetPosition(p->windows->w_quote, dx, total_br_corner.y);
-      windowSetSize(p->windows->w_quote, total_br_corner.x - dx, 4);
-      windowAutoResize(p->windows->w_quote); // trigger resize to get the actual width
-
-      Position quotes_br_corner = windowGetBottomRight(p->windows->w_quote);
-      // set position of w_controls
-      windowSetPosition(p->windows->w_controls, dx, quotes_br_corner.y);
-      windowSetWidth(p->windows->w_controls, total_br_corner.x - dx);
-      windowAutoResize(p->windows->w_controls); // trigger resize to get the actual width
-
-      // now set position of w_paused
-      if (windowGetVisibility(p->windows->w_controls))
-      {
-        // since info window is visible, get its position
-        Position info_br_corner = windowGetBottomRight(p->windows->w_controls);
-        windowSetPosition(p->windows->w_paused, dx, info_br_corner.y);
-      }
-      else
-      {
-        // otherwise, place below quotes
-        windowSetPosition(p->windows->w_paused, dx, quotes_br_corner.y);
-      }
+  return 0;
+}
 
-      windowSetWidth(p->windows->w_paused, quotes_br_corner.x - dx);
-      windowSetHeight(p->windows->w_paused, 3);
-      windowSetVisibility(p->windows->w_paused, p->time_paused);
+/**
+ * @brief Handles a request received on the socket.
+ * 
+ * @param args pointer to parameters
+ * @param request NUL terminated request
+ * @param response destination buffer
+ * @param size size of the buffer
+ * @return int length of the response
+ */
+int handle_request(void *args, char *request, char *response, int size)
+{
+  Parameters *p = args;
+  TimerState state;
 
-      // wait for exclusive use of terminal
-      pthread_mutex_lock(p->terminal_lock);
-      // clear terminal
-      clear_terminal();
+  if (!session_started(p) && strcmp(request, "status") != 0)
+  {
+    // today's session might still be resumed
+    int len = snprintf(response, size, "ERR session not started");
+    return len < size ? len : size - 1;
+  }
 
-      // display all
-      windowShow(p->windows->w_phase);
-      windowShow(p->windows->w_total);
-      windowShow(p->windows->w_quote);
-      windowShow(p->windows->w_controls);
-      windowShow(p->windows->w_paused);
+  if (strcmp(request, "pause") == 0)
+  {
+    pause_time(p);
+  }
+  else if (strcmp(request, "resume") == 0)
+  {
+    start_time(p);
+  }
+  else if (strcmp(request, "toggle") == 0)
+  {
+    if (!p->time_paused)
+      pause_time(p);
+    else
+      start_time(p);
+  }
+  else if (strcmp(request, "skip") == 0)
+  {
+    next_phase(p, 1);
+  }
+  else if (strcmp(request, "quote") == 0)
+  {
+    p->quote_id = quoteIndexPick(p->quotes);
+  }
+  else if (strncmp(request, "timer", 5) == 0)
+  {
+    // the countdowns have their own response
+    return handle_timer_request(p, request, response, size);
+  }
+  else if (strcmp(request, "status") != 0)
+  {
+    int len = snprintf(response, size, "ERR unknown command");
+    return len < size ? len : size - 1;
+  }
 
-      // unlock terminal
-      pthread_mutex_unlock(p->terminal_lock);
+  // the state might have changed
+  if (strcmp(request, "status") != 0)
+    p->windows_force_reload = 1;
 
-      // reset flag
-      p->windows_force_reload = 0;
-    }
+  update_time(p);
+  publish_state(p);
+  snapshotRead(p->snapshot, &state);
 
-    // idle
-    ms_sleep(SLEEP_INTERVAL);
-  }
-  p->return_values->show_routine = 0;
-  pthread_exit(0);
+  return ipcFormatState(response, size, &state);
 }
 
 /**
- * @brief Routine handling time.
+ * @brief Formats the list of the countdowns, one per line after "OK".
+ * Each line holds the seconds left, 1 if paused or 0 if running, and the name.
+ * Countdowns that do not fit are left out.
  * 
- * @param args 
- * @return void* 
+ * @param p pointer to parameters
+ * @param buffer destination buffer
+ * @param size size of the buffer
+ * @return int length of the list
  */
-void *advance_routine(void *args)
+int format_timers(Parameters *p, char *buffer, int size)
 {
-  Parameters *p = args;
-  while (p->loop)
+  const unsigned long long now = monotonic();
+  int len;
+
+  len = snprintf(buffer, size, "OK");
+
+  for (int i = TIMERS_PHASE + 1; i < TIMERS_SIZE && len < size; i++)
   {
-    if (p->time_paused)
-    {
-      // stall elapsed time
-      p->current_phase->started = time(NULL) - p->frozen_elapsed;
-    }
-    else
-    {
-      int phase_elapsed;
-      // calculate seconds elapsed
-      phase_elapsed = time(NULL) - p->current_phase->started;
-
-      // second line of w_total, total time spent studying
-      int total_elapsed = 0;
-      // add current session to total time if it's a study session
-      if (p->current_phase->is_study)
-      {
-        total_elapsed = phase_elapsed;
-        // next phase is a study phase, set tone accordingly
-        p->tone->speed = 3;
-        p->tone->repetitions = 3;
-      }
-      else
-      {
-        // the next phase is a pause, set tone accordingly
-        p->tone->speed = 10;
-        p->tone->repetitions = 5;
-      }
+    const Countdown *c = p->timers->countdowns + i;
+    int line;
 
-      // update the parameters struct
-      // time in the current phase
-      p->phase_elapsed = phase_elapsed;
-      // total time studied today, until this very moment
-      p->study_elapsed = total_elapsed + p->previous_elapsed;
+    if (!c->active)
+      continue;
 
-      if (phase_elapsed / 60 >= p->current_phase->duration)
-      {
-        // phase has been completed
-        // go to next
-        next_phase(p);
-        // load a new quote
-        place_random_quote(p->windows->w_quote);
-        // force windows reload
-        p->windows_force_reload = 1;
-      }
+    line = snprintf(buffer + len, size - len, "\n%i %i %s", timersRemaining(p->timers, i, now), c->deadline == 0, c->name);
+    if (line >= size - len)
+    {
+      // drop the truncated line
+      buffer[len] = '\0';
+      break;
     }
-
-    ms_sleep(SLEEP_INTERVAL);
+    len += line;
   }
-  p->return_values->advance_routine = 0;
-  pthread_exit(0);
+
+  return len;
 }
 
 /**
- * @brief Routing handling periodic saves.
+ * @brief Handles a request about the countdowns:
+ * "timer" lists them, "timer start MINUTES NAME" starts (or restarts) one,
+ * "timer toggle NAME" pauses or resumes one and "timer cancel NAME" stops it.
  * 
- * @param args 
- * @return void* 
+ * @param p pointer to parameters
+ * @param request NUL terminated request, starting with "timer"
+ * @param response buffer of the response
+ * @param size size of the buffer
+ * @return int length of the response
  */
-void *save_routine(void *args)
+int handle_timer_request(Parameters *p, char *request, char *response, int size)
 {
-  Parameters *p = args;
-  unsigned long long last_save = 0;
-  while (p->loop)
-  {
+  const unsigned long long now = monotonic();
+  char *error = NULL;
+  int minutes, offset, ret;
 
-    if (epoch() - last_save > SAVEINTERVAL)
-    {
-      save_savefile(p);
-      last_save = epoch();
-    }
+  offset = 0;
+  if (sscanf(request, "timer start %d %n", &minutes, &offset) == 1 && offset > 0 && request[offset] != '\0')
+  {
+    if (minutes <= 0 || timersStart(p->timers, request + offset, minutes * 60, now) == -1)
+      error = "ERR cannot start the timer";
+  }
+  else if (strncmp(request, "timer toggle ", 13) == 0)
+  {
+    if (timersToggle(p->timers, timersFind(p->timers, request + 13), now) == -1)
+      error = "ERR unknown timer";
+  }
+  else if (strncmp(request, "timer cancel ", 13) == 0)
+  {
+    if (timersCancel(p->timers, timersFind(p->timers, request + 13)) == -1)
+      error = "ERR unknown timer";
+  }
+  else if (strcmp(request, "timer") != 0)
+  {
+    error = "ERR unknown command";
+  }
 
-    ms_sleep(SLEEP_INTERVAL);
+  if (error != NULL)
+  {
+    ret = snprintf(response, size, "%s", error);
+    return ret < size ? ret : size - 1;
   }
 
-  p->return_values->save_routine = 0;
-  pthread_exit(0);
+  // the list of the countdowns might have changed
+  if (strcmp(request, "timer") != 0)
+    p->windows_force_reload = 1;
+
+  return format_timers(p, response, size);
 }
 
 /**
- * @brief Routine handling keypresses.
+ * @brief Handles the timers whose deadline has passed.
+ * The end of the phase is handled by update_time(), ended countdowns are notified.
  * 
- * @param args 
- * @return void* 
+ * @param p pointer to parameters
  */
-void *keypress_routine(void *args)
+void expire_timers(Parameters *p)
 {
-  Parameters *p = args;
+  int id;
 
-  while (p->loop)
+  while ((id = timersPop(p->timers, monotonic())) != -1)
   {
-    if (sigint_called)
-    {
-      sigint_called = 0;
-
-      // hide all windows
-      // wait for exclusive use of terminal
-      pthread_mutex_lock(p->terminal_lock);
-      set_windows_visibility(p, 0);
-      // unlock terminal
-      pthread_mutex_unlock(p->terminal_lock);
-
-      Dialog *d;
-      int ret;
-
-      d = createDialog(0, Y_BORDER);
-      dialogSetPadding(d, 4);
-      dialogSetText(d, "Exit pomodoro?", 1);
-      dialogCenter(d, 1, 0);
-      dialogShow(d);
-      ret = dialogWaitResponse(d);
-      dialogClear(d);
-      deleteDialog(d);
-
-      if (ret == 1)
-      {
-        p->loop = 0;
-      }
-      else
-      {
-        // show windows again
-        // wait for exclusive use of terminal
-        pthread_mutex_lock(p->terminal_lock);
-        set_windows_visibility(p, 1);
-        // unlock terminal
-        pthread_mutex_unlock(p->terminal_lock);
-
-        p->windows_force_reload = 1;
-      }
-    }
-    else if (sigwinch_called)
-    {
-      // terminal has been resized
-      sigwinch_called = 0;
-      p->windows_force_reload = 1;
-    }
+    if (id == TIMERS_PHASE)
+      continue;
 
-    char key;
-    // wait for exclusive use of terminal
-    pthread_mutex_lock(p->terminal_lock);
-    key = poll_keypress();
-    // unlock terminal
-    pthread_mutex_unlock(p->terminal_lock);
+    // the name is kept after the countdown is freed
+    if (p->notifier != NULL)
+      notifierPush(p->notifier, COUNTDOWN_TONES, COUNTDOWN_SPEED, "timer", p->timers->countdowns[id].name);
 
-    // transform to lower case
-    if (key >= 65 && key <= 90)
-      key += 32;
+    p->windows_force_reload = 1;
+  }
+}
 
-    if (key == 'p')
-    {
-      if (!p->time_paused)
-        pause_time(p);
-      else
-        start_time(p);
+/**
+ * @brief Waits for exclusive use of the terminal, recording the time spent waiting.
+ * 
+ * @param p pointer to parameters
+ */
+void lock_terminal(Parameters *p)
+{
+  unsigned long long start;
 
-      // force windows refresh
-      p->windows_force_reload = 1;
-    }
-    else if (key == 's')
-    {
-      // hide all windows
-      // wait for exclusive use of terminal
-      pthread_mutex_lock(p->terminal_lock);
-      set_windows_visibility(p, 0);
-      // unlock terminal
-      pthread_mutex_unlock(p->terminal_lock);
-
-      // pause time so phases does not elapse
-      // while dialog is shown
-      pause_time(p);
+  start = statsStart(p->stats);
+  pthread_mutex_lock(p->terminal_lock);
+  // the histogram is protected by the lock itself
+  statsRecord(p->stats, &p->stats->lock_wait, start);
+}
 
-      Dialog *d;
-      int ret;
-
-      d = createDialog(0, Y_BORDER);
-      dialogSetPadding(d, 4);
-      dialogSetText(d, "Do you want to skip the current session?", 1);
-      dialogCenter(d, 1, 0);
-      dialogShow(d);
-      ret = dialogWaitResponse(d);
-      dialogClear(d);
-      deleteDialog(d);
-
-      if (ret)
-      { // load stats from file
-        next_phase(p);
-      }
+/**
+ * @brief Queues the notification of the last phase transition, without blocking.
+ * The tone is read from the snapshot, so that the remote transitions are notified too.
+ * 
+ * @param p pointer to parameters
+ * @param event what happened, passed to the hook
+ */
+void notify_transition(Parameters *p, char *event)
+{
+  TimerState state;
+
+  if (p->notifier == NULL)
+    return;
 
-      // show windows again
-      // wait for exclusive use of terminal
-      pthread_mutex_lock(p->terminal_lock);
-      clear_terminal();
-      set_windows_visibility(p, 1);
-      // unlock terminal
-      pthread_mutex_unlock(p->terminal_lock);
+  snapshotRead(p->snapshot, &state);
+  notifierPush(p->notifier, state.tone_repetitions, state.tone_speed, event, state.phase_name);
+}
 
-      // restart time
-      start_time(p);
-      // update flags
-      p->windows_force_reload = 1;
-      // reset tone
-      p->tone->repetitions = 1;
-    }
-    else if (key == 'q')
-    {
-      // make a new quote
-      place_random_quote(p->windows->w_quote);
-      p->windows_force_reload = 1;
-    }
-    else if (key == 'i')
-    {
-      // show/hide visibility of commands panel
-      windowToggleVisibility(p->windows->w_controls);
-      p->windows_force_reload = 1;
-    }
+/**
+ * @brief Starts following the other devices, if a shared directory is set.
+ * Their logs are read in full, so that today's session continues from the latest state
+ * written by any device, along with the study phases they have completed.
+ * Today's totals are then rebuilt from the history of this device and the logs of the others,
+ * whether the save has been resumed or not.
+ * 
+ * @param p pointer to parameters
+ */
+void start_sync(Parameters *p)
+{
+  char name[SYNC_NAME_SIZE];
+  const char *dir = getenv(SYNC_ENV);
+  const char *device = getenv(DEVICE_ENV);
+  HistoryDay *today;
+
+  // the totals of this device are known only through the history
+  if (dir == NULL || p->history == NULL)
+    return;
 
-    ms_sleep(SLEEP_INTERVAL);
+  if (device == NULL)
+  {
+    if (gethostname(name, SYNC_NAME_SIZE) != 0)
+      return;
+    name[SYNC_NAME_SIZE - 1] = '\0';
+    device = name;
   }
 
-  p->return_values->keypress_routine = 0;
-  pthread_exit(0);
+  p->sync = createSync(dir, device);
+  if (p->sync == NULL)
+    return;
+
+  // the saved totals include the other devices, which are read again from their logs
+  today = historyGetDay(p->history, historyDayNumber(clock_time()));
+  p->study_phases = today ? today->study_sessions : 0;
+  p->previous_elapsed = today ? today->study_seconds : 0;
+
+  syncPoll(p->sync, handle_sync, p);
+  update_forecast(p);
 }
 
 /**
- * @brief Checks if routine have ended
+ * @brief Shares a change of state with the other devices.
  * 
  * @param p pointer to parameters
- * @return int 
+ * @param type type of the change, SYNC_PHASE, SYNC_PAUSE or SYNC_RESUME
+ * @param elapsed seconds elapsed in the phase
  */
-int check_routines(Parameters *p)
+void record_sync(Parameters *p, int type, int elapsed)
 {
-  //* this is quite ugly
-  return p->return_values->show_routine || p->return_values->advance_routine || p->return_values->save_routine || p->return_values->keypress_routine;
+  if (p->sync == NULL)
+    return;
+
+  syncAppend(p->sync, type, p->time_paused ? SYNC_PAUSED : 0, p->current_phase->id, p->entry, elapsed, clock_time());
 }
 
-int main(int argc, char *argv[])
+/**
+ * @brief Moves to the state written by another device.
+ * The phase is looked up in the cycle by position, or by id if the cycles differ.
+ * 
+ * @param p pointer to parameters
+ * @param record pointer to the state record
+ */
+void follow_sync(Parameters *p, SyncRecord *record)
 {
-  // init random seed
-  srand(time(NULL));
+  int entry = record->entry;
+  long long elapsed = record->value;
 
-  // set raw mode
-  enter_raw_mode();
+  if (entry < 0 || entry >= p->schedule->count || p->schedule->entries[entry].phase_id != record->phase_id)
+    entry = scheduleFind(p->schedule, record->phase_id, -1);
 
-  // declare variables
-  pthread_t show_thread, advance_thread, save_thread, keypress_thread;
-  Phase phases[3], *current_phase;
-  Windows *windows;
-  Parameters *p;
+  if (entry == -1)
+    return;
 
-  // init phases, provide argv and argc to handle command line parsing
-  current_phase = init_phases(phases, argc, argv);
-  // init windows
-  windows = init_windows();
+  // the time kept running since, on the other device
+  if (!(record->flags & SYNC_PAUSED) && clock_time() > record->time)
+    elapsed += clock_time() - record->time;
 
-  // pack the parameters
-  p = init_parameters(current_phase, windows);
+  set_phase(p, entry);
+  p->time_paused = (record->flags & SYNC_PAUSED) != 0;
+  p->phase_elapsed = elapsed;
 
-  // prepare terminal
-  clear_terminal();
-  hide_cursor();
+  reset_current_time(p);
+  p->current_phase->started -= (unsigned long long)elapsed * 1000;
+  schedule_phase(p);
 
-  // check if a previous file session is available
-  if (check_savefile() == 1)
-  {
-    Dialog *d;
-    int ret;
+  p->save_pending = 1;
+  p->windows_force_reload = 1;
+}
+
+/**
+ * @brief Handles a record written by another device, only if it's about today.
+ * 
+ * @param args pointer to parameters
+ * @param record pointer to the record
+ */
+void handle_sync(void *args, SyncRecord *record)
+{
+  Parameters *p = args;
 
-    d = createDialog(0, Y_BORDER);
-    dialogSetPadding(d, 4);
-    dialogSetText(d, "Previous session found. Continue?", 1);
-    dialogCenter(d, 1, 0);
-    dialogShow(d);
-    ret = dialogWaitResponse(d);
-    dialogClear(d);
-    deleteDialog(d);
+  if (historyDayNumber(record->time) != historyDayNumber(clock_time()))
+    return;
 
-    // load stats from file
-    if (ret)
-      load_savefile(p, phases);
+  if (record->type != SYNC_SESSION)
+  {
+    follow_sync(p, record);
+    return;
   }
 
-  // handle signal interrupt
-  signal(SIGINT, SIGINT_handler);
-  // handle terminal resize
-  signal(SIGWINCH, SIGWINCH_handler);
-
-  // setup callback flags
-  sigint_called = 0;
-  sigwinch_called = 0;
+  // a study phase completed on another device
+  p->study_phases++;
+  p->previous_elapsed += record->value;
+  p->save_pending = 1;
+  update_forecast(p);
+}
 
-  //start the loop
-  p->loop = 1;
+/**
+ * @brief Updates the text of the timer windows and draws them.
+ * If the layout has to be reloaded, all the windows are placed and drawn again.
+ * 
+ * @param p pointer to parameters
+ */
+void draw_windows(Parameters *p)
+{
+  char buffer[BUFLEN];
+  char num_buffer[BUFLEN];
+  const int ramps = sizeof(p->windows->ramps) / sizeof(p->windows->ramps[0]);
+  unsigned long long build_start, flush_start;
+  TimerState state;
 
-  // spawn threads
-  pthread_create(&show_thread, NULL, show_routine, (void *)p);
-  pthread_create(&advance_thread, NULL, advance_routine, (void *)p);
-  pthread_create(&save_thread, NULL, save_routine, (void *)p);
-  pthread_create(&keypress_thread, NULL, keypress_routine, (void *)p);
+  build_start = statsStart(p->stats);
 
-  reset_current_time(p);
-  start_time(p);
+  // consistent copy of the timer state
+  snapshotRead(p->snapshot, &state);
 
-  // Main thread IDLE
-  while (check_routines(p))
+  // a new quote has been picked
+  if (!p->quote_pending && state.quote_id != p->quote_shown)
   {
-    ms_sleep(SLEEP_INTERVAL);
+    quoteIndexPlace(p->quotes, state.quote_id, p->windows->w_quote);
+    p->quote_shown = state.quote_id;
+    p->windows_force_reload = 1;
   }
 
-  // clean up
-  delete_parameters(p);
+  // remove old lines
+  windowDeleteAllLines(p->windows->w_phase);
+  windowDeleteAllLines(p->windows->w_total);
 
-  // reset all terminal
-  exit_raw_mode();
-  reset_styles();
-  clear_terminal();
-  show_cursor();
+  // update windows color
+  windowSetFGcolor(p->windows->w_phase, state.phase_fg_color);
+
+  // fill the progress bar, with the colors of the phase
+  // the state of a remote timer is not trusted: unknown phases get the text color, empty ones no progress
+  barSetRamp(p->windows->b_phase, state.phase_id >= 0 && state.phase_id < ramps ? p->windows->ramps[state.phase_id] : NULL, BAR_RAMP_SIZE);
+  barSetProgress(p->windows->b_phase, state.phase_duration > 0 ? (double)state.phase_elapsed / (state.phase_duration * 60) : 0);
+
+  // first line of phase window
+  if (state.phase_repetitions > 0)
+    sprintf(buffer, "current phase: %s [%i/%i]", state.phase_name, state.phase_completed + 1, state.phase_repetitions);
+  else
+    sprintf(buffer, "current phase: %s", state.phase_name);
+  windowAddLine(p->windows->w_phase, buffer);
+
+  // second line of phase window
+  sprintf(buffer, "phase duration: %i minutes", state.phase_duration);
+  windowAddLine(p->windows->w_phase, buffer);
+
+  // format time
+  format_elapsed_time(num_buffer, state.phase_elapsed);
+  // third line of phase window
+  sprintf(buffer, "elapsed time: %s", num_buffer);
+  windowAddLine(p->windows->w_phase, buffer);
+
+  // first line of w_total
+  sprintf(buffer, "total study sessions: %i", state.study_phases);
+  windowAddLine(p->windows->w_total, buffer);
+
+  // second line of w_total
+  format_elapsed_time(num_buffer, state.study_elapsed);
+  sprintf(buffer, "total time studied: %s", num_buffer);
+  windowAddLine(p->windows->w_total, buffer);
+
+  // third line of w_total
+  format_time_delta(num_buffer, state.phase_remaining);
+  sprintf(buffer, "phase ending: %s", num_buffer);
+  windowAddLine(p->windows->w_total, buffer);
+
+  // fourth line of w_total, when the study phases of the day are completed
+  if (state.goal_remaining == -1)
+    sprintf(num_buffer, "goal reached");
+  else
+    format_time_delta(num_buffer, state.goal_remaining);
+  sprintf(buffer, "day ending: %s", num_buffer);
+  windowAddLine(p->windows->w_total, buffer);
+
+  // one line for each countdown, only known to the process owning them
+  windowDeleteAllLines(p->windows->w_timers);
+  for (int i = TIMERS_PHASE + 1; i < TIMERS_SIZE; i++)
+  {
+    const Countdown *c = p->timers->countdowns + i;
+    if (!c->active)
+      continue;
+
+    format_elapsed_time(num_buffer, timersRemaining(p->timers, i, monotonic()));
+    sprintf(buffer, "%s: %s%s", c->name, num_buffer, c->deadline == 0 ? " (paused)" : "");
+    windowAddLine(p->windows->w_timers, buffer);
+  }
+  windowSetVisibility(p->windows->w_timers, timersCount(p->timers) > 0);
+
+  // wait for exclusive terminal use
+  lock_terminal(p);
+
+  // the counters are read under the lock, like the beeping threads write them
+  if (windowGetVisibility(p->windows->w_debug))
+    statsPlace(p->stats, p->windows->w_debug);
+
+  windowSetVisibility(p->windows->w_paused, state.time_paused);
+
+  // windows are moved only if their size or the size of the terminal changed
+  if (layoutSolve(p->windows->layout, Y_BORDER))
+    p->windows_force_reload = 1;
+
+  if (p->windows_force_reload)
+  {
+    // empty the frame, only the cells that changed reach the terminal
+    clear_terminal();
+
+    // windows whose content changes only along with the layout
+    windowShow(p->windows->w_quote);
+    windowShow(p->windows->w_controls);
+    windowShow(p->windows->w_paused);
+
+    // reset flag
+    p->windows_force_reload = 0;
+  }
+
+  windowShow(p->windows->w_phase);
+  windowShow(p->windows->w_total);
+  windowShow(p->windows->w_timers);
+  windowShow(p->windows->w_debug);
+  barShow(p->windows->b_phase);
+
+  statsRecord(p->stats, &p->stats->frame_build, build_start);
+
+  flush_start = statsStart(p->stats);
+  frame_flush();
+  statsRecord(p->stats, &p->stats->frame_flush, flush_start);
+  statsFrame(p->stats, frame_get_stats());
+
+  // unlock terminal
+  pthread_mutex_unlock(p->terminal_lock);
+}
+
+/**
+ * @brief Updates the elapsed time, advancing to the next phase when the current one has ended.
+ * 
+ * @param p pointer to parameters
+ */
+void update_time(Parameters *p)
+{
+  // stalled time, nothing to update
+  if (p->time_paused)
+    return;
+
+  unsigned long long elapsed_ms;
+  int phase_elapsed;
+  // calculate seconds elapsed
+  elapsed_ms = phase_elapsed_ms(p);
+  phase_elapsed = elapsed_ms / 1000;
+
+  // second line of w_total, total time spent studying
+  int total_elapsed = 0;
+  // add current session to total time if it's a study session
+  if (p->current_phase->is_study)
+    total_elapsed = phase_elapsed;
+
+  // update the parameters struct
+  // time in the current phase
+  p->phase_elapsed = phase_elapsed;
+  // total time studied today, until this very moment
+  p->study_elapsed = total_elapsed + p->previous_elapsed;
+
+  if (elapsed_ms >= (unsigned long long)p->current_phase->duration * 60000)
+  {
+    // phase has been completed
+    // go to next
+    next_phase(p, 0);
+    // pick a new quote
+    p->quote_id = quoteIndexPick(p->quotes);
+    // force windows reload
+    p->windows_force_reload = 1;
+  }
+}
+
+/**
+ * @brief Shows a yes/no dialog, while all the other windows are hidden.
+ * The dialog is a mode of the event loop: keys are sent to it, while the timer keeps running,
+ * until it's answered through answer_dialog(). One question is asked at a time.
+ * 
+ * @param p pointer to parameters
+ * @param action what the dialog is asking, one of the DIALOG_ values
+ * @param text text of the dialog
+ * @return int -1 if another dialog is waiting for an answer, 0 otherwise
+ */
+int show_dialog(Parameters *p, int action, char *text)
+{
+  if (p->dialog != NULL)
+    return -1;
+
+  p->dialog = createDialog(0, Y_BORDER);
+  p->dialog_action = action;
+  dialogSetPadding(p->dialog, 4);
+  dialogSetText(p->dialog, text, 1);
+  dialogCenter(p->dialog, 1, 0);
+
+  // hide all windows
+  // wait for exclusive use of terminal
+  lock_terminal(p);
+  set_windows_visibility(p, 0);
+  pthread_mutex_unlock(p->terminal_lock);
+  draw_dialog(p);
+
+  // nobody is there to answer a simulation
+  if (p->simulated)
+    answer_dialog(p, 1);
+
+  return 0;
+}
+
+/**
+ * @brief Draws the dialog, in place of the windows.
+ * 
+ * @param p pointer to parameters
+ */
+void draw_dialog(Parameters *p)
+{
+  // wait for exclusive use of terminal, the notifications might be ringing
+  lock_terminal(p);
+  dialogShow(p->dialog);
+  frame_flush();
+  pthread_mutex_unlock(p->terminal_lock);
+}
+
+/**
+ * @brief Closes the dialog, showing the windows again, and acts on its answer.
+ * 
+ * @param p pointer to parameters
+ * @param answer 1 if the answer is yes, 0 otherwise
+ */
+void answer_dialog(Parameters *p, int answer)
+{
+  lock_terminal(p);
+  dialogClear(p->dialog);
+  // show windows again
+  set_windows_visibility(p, 1);
+  frame_flush();
+  pthread_mutex_unlock(p->terminal_lock);
+
+  deleteDialog(p->dialog);
+  p->dialog = NULL;
+
+  if (p->dialog_action == DIALOG_RESUME)
+  {
+    // load stats from file
+    const int resumed = answer && load_savefile(p, &p->save) == 0;
+    start_session(p, !resumed);
+  }
+  else if (p->dialog_action == DIALOG_SKIP)
+  {
+    if (answer)
+    {
+      if (p->remote != -1)
+        send_command(p, "skip");
+      else
+        next_phase(p, 1);
+    }
+
+    // restart time
+    if (p->remote != -1)
+      send_command(p, "resume");
+    else
+      start_time(p);
+  }
+  else if (p->dialog_action == DIALOG_EXIT && answer)
+  {
+    p->loop = 0;
+  }
+
+  // update flags
+  p->windows_force_reload = 1;
+}
+
+/**
+ * @brief Checks whether today's session has started, or is still waiting for the resume dialog.
+ * Nothing is saved until it starts, so that the previous save is not overwritten.
+ * 
+ * @param p pointer to parameters
+ * @return int 1 if the session has started, 0 otherwise
+ */
+int session_started(Parameters *p)
+{
+  return p->dialog == NULL || p->dialog_action != DIALOG_RESUME;
+}
+
+/**
+ * @brief Starts the local timer, once today's session has been resumed or discarded.
+ * 
+ * @param p pointer to parameters
+ * @param discarded has today's session been discarded? The save is then out of date
+ */
+void start_session(Parameters *p, int discarded)
+{
+  int running;
+
+  // the other devices are followed by the process owning the timer
+  start_sync(p);
+  running = !p->time_paused;
+  start_time(p);
+
+  // the time of another device kept running: it's shared again, so that this device leads
+  if (running)
+    record_sync(p, SYNC_RESUME, phase_elapsed_ms(p) / 1000);
+
+  // the save is already up to date, unless today's session has been discarded
+  p->save_pending = discarded;
+  p->last_save = monotonic();
+}
+
+/**
+ * @brief Handles a keypress.
+ * 
+ * @param p pointer to parameters
+ * @param key pressed key
+ */
+void handle_keypress(Parameters *p, char key)
+{
+  // transform to lower case
+  if (key >= 65 && key <= 90)
+    key += 32;
+
+  if (key == 'p')
+  {
+    if (p->remote != -1)
+      send_command(p, "toggle");
+    else if (!p->time_paused)
+      pause_time(p);
+    else
+      start_time(p);
+
+    // force windows refresh
+    p->windows_force_reload = 1;
+  }
+  else if (key == 's')
+  {
+    // pause time so phases does not elapse
+    // while dialog is shown
+    if (p->remote != -1)
+      send_command(p, "pause");
+    else
+      pause_time(p);
+
+    // the time is restarted once the dialog is answered
+    show_dialog(p, DIALOG_SKIP, "Do you want to skip the current session?");
+  }
+  else if (key == 'q')
+  {
+    // make a new quote
+    if (p->remote != -1)
+      send_command(p, "quote");
+    else
+      p->quote_id = quoteIndexPick(p->quotes);
+  }
+  else if (key == 'i')
+  {
+    // show/hide visibility of commands panel
+    windowToggleVisibility(p->windows->w_controls);
+    p->windows_force_reload = 1;
+  }
+  else if (key == 'd')
+  {
+    // show/hide the instrumentation, recording from now on
+    statsEnable(p->stats);
+    windowToggleVisibility(p->windows->w_debug);
+    p->windows_force_reload = 1;
+  }
+}
+
+/**
+ * @brief Handles a change of focus of the terminal.
+ * Nothing is drawn while the terminal is not focused, then the whole terminal is repainted at once,
+ * as it might have been covered in the meantime.
+ * 
+ * @param p pointer to parameters
+ * @param focused 1 if the terminal gained the focus, 0 if it lost it
+ */
+void handle_focus(Parameters *p, int focused)
+{
+  if (focused && !p->focused)
+  {
+    // the frame is shared with the beeping threads
+    lock_terminal(p);
+    repaint_terminal();
+    pthread_mutex_unlock(p->terminal_lock);
+    p->windows_force_reload = 1;
+  }
+
+  p->focused = focused;
+}
+
+/**
+ * @brief Handles a signal received through the signal file descriptor.
+ * 
+ * @param p pointer to parameters
+ * @param signal_number number of the received signal
+ */
+void handle_signal(Parameters *p, int signal_number)
+{
+  if (signal_number == SIGTERM || (signal_number == SIGINT && p->headless))
+  {
+    // nobody to ask
+    p->loop = 0;
+  }
+  else if (signal_number == SIGINT)
+  {
+    show_dialog(p, DIALOG_EXIT, "Exit pomodoro?");
+  }
+  else if (signal_number == SIGWINCH)
+  {
+    // terminal is being resized, lay out once it settles
+    p->resize_due = monotonic() + RESIZE_DELAY;
+  }
+  else if (signal_number == SIGUSR1)
+  {
+    // the beeping threads might be recording
+    lock_terminal(p);
+    statsDump(p->stats, STATS_PATH);
+    pthread_mutex_unlock(p->terminal_lock);
+  }
+}
+
+/**
+ * @brief Checks whether the terminal is still being resized.
+ * Resize events are coalesced: the windows are laid out once, when no event has been received
+ * for RESIZE_DELAY milliseconds, rather than on each of them.
+ * 
+ * @param p pointer to parameters
+ * @return int 1 if the windows must not be drawn yet, 0 otherwise
+ */
+int resize_pending(Parameters *p)
+{
+  if (p->resize_due == 0)
+    return 0;
+
+  if (monotonic() < p->resize_due)
+    return 1;
+
+  // the size has settled
+  p->resize_due = 0;
+  p->windows_force_reload = 1;
+  return 0;
+}
+
+/**
+ * @brief Arms the timer file descriptor for the next update.
+ * While the time is running, the timer fires when the displayed time changes
+ * or exactly at the end of the phase, whichever comes first. While paused, the timer is disarmed,
+ * unless the timer is remote and its state has to be polled.
+ * Without interface, or while the terminal is not focused, the timer fires only at the earliest deadline
+ * of the phase and of the countdowns, or when a checkpoint is due.
+ * 
+ * @param p pointer to parameters
+ * @param timer_fd timer file descriptor
+ */
+void arm_timer(Parameters *p, int timer_fd)
+{
+  struct itimerspec spec = {0};
+  unsigned long long now, wakeup, next;
+  TimerState state;
+
+  snapshotRead(p->snapshot, &state);
+  now = monotonic();
+  next = p->remote == -1 ? timersNext(p->timers) : 0;
+
+  if (p->headless || !p->focused)
+  {
+    // nothing to show, sleep until a timer ends or a checkpoint is due
+    wakeup = next;
+    if (p->remote == -1 && !state.time_paused && (wakeup == 0 || p->last_save + SAVE_CHECKPOINT < wakeup))
+      wakeup = p->last_save + SAVE_CHECKPOINT;
+  }
+  else if (!state.time_paused && state.deadline > now)
+  {
+    // next second of the phase, the deadline being a whole number of seconds away from its start
+    wakeup = now + (state.deadline - now) % 1000;
+    if (wakeup == now)
+      wakeup += 1000;
+  }
+  else if (!state.time_paused)
+  {
+    // the remote timer is about to change phase, ask again shortly
+    wakeup = now + 10;
+  }
+  else if (p->remote != -1)
+  {
+    // the remote timer might be resumed by another interface
+    wakeup = now + 1000;
+  }
+  else
+  {
+    wakeup = 0;
+  }
+
+  // countdowns end exactly at their deadline, and are shown at least once per second
+  if (!p->headless && p->focused && next != 0)
+  {
+    if (wakeup == 0 || next < wakeup)
+      wakeup = next;
+    if (wakeup > now + 1000)
+      wakeup = now + 1000;
+  }
+
+  // a pending resize might be due earlier
+  if (p->resize_due != 0 && (wakeup == 0 || p->resize_due < wakeup))
+    wakeup = p->resize_due;
+
+  spec.it_value.tv_sec = wakeup / 1000;
+  spec.it_value.tv_nsec = (wakeup % 1000) * 1000000;
+
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+/**
+ * @brief Event loop of the timer. Waits for keypresses, signals, requests and timer expirations,
+ * without any idle wakeup.
+ * 
+ * @param p pointer to parameters
+ * @return int -1 in case of error, 0 otherwise
+ */
+int event_loop(Parameters *p)
+{
+  struct pollfd fds[4 + IPC_MAX_CLIENTS + 1];
+  sigset_t mask;
+  int timer_fd, signal_fd, nfds;
+
+  // signals are read from a file descriptor
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGWINCH);
+  sigaddset(&mask, SIGUSR1);
+  signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+  if (signal_fd == -1 || timer_fd == -1)
+    return -1;
+
+  // without interface, there are no keys to read
+  fds[0] = (struct pollfd){.fd = p->headless ? -1 : STDIN_FILENO, .events = POLLIN};
+  fds[1] = (struct pollfd){.fd = signal_fd, .events = POLLIN};
+  fds[2] = (struct pollfd){.fd = timer_fd, .events = POLLIN};
+  fds[3] = (struct pollfd){.fd = -1, .events = POLLIN};
+
+  while (p->loop)
+  {
+    if (p->remote == -1)
+    {
+      update_time(p);
+      expire_timers(p);
+      publish_state(p);
+    }
+    else if (send_command(p, "status") == -1)
+    {
+      // the remote timer is gone. If it's only busy, it's asked again at the next wakeup
+      break;
+    }
+
+    // the dialog, while shown, takes the place of the windows
+    if (!p->headless && p->focused && !resize_pending(p))
+    {
+      if (p->dialog != NULL)
+        draw_dialog(p);
+      else
+        draw_windows(p);
+    }
+
+    if (p->quote_pending)
+    {
+      // the first frame is on screen, the quotes are loaded and drawn right away
+      statsStartup(p->stats, p->started);
+      if (p->remote == -1)
+        p->quote_id = quoteIndexPick(p->quotes);
+      windowSetVisibility(p->windows->w_quote, 1);
+      p->quote_pending = 0;
+      continue;
+    }
+
+    if (p->remote == -1 && session_started(p))
+      checkpoint_savefile(p);
+
+    arm_timer(p, timer_fd);
+
+    // the other devices are followed once the session has started
+    fds[3].fd = p->sync != NULL ? syncFd(p->sync) : -1;
+
+    nfds = 4;
+    if (p->server != NULL)
+      nfds += serverPollFds(p->server, fds + 4);
+
+    if (poll(fds, nfds, -1) == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    statsWakeup(p->stats);
+
+    if (fds[1].revents & POLLIN)
+    {
+      struct signalfd_siginfo info;
+      // handle all the pending signals before drawing again
+      while (read(signal_fd, &info, sizeof(info)) == sizeof(info))
+        handle_signal(p, info.ssi_signo);
+    }
+
+    if (fds[0].revents & (POLLIN | POLLHUP))
+    {
+      char key;
+      int event, answer, events = 0;
+
+      while ((event = poll_event(&key)) != event_NONE)
+      {
+        if (event == event_FOCUS_IN || event == event_FOCUS_OUT)
+        {
+          handle_focus(p, event == event_FOCUS_IN);
+        }
+        else if (p->dialog != NULL)
+        {
+          // the keys belong to the dialog until it's answered
+          if ((answer = dialogHandleEvent(p->dialog, event, key)) != -1)
+            answer_dialog(p, answer);
+        }
+        else if (event == event_KEY)
+        {
+          handle_keypress(p, key);
+        }
+        events++;
+      }
+
+      // end of file, stop listening. A terminal reads nothing also when no key is pressed
+      if (!events && ((fds[0].revents & (POLLHUP | POLLERR)) || !isatty(STDIN_FILENO)))
+        fds[0].fd = -1;
+    }
+
+    if (fds[2].revents & POLLIN)
+    {
+      unsigned long long expirations;
+      // acknowledge expiration
+      read(timer_fd, &expirations, sizeof(expirations));
+    }
+
+    if (fds[3].revents & POLLIN)
+    {
+      // another device might have changed the state
+      syncPoll(p->sync, handle_sync, p);
+    }
+
+    if (p->server != NULL)
+      serverHandle(p->server, fds + 4, nfds - 4, handle_request, p);
+  }
+
+  // save the last state before leaving
+  if (p->remote == -1 && session_started(p))
+  {
+    unsigned long long start = statsStart(p->stats);
+    save_savefile(p, 1);
+    statsRecord(p->stats, &p->stats->save, start);
+  }
+
+  close(timer_fd);
+  close(signal_fd);
+
+  return 0;
+}
+
+/**
+ * @brief Loads the state of the timer from the save file, when no timer is running.
+ * The time is considered paused.
+ * 
+ * @param state pointer to destination state
+ * @return int -1 if no save from today is available, 0 otherwise
+ */
+int load_status(TimerState *state)
+{
+  Save save;
+  Settings settings;
+  Schedule schedule = {0};
+  const ScheduleEntry *e;
+  const char *names[] = {STUDY_NAME, SHORTBREAK_NAME, LONGBREAK_NAME};
+  int entry, left;
+
+  // nothing has been done today
+  memset(state, 0, sizeof(TimerState));
+  state->time_paused = 1;
+  state->quote_id = -1;
+
+  // the settings are left untouched
+  default_settings(&settings);
+  load_settings(&settings);
+  create_schedule(&schedule, &settings);
+
+  // the saved phase is looked up in the cycle, as the timer does
+  entry = -1;
+  if (read_savefile(&save) == 1 && (entry = scheduleFind(&schedule, save.phase_id, save.phase_completed)) == -1)
+    entry = scheduleFind(&schedule, save.phase_id, -1);
+
+  if (entry != -1)
+  {
+    state->phase_elapsed = save.phase_elapsed;
+    state->study_elapsed = save.study_elapsed;
+    state->study_phases = save.study_phases;
+  }
+  else
+  {
+    entry = 0;
+  }
+
+  e = schedule.entries + entry;
+  strncpy(state->phase_name, names[e->phase_id], SNAPSHOT_NAME_SIZE - 1);
+  state->phase_id = e->phase_id;
+  state->phase_duration = e->duration;
+  state->phase_completed = e->studied;
+  state->phase_is_study = e->phase_id == SCHEDULE_STUDY;
+  state->phase_repetitions = state->phase_is_study ? schedule.sessions : 0;
+  state->phase_remaining = state->phase_duration * 60 - state->phase_elapsed;
+
+  // the forecast counts from the end of the pause, that is from now
+  left = schedule.goal - state->study_phases;
+  state->goal_remaining = left > 0 ? scheduleUntilStudied(&schedule, entry, left) - state->phase_elapsed : -1;
+
+  return state->phase_elapsed || state->study_phases ? 0 : -1;
+}
+
+/**
+ * @brief Formats the status line.
+  The format string supports:
+  - %n phase name
+  - %e time elapsed in the phase
+  - %r time remaining in the phase
+  - %t time of the day when the phase ends
+  - %f time of the day when the study sessions planned for the day are completed, "done" if they are
+  - %s study sessions completed today
+  - %S time studied today
+  - %p "paused" if the time is paused, nothing otherwise
+  - %% a percent sign
+ * 
+ * @param buffer destination buffer
+ * @param size size of the buffer
+ * @param format format string
+ * @param state pointer to state
+ * @return int length of the line
+ */
+int format_status(char *buffer, int size, char *format, TimerState *state)
+{
+  // room left for the longest field
+  const int reserve = SNAPSHOT_NAME_SIZE + 2;
+  int len = 0;
+
+  for (char *c = format; *c != '\0' && len < size - reserve; c++)
+  {
+    if (*c != '%' || c[1] == '\0')
+    {
+      buffer[len++] = *c;
+      continue;
+    }
+
+    switch (*(++c))
+    {
+    case 'n':
+      len += sprintf(buffer + len, "%s", state->phase_name);
+      break;
+    case 'e':
+      format_elapsed_time(buffer + len, state->phase_elapsed);
+      len += strlen(buffer + len);
+      break;
+    case 'r':
+      format_elapsed_time(buffer + len, state->phase_remaining);
+      len += strlen(buffer + len);
+      break;
+    case 't':
+      format_time_delta(buffer + len, state->phase_remaining);
+      len += strlen(buffer + len);
+      break;
+    case 'f':
+      if (state->goal_remaining == -1)
+        len += sprintf(buffer + len, "done");
+      else
+      {
+        format_time_delta(buffer + len, state->goal_remaining);
+        len += strlen(buffer + len);
+      }
+      break;
+    case 's':
+      len += sprintf(buffer + len, "%i", state->study_phases);
+      break;
+    case 'S':
+      format_elapsed_time(buffer + len, state->study_elapsed);
+      len += strlen(buffer + len);
+      break;
+    case 'p':
+      if (state->time_paused)
+        len += sprintf(buffer + len, "paused");
+      break;
+    case '%':
+      buffer[len++] = '%';
+      break;
+    default:
+      // unknown sequence, leave it as it is
+      buffer[len++] = '%';
+      buffer[len++] = *c;
+      break;
+    }
+  }
+
+  buffer[len] = '\0';
+  return len;
+}
+
+/**
+ * @brief Prints a single status line and exits, without touching the terminal.
+ * The state is asked to the running timer, or loaded from the save file.
+ * 
+ * @param argc 
+ * @param argv arguments following "status", optionally the format string
+ * @return int exit code
+ */
+int run_status(int argc, char *argv[])
+{
+  char line[BUFLEN];
+  char socket_path[IPC_PATH_SIZE];
+  TimerState state;
+  int fd, len;
+
+  fd = -1;
+  if (ipcSocketPath(socket_path, IPC_PATH_SIZE) != -1)
+    fd = clientConnect(socket_path);
+
+  // the response is parsed in the line buffer, before being overwritten
+  if (fd == -1 ||
+      clientRequest(fd, "status", line, BUFLEN) <= 0 ||
+      ipcParseState(line, &state) != 0)
+    load_status(&state);
+
+  clientClose(fd);
+
+  len = format_status(line, BUFLEN - 1, argc > 1 ? argv[1] : (char *)STATUS_FORMAT, &state);
+  line[len++] = '\n';
+
+  return write(STDOUT_FILENO, line, len) == len ? 0 : 1;
+}
+
+/**
+ * @brief Sends a request about the countdowns to the running timer and prints them,
+ * one per line.
+ * 
+ * @param argc 
+ * @param argv arguments following "timer", joined into the request
+ * @return int exit code
+ */
+int run_timer(int argc, char *argv[])
+{
+  char request[IPC_MESSAGE_SIZE];
+  char response[IPC_MESSAGE_SIZE];
+  char socket_path[IPC_PATH_SIZE];
+  int fd, len;
+
+  fd = -1;
+  if (ipcSocketPath(socket_path, IPC_PATH_SIZE) != -1)
+    fd = clientConnect(socket_path);
+
+  if (fd == -1)
+  {
+    fprintf(stderr, "pomoc: no timer is running\n");
+    return 1;
+  }
+
+  len = snprintf(request, IPC_MESSAGE_SIZE, "timer");
+  for (int i = 1; i < argc && len < IPC_MESSAGE_SIZE; i++)
+    len += snprintf(request + len, IPC_MESSAGE_SIZE - len, " %s", argv[i]);
+
+  len = clientRequest(fd, request, response, IPC_MESSAGE_SIZE);
+  if (len <= 0 || strncmp(response, "OK", 2) != 0)
+  {
+    // the response is read only if the timer answered in time
+    fprintf(stderr, "pomoc: %s\n", len > 0 && strncmp(response, "ERR ", 4) == 0 ? response + 4 : "no response");
+    clientClose(fd);
+    return 1;
+  }
+
+  clientClose(fd);
+
+  // each line holds the seconds left, the paused flag and the name
+  for (char *line = strtok(response + 2, "\n"); line != NULL; line = strtok(NULL, "\n"))
+  {
+    char time_buffer[BUFLEN];
+    int remaining, paused, offset = 0;
+
+    if (sscanf(line, "%d %d %n", &remaining, &paused, &offset) != 2 || offset == 0)
+      continue;
+
+    format_elapsed_time(time_buffer, remaining);
+    printf("%s %s%s\n", line + offset, time_buffer, paused ? " (paused)" : "");
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Formats a record of the history as a line of CSV or NDJSON.
+ * 
+ * @param buffer destination buffer, at least BUFLEN bytes long
+ * @param record pointer to the record
+ * @param ndjson 1 to format the record as a JSON object, 0 as CSV
+ * @return int length of the line, newline included
+ */
+int format_record(char *buffer, HistoryRecord *record, int ndjson)
+{
+  const char *names[] = {STUDY_NAME, SHORTBREAK_NAME, LONGBREAK_NAME};
+  const char *name = record->phase_id >= 0 && record->phase_id < 3 ? names[record->phase_id] : "unknown";
+  const int study = (record->flags & HISTORY_STUDY) != 0;
+  const time_t start = record->start;
+  char date[32];
+  struct tm tm;
+
+  // local time, ISO 8601
+  localtime_r(&start, &tm);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &tm);
+
+  if (ndjson)
+    return snprintf(buffer, BUFLEN,
+                    "{\"start\":\"%s\",\"timestamp\":%lld,\"duration\":%d,\"phase\":\"%s\",\"study\":%s}\n",
+                    date, (long long)record->start, record->duration, name, study ? "true" : "false");
+
+  return snprintf(buffer, BUFLEN, "%s,%lld,%d,%s,%d\n",
+                  date, (long long)record->start, record->duration, name, study);
+}
+
+/**
+ * @brief Prints the history as CSV or NDJSON, one completed phase per line.
+ * The range of days is found in the rollups, then the log is read in batches,
+ * so the memory used doesn't depend on the size of the history.
+ * 
+ * @param argc 
+ * @param argv arguments following "export": the format, then optionally the first and last day
+ * @return int exit code
+ */
+int run_export(int argc, char *argv[])
+{
+  HistoryRecord records[HISTORY_BATCH_SIZE];
+  char output[EXPORT_BUFLEN];
+  uint32_t index, count, end;
+  int first_day, last_day, ndjson, len;
+  History *h;
+
+  if (argc < 2 || (strcmp(argv[1], "csv") != 0 && strcmp(argv[1], "ndjson") != 0))
+  {
+    fprintf(stderr, "usage: pomoc export csv|ndjson [FROM [TO]], days as YYYY-MM-DD\n");
+    return 1;
+  }
+
+  ndjson = strcmp(argv[1], "ndjson") == 0;
+
+  // the whole history by default, a single day if only the first is given
+  first_day = INT32_MIN;
+  last_day = INT32_MAX;
+  if (argc > 2 && historyParseDay(argv[2], &first_day) == -1)
+  {
+    fprintf(stderr, "pomoc: invalid day %s\n", argv[2]);
+    return 1;
+  }
+  if (argc > 2)
+    last_day = first_day;
+  if (argc > 3 && historyParseDay(argv[3], &last_day) == -1)
+  {
+    fprintf(stderr, "pomoc: invalid day %s\n", argv[3]);
+    return 1;
+  }
+
+  len = 0;
+  if (!ndjson)
+    len = sprintf(output, "start,timestamp,duration,phase,study\n");
+
+  // a missing history is an empty one
+  h = createHistoryReader(HISTORY_PATH, HISTORY_DAYS_PATH);
+  if (h != NULL && historyRange(h, first_day, last_day, &index, &count) == 0)
+  {
+    end = index + count;
+    while (index < end)
+    {
+      const int batch = historyReadRecords(h, index, records, end - index < HISTORY_BATCH_SIZE ? end - index : HISTORY_BATCH_SIZE);
+      if (batch <= 0)
+        break;
+
+      for (int i = 0; i < batch; i++)
+      {
+        // the lines are written in large chunks
+        if (len > EXPORT_BUFLEN - BUFLEN)
+        {
+          if (write(STDOUT_FILENO, output, len) != len)
+          {
+            deleteHistory(h);
+            return 1;
+          }
+          len = 0;
+        }
+
+        len += format_record(output + len, records + i, ndjson);
+      }
+
+      index += batch;
+    }
+  }
+
+  deleteHistory(h);
+
+  return write(STDOUT_FILENO, output, len) == len ? 0 : 1;
+}
+
+/**
+ * @brief Parses a delay made of numbers followed by a unit, such as 1d, 1h30m or 90s.
+ * A number without unit is in seconds.
+ * 
+ * @param s string to parse
+ * @param ms pointer to the delay, in milliseconds
+ * @return int number of parsed characters, -1 if the delay is not valid
+ */
+int parse_delay(const char *s, unsigned long long *ms)
+{
+  const char *c = s;
+
+  *ms = 0;
+  while (*c >= '0' && *c <= '9')
+  {
+    unsigned long long value = 0;
+    while (*c >= '0' && *c <= '9')
+      value = value * 10 + (*c++ - '0');
+
+    switch (*c)
+    {
+    case 'd':
+      value *= 24;
+      // fall through
+    case 'h':
+      value *= 60;
+      // fall through
+    case 'm':
+      value *= 60;
+      // fall through
+    case 's':
+      c++;
+      // fall through
+    default:
+      *ms += value * 1000;
+      break;
+    }
+  }
+
+  return c > s ? c - s : -1;
+}
+
+/**
+ * @brief Runs an iteration of the event loop in a simulation, drawing a frame,
+ * and traces it if something has happened.
+ * Trace lines hold the virtual seconds since the start, the event, the paused flag,
+ * the study phases, the seconds studied, the bytes of the frame and the name of the phase.
+ * 
+ * @param p pointer to parameters
+ * @param event event to trace, NULL to trace only the end of a phase
+ * @param transitions pointer to the number of phase transitions already traced
+ */
+void simulate_step(Parameters *p, const char *event, int *transitions)
+{
+  TimerState state;
+
+  update_time(p);
+  expire_timers(p);
+  publish_state(p);
+  draw_windows(p);
+
+  if (event == NULL && p->transitions != *transitions)
+    event = "end";
+  *transitions = p->transitions;
+
+  if (event == NULL)
+    return;
+
+  snapshotRead(p->snapshot, &state);
+  printf("%llu %s %i %i %i %i %s\n",
+         (monotonic() - CLOCK_VIRTUAL_START) / 1000, event, state.time_paused,
+         state.study_phases, state.study_elapsed, frame_get_stats().bytes, state.phase_name);
+}
+
+/**
+ * @brief Moves the virtual clock forward, stopping at every deadline on the way
+ * like the event loop would wake up at them.
+ * 
+ * @param p pointer to parameters
+ * @param c pointer to the virtual clock
+ * @param target monotonic milliseconds to reach
+ * @param transitions pointer to the number of phase transitions already traced
+ */
+void simulate_until(Parameters *p, Clock *c, unsigned long long target, int *transitions)
+{
+  do
+  {
+    const unsigned long long next = timersNext(p->timers);
+    clockSet(c, next != 0 && next < target ? next : target);
+    simulate_step(p, NULL, transitions);
+  } while (monotonic() < target);
+}
+
+/**
+ * @brief Replays a script of keys against a virtual clock, without terminal nor files,
+ * printing a trace of the state. Frames are drawn into a null output, at every event.
+ * Each line of the script holds an optional delay to wait, such as 25m or 1d2h, then
+ * the keys to press after it, or a countdown request starting with "timer".
+ * 
+ * @param argc 
+ * @param argv arguments following "simulate": the script ("-" for stdin), then optionally the durations or the cycle
+ * @return int exit code
+ */
+int run_simulation(int argc, char *argv[])
+{
+  Settings settings;
+  char line[BUFLEN], response[IPC_MESSAGE_SIZE];
+  unsigned long long real_start, delay;
+  int transitions;
+  Phase phases[3];
+  Schedule *schedule;
+  Parameters *p;
+  Output *output;
+  Clock *clock;
+  FILE *fp;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: pomoc simulate SCRIPT|- [durations|cycle]\n");
+    return 1;
+  }
+
+  fp = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+  if (fp == NULL)
+  {
+    fprintf(stderr, "pomoc: cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  real_start = statsClock();
+
+  // same quotes on every run, sized screen that is never written
+  srand(1);
+  clock = createVirtualClock(SIMULATION_START);
+  set_clock(clock);
+  output = createNullOutput();
+  outputSetSize(output, SIMULATION_WIDTH, SIMULATION_HEIGHT);
+  set_output(output);
+
+  // the settings are ignored, only the passed durations or cycle are used
+  default_settings(&settings);
+  parse_arguments(&settings, argc - 1, argv + 1);
+  create_phases(phases);
+  schedule = createSchedule();
+  create_schedule(schedule, &settings);
+
+  // no history, no save, no socket and no notification
+  p = init_parameters(phases,
+                      schedule,
+                      init_windows(),
+                      createQuoteIndex(access(QUOTES_PACK_PATH, R_OK) == 0 ? QUOTES_PACK_PATH : QUOTES_PATH),
+                      NULL);
+  p->simulated = 1;
+  p->quote_pending = 0;
+  p->quote_id = quoteIndexPick(p->quotes);
+  statsEnable(p->stats);
+
+  reset_current_time(p);
+  start_time(p);
+
+  transitions = 0;
+  simulate_step(p, "start", &transitions);
+
+  while (file_read_line(line, BUFLEN, fp) != -1)
+  {
+    char *c = line;
+    int len;
+
+    // empty lines and comments
+    while (*c == ' ' || *c == '\t')
+      c++;
+    if (*c == '\0' || *c == '#')
+      continue;
+
+    // the delay is optional
+    if ((len = parse_delay(c, &delay)) != -1)
+      simulate_until(p, clock, monotonic() + delay, &transitions);
+    else
+      len = 0;
+
+    for (c += len; *c == ' ' || *c == '\t'; c++)
+      ;
+
+    if (strncmp(c, "timer", 5) == 0)
+    {
+      handle_timer_request(p, c, response, IPC_MESSAGE_SIZE);
+      simulate_step(p, strncmp(response, "OK", 2) == 0 ? "timer" : "timer-error", &transitions);
+      continue;
+    }
+
+    for (; *c != '\0'; c++)
+    {
+      char event[] = "key:?";
+
+      if (*c == ' ' || *c == '\t')
+        continue;
+
+      event[4] = *c;
+      handle_keypress(p, *c);
+      simulate_step(p, event, &transitions);
+    }
+  }
+
+  if (fp != stdin)
+    fclose(fp);
+
+  // the trace does not depend on the speed of the machine
+  printf("# %i transitions in %llu virtual seconds, %llu frames, %llu bytes\n",
+         p->transitions, (monotonic() - CLOCK_VIRTUAL_START) / 1000, p->stats->frames, p->stats->bytes);
+  fprintf(stderr, "pomoc: simulated in %.3f ms\n", (statsClock() - real_start) / 1e3);
+
+  delete_parameters(p);
+  set_output(NULL);
+  deleteOutput(output);
+  deleteClock(clock);
+
+  return 0;
+}
+
+/**
+ * @brief Blocks the signals handled by the event loop, in every thread.
+ * 
+ */
+void block_signals()
+{
+  sigset_t mask;
+
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGWINCH);
+  sigaddset(&mask, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+}
+
+/**
+ * @brief Runs the timer without interface, serving its state on the socket.
+ * A save from today is resumed without asking.
+ * 
+ * @param argc 
+ * @param argv arguments following "daemon"
+ * @return int exit code
+ */
+int run_daemon(int argc, char *argv[])
+{
+  const unsigned long long started = statsClock();
+  Phase phases[3];
+  Schedule *schedule;
+  char socket_path[IPC_PATH_SIZE];
+  Parameters *p;
+
+  if (ipcSocketPath(socket_path, IPC_PATH_SIZE) == -1)
+  {
+    fprintf(stderr, "pomoc: no private directory for the socket, or its path is too long\n");
+    return 1;
+  }
+
+  block_signals();
+
+  // init phases, provide argv and argc to handle command line parsing
+  schedule = createSchedule();
+  init_phases(phases, schedule, argc, argv);
+
+  // pack the parameters
+  p = init_parameters(phases,
+                      schedule,
+                      init_windows(),
+                      createQuoteIndex(access(QUOTES_PACK_PATH, R_OK) == 0 ? QUOTES_PACK_PATH : QUOTES_PATH),
+                      createHistory(HISTORY_PATH, HISTORY_DAYS_PATH));
+  p->headless = 1;
+  p->started = started;
+
+  // no terminal to ring, only the hook is run
+  p->notifier = createNotifier(NULL, getenv(HOOK_ENV));
+
+  // only one timer at a time
+  p->server = createServer(socket_path);
+  if (p->server == NULL)
+  {
+    fprintf(stderr, "pomoc: cannot listen on %s, is another timer running?\n", socket_path);
+    delete_parameters(p);
+    return 1;
+  }
+
+  // the first phase starts paused, until the loop begins
+  reset_current_time(p);
+
+  // resume today's session, as nobody can be asked
+  p->loop = 1;
+  if (read_savefile(&p->save) == 1)
+    load_savefile(p, &p->save);
+  start_session(p, 0);
+
+  event_loop(p);
+
+  delete_parameters(p);
+
+  return 0;
+}
+
+/**
+ * @brief Runs the interface of the timer.
+ * If a timer is already running, the interface attaches to it.
+ * Otherwise the interface runs its own timer, serving it on the socket.
+ * 
+ * @param argc 
+ * @param argv 
+ * @return int exit code
+ */
+int run_interface(int argc, char *argv[])
+{
+  // declare variables
+  const unsigned long long started = statsClock();
+  Phase phases[3];
+  Schedule *schedule;
+  char socket_path[IPC_PATH_SIZE];
+  History *history;
+  Parameters *p;
+  int remote;
+
+  // look for a running timer
+  remote = -1;
+  if (ipcSocketPath(socket_path, IPC_PATH_SIZE) == -1)
+    socket_path[0] = '\0';
+  else
+    remote = clientConnect(socket_path);
+
+  // set raw mode
+  enter_raw_mode();
+
+  // signals are handled by the event loop, block them in every thread
+  block_signals();
+
+  if (remote == -1)
+  {
+    // init phases, provide argv and argc to handle command line parsing
+    schedule = createSchedule();
+    init_phases(phases, schedule, argc, argv);
+    // open the history, the timer works even without it
+    history = createHistory(HISTORY_PATH, HISTORY_DAYS_PATH);
+  }
+  else
+  {
+    // the phases belong to the remote timer
+    schedule = NULL;
+    history = NULL;
+  }
+
+  // pack the parameters, indexing the quotes once and preferring the precompiled pack
+  p = init_parameters(remote == -1 ? phases : NULL,
+                      schedule,
+                      init_windows(),
+                      createQuoteIndex(access(QUOTES_PACK_PATH, R_OK) == 0 ? QUOTES_PACK_PATH : QUOTES_PATH),
+                      history);
+  p->remote = remote;
+  p->started = started;
+
+  // the hook is run by the process owning the timer
+  p->notifier = createNotifier(p->terminal_lock, remote == -1 ? getenv(HOOK_ENV) : NULL);
+
+  if (remote == -1)
+  {
+    // the first phase starts paused, until the loop begins
+    reset_current_time(p);
+    // serve the state to other interfaces, if the path is usable
+    if (socket_path[0] != '\0')
+      p->server = createServer(socket_path);
+  }
+
+  // prepare terminal, the notifications are already running
+  lock_terminal(p);
+  clear_terminal();
+  hide_cursor();
+  enable_focus_events();
+  pthread_mutex_unlock(p->terminal_lock);
+
+  //start the loop
+  p->loop = 1;
+
+  // check if a previous file session is available
+  if (remote == -1 && read_savefile(&p->save) == 1)
+  {
+    // the session starts once the dialog is answered, by the event loop
+    show_dialog(p, DIALOG_RESUME, "Previous session found. Continue?");
+  }
+  else if (remote == -1)
+  {
+    start_session(p, 0);
+  }
+
+  event_loop(p);
+
+  // clean up
+  delete_parameters(p);
+
+  // reset all terminal
+  disable_focus_events();
+  exit_raw_mode();
+  reset_styles();
+  clear_terminal();
+  frame_flush();
+  show_cursor();
   move_cursor_to(0, 0);
 
   return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[])
+{
+  // init random seed
+  srand(time(NULL));
+
+  if (argc > 1 && strcmp(argv[1], "status") == 0)
+    return run_status(argc - 1, argv + 1);
+
+  if (argc > 1 && strcmp(argv[1], "timer") == 0)
+    return run_timer(argc - 1, argv + 1);
+
+  if (argc > 1 && strcmp(argv[1], "export") == 0)
+    return run_export(argc - 1, argv + 1);
+
+  if (argc > 1 && strcmp(argv[1], "simulate") == 0)
+    return run_simulation(argc - 1, argv + 1);
+
+  if (argc > 1 && strcmp(argv[1], "daemon") == 0)
+    return run_daemon(argc - 1, argv + 1);
+
+  return run_interface(argc, argv);
+}
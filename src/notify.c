@@ -0,0 +1,303 @@
+/** @file notify.c */
+
+#define _DEFAULT_SOURCE // for strdup()
+
+#include "notify.h"
+
+extern char **environ;
+
+// Definition of private functions, so that linter and compiler are happy
+
+void *_notifierWorker(void *args);
+void _notifierPlay(Notifier *n, Notification *notification);
+pid_t _notifierRunHook(Notifier *n, Notification *notification);
+void _notifierWaitHook(Notifier *n, pid_t pid);
+int _notifierSleep(Notifier *n, int ms);
+
+/**
+ * @internal
+ * @brief Waits for some time, or until the worker must stop. Must be called with the queue locked.
+ * 
+ * @param n pointer to notifier
+ * @param ms time to wait, in milliseconds
+ * @return int 0 if the time has passed, -1 if the worker must stop
+ */
+int _notifierSleep(Notifier *n, int ms)
+{
+  struct timespec deadline;
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += ms / 1000;
+  deadline.tv_nsec += (ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  // new notifications wake the worker too, they wait for their turn
+  while (n->running)
+  {
+    if (pthread_cond_timedwait(&n->wake, &n->lock, &deadline) != 0)
+      return 0;
+  }
+
+  return -1;
+}
+
+/**
+ * @internal
+ * @brief Starts the hook command, with the notification in its environment.
+ * 
+ * @param n pointer to notifier
+ * @param notification pointer to notification
+ * @return pid_t pid of the command, -1 if it has not started
+ */
+pid_t _notifierRunHook(Notifier *n, Notification *notification)
+{
+  char event[NOTIFY_TEXT_SIZE + 16], phase[NOTIFY_TEXT_SIZE + 16];
+  char *argv[] = {"sh", "-c", n->hook, NULL};
+  posix_spawnattr_t attr;
+  sigset_t mask, defaults;
+  char **envp;
+  int count;
+  pid_t pid;
+
+  for (count = 0; environ[count] != NULL; count++)
+    ;
+
+  // the environment of the timer, followed by the notification
+  envp = malloc(sizeof(char *) * (count + 3));
+  if (envp == NULL)
+    return -1;
+
+  memcpy(envp, environ, sizeof(char *) * count);
+  snprintf(event, sizeof(event), "POMOC_EVENT=%s", notification->event);
+  snprintf(phase, sizeof(phase), "POMOC_PHASE=%s", notification->phase);
+  envp[count] = event;
+  envp[count + 1] = phase;
+  envp[count + 2] = NULL;
+
+  // the signals blocked by the timer, so that the hook can be interrupted
+  sigemptyset(&mask);
+  sigemptyset(&defaults);
+  sigaddset(&defaults, SIGINT);
+  sigaddset(&defaults, SIGTERM);
+  sigaddset(&defaults, SIGWINCH);
+  sigaddset(&defaults, SIGUSR1);
+
+  // in a process group of its own, so that all of it can be stopped
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setsigmask(&attr, &mask);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+  posix_spawnattr_setpgroup(&attr, 0);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+  if (posix_spawn(&pid, "/bin/sh", NULL, &attr, argv, envp) != 0)
+    pid = -1;
+
+  posix_spawnattr_destroy(&attr);
+  free(envp);
+  return pid;
+}
+
+/**
+ * @internal
+ * @brief Plays a notification: starts the hook, rings the bells, then waits for the hook.
+ * Must be called with the queue locked, the lock is released while the bells are rung.
+ * 
+ * @param n pointer to notifier
+ * @param notification pointer to notification
+ */
+void _notifierPlay(Notifier *n, Notification *notification)
+{
+  const int delay = (1 - notification->speed / 10.0) * 700 + 300;
+  pid_t hook;
+
+  hook = n->hook != NULL ? _notifierRunHook(n, notification) : -1;
+
+  for (int i = 0; i < notification->repetitions && n->output_lock != NULL; i++)
+  {
+    // the terminal is locked only while the bell is written
+    pthread_mutex_unlock(&n->lock);
+    pthread_mutex_lock(n->output_lock);
+    terminal_beep();
+    pthread_mutex_unlock(n->output_lock);
+    pthread_mutex_lock(&n->lock);
+
+    if (_notifierSleep(n, delay) == -1)
+      break;
+  }
+
+  if (hook != -1)
+    _notifierWaitHook(n, hook);
+}
+
+/**
+ * @internal
+ * @brief Waits for the hook to end. If the worker must stop meanwhile, the process group of the hook
+ * is terminated, then killed if the hook is still running after NOTIFY_HOOK_GRACE milliseconds.
+ * Must be called with the queue locked.
+ * 
+ * @param n pointer to notifier
+ * @param pid pid of the hook
+ */
+void _notifierWaitHook(Notifier *n, pid_t pid)
+{
+  const struct timespec poll_delay = {.tv_sec = 0, .tv_nsec = NOTIFY_HOOK_POLL * 1000000L};
+
+  // checked on regularly, so that a stuck hook can't hold the exit
+  while (waitpid(pid, NULL, WNOHANG) == 0)
+  {
+    if (_notifierSleep(n, NOTIFY_HOOK_POLL) == 0)
+      continue;
+
+    kill(-pid, SIGTERM);
+    for (int waited = 0; waited < NOTIFY_HOOK_GRACE; waited += NOTIFY_HOOK_POLL)
+    {
+      if (waitpid(pid, NULL, WNOHANG) != 0)
+        return;
+
+      nanosleep(&poll_delay, NULL);
+    }
+
+    kill(-pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return;
+  }
+}
+
+/**
+ * @internal
+ * @brief Main function of the worker, playing the queued notifications until stopped.
+ * 
+ * @param args pointer to notifier
+ * @return void* NULL
+ */
+void *_notifierWorker(void *args)
+{
+  Notifier *n = args;
+
+  pthread_mutex_lock(&n->lock);
+
+  while (n->running)
+  {
+    Notification notification;
+
+    if (n->count == 0)
+    {
+      pthread_cond_wait(&n->wake, &n->lock);
+      continue;
+    }
+
+    notification = n->queue[n->head];
+    n->head = (n->head + 1) % NOTIFY_QUEUE_SIZE;
+    n->count--;
+
+    _notifierPlay(n, &notification);
+  }
+
+  pthread_mutex_unlock(&n->lock);
+  return NULL;
+}
+
+/**
+ * @brief Creates a notifier and starts its worker.
+ * 
+ * @param output_lock lock of the terminal, taken to ring the bell. NULL to never ring it
+ * @param hook command run by the shell for each notification, NULL or empty for none
+ * @return Notifier* NULL in case of error
+ */
+Notifier *createNotifier(pthread_mutex_t *output_lock, const char *hook)
+{
+  pthread_condattr_t attr;
+  Notifier *n;
+
+  n = malloc(sizeof(Notifier));
+  if (n == NULL)
+    return NULL;
+
+  memset(n, 0, sizeof(Notifier));
+  n->output_lock = output_lock;
+  n->hook = hook != NULL && hook[0] != '\0' ? strdup(hook) : NULL;
+  n->running = 1;
+
+  // the waits between the bells are not affected by changes of the wall clock
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&n->wake, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(&n->lock, NULL);
+
+  if (pthread_create(&n->thread, NULL, _notifierWorker, n) != 0)
+  {
+    pthread_cond_destroy(&n->wake);
+    pthread_mutex_destroy(&n->lock);
+    free(n->hook);
+    free(n);
+    return NULL;
+  }
+
+  return n;
+}
+
+/**
+ * @brief Stops the worker, dropping the pending notifications, and deletes the notifier.
+ * The tone being played is interrupted.
+ * 
+ * @param n pointer to notifier
+ */
+void deleteNotifier(Notifier *n)
+{
+  if (n == NULL)
+    return;
+
+  pthread_mutex_lock(&n->lock);
+  n->running = 0;
+  pthread_cond_signal(&n->wake);
+  pthread_mutex_unlock(&n->lock);
+
+  pthread_join(n->thread, NULL);
+
+  pthread_cond_destroy(&n->wake);
+  pthread_mutex_destroy(&n->lock);
+  free(n->hook);
+  free(n);
+}
+
+/**
+ * @brief Queues a notification, without blocking.
+ * 
+ * @param n pointer to notifier
+ * @param repetitions number of bells of the tone, 0 for none
+ * @param speed speed of the tone, in range [0-10]
+ * @param event what happened, passed to the hook
+ * @param phase name of the new phase, passed to the hook
+ * @return int -1 if the queue is full, 0 otherwise
+ */
+int notifierPush(Notifier *n, int repetitions, int speed, const char *event, const char *phase)
+{
+  Notification *notification;
+
+  pthread_mutex_lock(&n->lock);
+
+  if (n->count == NOTIFY_QUEUE_SIZE)
+  {
+    pthread_mutex_unlock(&n->lock);
+    return -1;
+  }
+
+  notification = n->queue + (n->head + n->count) % NOTIFY_QUEUE_SIZE;
+  notification->repetitions = repetitions;
+  notification->speed = speed;
+  strncpy(notification->event, event, NOTIFY_TEXT_SIZE - 1);
+  notification->event[NOTIFY_TEXT_SIZE - 1] = '\0';
+  strncpy(notification->phase, phase, NOTIFY_TEXT_SIZE - 1);
+  notification->phase[NOTIFY_TEXT_SIZE - 1] = '\0';
+  n->count++;
+
+  pthread_cond_signal(&n->wake);
+  pthread_mutex_unlock(&n->lock);
+
+  return 0;
+}
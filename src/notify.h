@@ -0,0 +1,62 @@
+/**
+ * @file notify.h
+ * @brief Notifications of the phase transitions, played by a single long-lived worker.
+ * Notifications are queued and played in order: a tone, made of bells written through
+ * the terminal output, and an optional hook command. The terminal lock is taken only
+ * to write each bell, never while waiting between two of them.
+ */
+
+#ifndef _NOTIFY
+#define _NOTIFY
+
+#include <stdio.h>    // for snprintf()
+#include <stdlib.h>   // for malloc() and free()
+#include <string.h>   // for strncpy() and strdup()
+#include <pthread.h>  // for pthread_create()
+#include <time.h>     // for clock_gettime()
+#include <spawn.h>    // for posix_spawn()
+#include <signal.h>   // for kill()
+#include <sys/wait.h> // for waitpid()
+
+#include "terminal.h"
+
+#define NOTIFY_QUEUE_SIZE 8 // maximum number of pending notifications
+#define NOTIFY_TEXT_SIZE 32 // maximum size of the texts passed to the hook, including the terminator
+
+static const int NOTIFY_HOOK_POLL = 100;   // interval between the checks of a running hook, milliseconds
+static const int NOTIFY_HOOK_GRACE = 1000; // time left to the hook to end once terminated, milliseconds
+
+/**
+ * @brief Struct containing a notification of a phase transition.
+ * 
+ */
+typedef struct
+{
+  int repetitions;              /**<  number of bells of the tone, 0 for none */
+  int speed;                    /**<  speed of the tone, in range [0-10] */
+  char event[NOTIFY_TEXT_SIZE]; /**<  what happened, passed to the hook as POMOC_EVENT */
+  char phase[NOTIFY_TEXT_SIZE]; /**<  name of the new phase, passed to the hook as POMOC_PHASE */
+} Notification;
+
+/**
+ * @brief Struct containing the worker and its queue.
+ * 
+ */
+typedef struct
+{
+  pthread_t thread;                      /**<  worker thread */
+  pthread_mutex_t lock;                  /**<  lock of the queue */
+  pthread_cond_t wake;                   /**<  signaled when a notification is queued or the worker must stop */
+  Notification queue[NOTIFY_QUEUE_SIZE]; /**<  pending notifications, circular */
+  int head;                              /**<  index of the oldest pending notification */
+  int count;                             /**<  number of pending notifications */
+  int running;                           /**<  is the worker running? */
+  pthread_mutex_t *output_lock;          /**<  lock of the terminal, NULL to never ring the bell */
+  char *hook;                            /**<  command run by the shell for each notification, NULL for none */
+} Notifier;
+
+Notifier *createNotifier(pthread_mutex_t *output_lock, const char *hook);
+void deleteNotifier(Notifier *n);
+int notifierPush(Notifier *n, int repetitions, int speed, const char *event, const char *phase);
+
+#endif
@@ -0,0 +1,353 @@
+/** @file quotes.c */
+
+#define _DEFAULT_SOURCE // for st_mtim, madvise() and random()
+
+#include "quotes.h"
+
+// Definition of private functions, so that linter and compiler are happy
+
+void _quoteIndexUnload(QuoteIndex *q);
+int _quoteIndexLoad(QuoteIndex *q, struct stat *st);
+uint32_t _packReadU32(char *p);
+int _packGet(QuoteIndex *q, int index, Quote *quote);
+
+/**
+ * @internal
+ * @brief Unmaps the file and frees the offsets.
+ * 
+ * @param q pointer to quote index
+ */
+void _quoteIndexUnload(QuoteIndex *q)
+{
+  if (q->data != NULL)
+    munmap(q->data, q->size);
+
+  free(q->offsets);
+
+  q->data = NULL;
+  q->offsets = NULL;
+  q->size = 0;
+  q->count = 0;
+  q->packed = 0;
+}
+
+/**
+ * @internal
+ * @brief Reads a little endian 32 bit unsigned integer from the pack.
+ * 
+ * @param p pointer to the first byte
+ * @return uint32_t 
+ */
+uint32_t _packReadU32(char *p)
+{
+  const unsigned char *u = (const unsigned char *)p;
+  return (uint32_t)u[0] | (uint32_t)u[1] << 8 | (uint32_t)u[2] << 16 | (uint32_t)u[3] << 24;
+}
+
+/**
+ * @internal
+ * @brief Gets a quote from a binary pack.
+ * 
+ * @param q pointer to quote index
+ * @param index index of the quote
+ * @param quote pointer to the quote to fill
+ * @return int -1 if the entry is not valid, 0 otherwise
+ */
+int _packGet(QuoteIndex *q, int index, Quote *quote)
+{
+  char *entry = q->data + QUOTES_PACK_HEADER + (size_t)index * QUOTES_PACK_ENTRY;
+  const uint32_t text_offset = _packReadU32(entry);
+  const uint32_t text_len = _packReadU32(entry + 4);
+  const uint32_t author_offset = _packReadU32(entry + 12);
+  const uint32_t author_len = _packReadU32(entry + 16);
+
+  // make sure that the strings are inside the file
+  if ((size_t)text_offset + text_len > q->size || (size_t)author_offset + author_len > q->size)
+    return -1;
+
+  *quote = (Quote){
+      .text = q->data + text_offset,
+      .text_len = text_len,
+      .author = q->data + author_offset,
+      .author_len = author_len,
+      .text_width = _packReadU32(entry + 8),
+      .author_width = _packReadU32(entry + 20),
+  };
+
+  return 0;
+}
+
+/**
+ * @internal
+ * @brief Maps the file and computes the offset of each line.
+ * Empty lines are skipped.
+ * 
+ * @param q pointer to quote index
+ * @param st status of the file, as returned by stat()
+ * @return int -1 in case of error, number of quotes otherwise
+ */
+int _quoteIndexLoad(QuoteIndex *q, struct stat *st)
+{
+  int fd, capacity;
+
+  _quoteIndexUnload(q);
+  q->mtime = st->st_mtim;
+
+  if (st->st_size == 0)
+    return 0;
+
+  fd = open(q->path, O_RDONLY);
+  if (fd == -1)
+    return -1;
+
+  q->data = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (q->data == MAP_FAILED)
+  {
+    q->data = NULL;
+    return -1;
+  }
+
+  q->size = st->st_size;
+
+  if (q->size >= (size_t)QUOTES_PACK_HEADER && memcmp(q->data, QUOTES_PACK_MAGIC, 4) == 0)
+  {
+    // binary pack, the entries are used as they are
+    const uint32_t count = _packReadU32(q->data + 8);
+
+    if (_packReadU32(q->data + 4) != QUOTES_PACK_VERSION || QUOTES_PACK_HEADER + (size_t)count * QUOTES_PACK_ENTRY > q->size)
+    {
+      _quoteIndexUnload(q);
+      return -1;
+    }
+
+    q->packed = 1;
+    q->count = count;
+    return q->count;
+  }
+
+  // the whole file is read sequentially just once
+  madvise(q->data, q->size, MADV_SEQUENTIAL);
+
+  capacity = 1024;
+  q->offsets = malloc(sizeof(size_t) * capacity);
+  if (q->offsets == NULL)
+  {
+    _quoteIndexUnload(q);
+    return -1;
+  }
+
+  size_t start = 0;
+  while (start < q->size)
+  {
+    char *newline = memchr(q->data + start, '\n', q->size - start);
+    const size_t end = newline != NULL ? (size_t)(newline - q->data) : q->size;
+
+    if (end > start)
+    {
+      // keep room for the sentinel
+      if (q->count + 1 >= capacity)
+      {
+        size_t *offsets = realloc(q->offsets, sizeof(size_t) * capacity * 2);
+        if (offsets == NULL)
+        {
+          _quoteIndexUnload(q);
+          return -1;
+        }
+
+        q->offsets = offsets;
+        capacity *= 2;
+      }
+
+      q->offsets[q->count] = start;
+      // the sentinel holds the end of the last line, plus the newline
+      q->offsets[q->count + 1] = end + 1;
+      q->count++;
+    }
+
+    start = end + 1;
+  }
+
+  return q->count;
+}
+
+/**
+ * @brief Creates the index of a quotes file. The file is loaded on the first refresh.
+ * 
+ * @param path path of the quotes file
+ * @return QuoteIndex* pointer to quote index
+ */
+QuoteIndex *createQuoteIndex(const char *path)
+{
+  QuoteIndex *q = malloc(sizeof(QuoteIndex));
+
+  *q = (QuoteIndex){
+      .path = malloc(strlen(path) + 1),
+      .data = NULL,
+      .size = 0,
+      .offsets = NULL,
+      .count = 0,
+      .packed = 0,
+      .mtime = {.tv_sec = -1, .tv_nsec = -1},
+  };
+
+  strcpy(q->path, path);
+
+  return q;
+}
+
+/**
+ * @brief Deletes a quote index, freeing the memory.
+ * 
+ * @param q pointer to quote index
+ */
+void deleteQuoteIndex(QuoteIndex *q)
+{
+  if (!q)
+    return;
+
+  _quoteIndexUnload(q);
+  free(q->path);
+  free(q);
+}
+
+/**
+ * @brief Rebuilds the index if the file has been modified since it was indexed.
+ * 
+ * @param q pointer to quote index
+ * @return int -1 if the file is not readable, number of quotes otherwise
+ */
+int quoteIndexRefresh(QuoteIndex *q)
+{
+  struct stat st;
+
+  if (stat(q->path, &st) == -1)
+  {
+    _quoteIndexUnload(q);
+    q->mtime = (struct timespec){.tv_sec = -1, .tv_nsec = -1};
+    return -1;
+  }
+
+  if (st.st_mtim.tv_sec != q->mtime.tv_sec || st.st_mtim.tv_nsec != q->mtime.tv_nsec || (size_t)st.st_size != q->size)
+    return _quoteIndexLoad(q, &st);
+
+  return q->count;
+}
+
+/**
+ * @brief Returns the number of quotes in the index.
+ * 
+ * @param q pointer to quote index
+ * @return int number of quotes
+ */
+int quoteIndexCount(QuoteIndex *q)
+{
+  return q->count;
+}
+
+/**
+ * @brief Gets a quote from the index. 
+ * Lines of text files are formatted as "text@author", the author being after the last @.
+ * 
+ * @param q pointer to quote index
+ * @param index index of the quote
+ * @param quote pointer to the quote to fill
+ * @return int -1 if the index is not valid, 0 otherwise
+ */
+int quoteIndexGet(QuoteIndex *q, int index, Quote *quote)
+{
+  if (index < 0 || index >= q->count)
+    return -1;
+
+  if (q->packed)
+    return _packGet(q, index, quote);
+
+  char *line = q->data + q->offsets[index];
+  const int len = q->offsets[index + 1] - q->offsets[index] - 1;
+
+  // find the separator going backwards
+  int separator = -1;
+  for (int i = len - 1; i >= 0; i--)
+  {
+    if (line[i] == '@')
+    {
+      separator = i;
+      break;
+    }
+  }
+
+  if (separator == -1)
+  {
+    *quote = (Quote){
+        .text = line,
+        .text_len = len,
+        .author = line + len,
+        .author_len = 0,
+        .text_width = -1,
+        .author_width = -1,
+    };
+    return 0;
+  }
+
+  *quote = (Quote){
+      .text = line,
+      .text_len = separator,
+      .author = line + separator + 1,
+      .author_len = len - separator - 1,
+      .text_width = -1,
+      .author_width = -1,
+  };
+
+  return 0;
+}
+
+/**
+ * @brief Picks a random quote.
+ * 
+ * @param q pointer to quote index
+ * @return int -1 if file is not readable, index of the quote otherwise
+ */
+int quoteIndexPick(QuoteIndex *q)
+{
+  // the index is rebuilt only if the file has changed
+  if (quoteIndexRefresh(q) <= 0)
+    return -1;
+
+  return random() % q->count;
+}
+
+/**
+ * @brief Saves a quote into window, replacing its lines.
+ * 
+ * @param q pointer to quote index
+ * @param index index of the quote, as returned by quoteIndexPick()
+ * @param w pointer to window
+ * @return int -1 if the quote is not available, 0 in case of success
+ */
+int quoteIndexPlace(QuoteIndex *q, int index, Window *w)
+{
+  Quote quote;
+
+  // reset quotes window
+  windowDeleteAllLines(w);
+
+  // the quote might have been picked by another process
+  quoteIndexRefresh(q);
+
+  if (quoteIndexGet(q, index, &quote) != 0)
+  {
+    // if the quotes file is somehow not found,
+    // add a gimmick quote to panel
+    windowAddLine(w, "God is dead and we killed him.");
+    windowAddLine(w, "~Harambe");
+    return -1;
+  }
+
+  // the text and the author are placed straight from the index, whatever their length,
+  // along with their widths when precomputed by the pack
+  windowAddLineLen(w, quote.text, quote.text_len, quote.text_width);
+  windowAddLineLen(w, quote.author, quote.author_len, quote.author_width);
+
+  return 0;
+}
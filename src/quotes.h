@@ -0,0 +1,68 @@
+/**
+ * @file quotes.h
+ * @brief Index of the quotes file.
+ * The file is memory mapped and the offset of each line is computed once,
+ * so that picking a quote does not require reading the file again.
+ * The index is rebuilt only when the modification time of the file changes.
+ * Binary packs produced by quotes.py --binary are used as they are, without any parsing.
+ */
+
+#ifndef _QUOTES
+#define _QUOTES
+
+#include <stdlib.h>    // for malloc() and free()
+#include <string.h>    // for strlen()
+#include <fcntl.h>     // for open()
+#include <unistd.h>    // for close()
+#include <sys/mman.h>  // for mmap()
+#include <sys/stat.h>  // for stat()
+#include <time.h>      // for timespec
+#include <stdint.h>    // for uint32_t
+
+#include "terminal.h"
+
+#define QUOTES_PACK_MAGIC "PQPK"
+
+static const uint32_t QUOTES_PACK_VERSION = 1; // version of the binary pack
+static const int QUOTES_PACK_HEADER = 12;      // size of the pack header: magic, version, count
+static const int QUOTES_PACK_ENTRY = 24;       // size of a pack entry: offset, length, width of text and author
+
+/**
+ * @brief Struct containing a quote.
+ * Strings point inside the index and are not NUL terminated.
+ * 
+ */
+typedef struct
+{
+  char *text;     /**<  text of the quote */
+  int text_len;   /**<  length of the text, in bytes */
+  char *author;   /**<  author of the quote */
+  int author_len; /**<  length of the author, in bytes */
+  int text_width;   /**<  display width of the text, -1 if unknown */
+  int author_width; /**<  display width of the author, -1 if unknown */
+} Quote;
+
+/**
+ * @brief Struct containing the index of a quotes file.
+ * 
+ */
+typedef struct
+{
+  char *path;            /**<  path of the quotes file */
+  char *data;            /**<  memory mapped content of the file */
+  size_t size;           /**<  size of the mapped file */
+  size_t *offsets;       /**<  offset of the start of each line, plus the end of the last one */
+  int count;             /**<  number of quotes in the index */
+  int packed;            /**<  is the file a binary pack? */
+  struct timespec mtime; /**<  modification time of the indexed file */
+} QuoteIndex;
+
+QuoteIndex *createQuoteIndex(const char *path);
+void deleteQuoteIndex(QuoteIndex *q);
+int quoteIndexRefresh(QuoteIndex *q);
+int quoteIndexCount(QuoteIndex *q);
+int quoteIndexGet(QuoteIndex *q, int index, Quote *quote);
+int quoteIndexPick(QuoteIndex *q);
+int quoteIndexPlace(QuoteIndex *q, int index, Window *w);
+
+#endif
@@ -0,0 +1,232 @@
+/** @file schedule.c */
+
+#include "schedule.h"
+
+/**
+ * @brief Creates an empty schedule.
+ * 
+ * @return Schedule*
+ */
+Schedule *createSchedule()
+{
+  Schedule *s = malloc(sizeof(Schedule));
+  if (s == NULL)
+    return NULL;
+
+  memset(s, 0, sizeof(Schedule));
+  return s;
+}
+
+/**
+ * @brief Deletes the schedule, freeing the memory.
+ * 
+ * @param s pointer to schedule
+ */
+void deleteSchedule(Schedule *s)
+{
+  free(s);
+}
+
+/**
+ * @brief Removes all the phases of the cycle. The goal is left untouched.
+ * 
+ * @param s pointer to schedule
+ */
+void scheduleClear(Schedule *s)
+{
+  s->count = 0;
+  s->length = 0;
+  s->sessions = 0;
+}
+
+/**
+ * @brief Appends a phase to the cycle, computing its offset.
+ * 
+ * @param s pointer to schedule
+ * @param phase_id id of the phase, one of the SCHEDULE_ ids
+ * @param duration duration of the phase, in minutes
+ * @return int position of the phase in the cycle, -1 if the cycle is full or the duration is not valid
+ */
+int scheduleAdd(Schedule *s, int phase_id, int duration)
+{
+  // a phase can't last longer than a day
+  if (s->count == SCHEDULE_SIZE || duration <= 0 || duration > 24 * 60)
+    return -1;
+
+  s->entries[s->count] = (ScheduleEntry){
+      .phase_id = phase_id,
+      .duration = duration,
+      .start = s->length,
+      .studied = s->sessions,
+  };
+
+  s->length += duration * 60;
+  if (phase_id == SCHEDULE_STUDY)
+    s->study_end[s->sessions++] = s->length;
+
+  return s->count++;
+}
+
+/**
+ * @brief Replaces the cycle with the classic one: a number of study phases
+ * separated by short breaks, followed by a long break.
+ * The study phases are capped to the ones fitting in the cycle.
+ * 
+ * @param s pointer to schedule
+ * @param study duration of the study phases, in minutes
+ * @param short_break duration of the short breaks, in minutes
+ * @param long_break duration of the long break, in minutes
+ * @param sessions number of study phases before the long break
+ */
+void scheduleDefault(Schedule *s, int study, int short_break, int long_break, int sessions)
+{
+  if (sessions > SCHEDULE_SIZE / 2)
+    sessions = SCHEDULE_SIZE / 2;
+
+  scheduleClear(s);
+  for (int i = 0; i < sessions; i++)
+  {
+    scheduleAdd(s, SCHEDULE_STUDY, study);
+    scheduleAdd(s, i < sessions - 1 ? SCHEDULE_SHORTBREAK : SCHEDULE_LONGBREAK, i < sessions - 1 ? short_break : long_break);
+  }
+}
+
+/**
+ * @brief Replaces the cycle with the one described by a string.
+ * The description is a list of study phases and breaks separated by spaces,
+ * each one as "STUDY/BREAK" (in minutes), optionally repeated as "STUDY/BREAKxTIMES".
+ * The last break of the cycle is the long one: "50/10x3 25/5 25/30" makes
+ * three 50 minutes study phases with 10 minutes breaks, a 25 minutes one with a 5 minutes break
+ * and a last 25 minutes one followed by a 30 minutes long break.
+ * 
+ * @param s pointer to schedule
+ * @param spec description of the cycle
+ * @return int -1 if the description is not valid, leaving the schedule untouched, 0 otherwise
+ */
+int scheduleParse(Schedule *s, const char *spec)
+{
+  Schedule parsed;
+  const char *c = spec;
+
+  scheduleClear(&parsed);
+  parsed.goal = s->goal;
+
+  while (1)
+  {
+    char *end;
+    long study, pause, times;
+
+    while (isspace((unsigned char)*c))
+      c++;
+
+    if (*c == '\0')
+      break;
+
+    study = strtol(c, &end, 10);
+    if (end == c || *end != '/')
+      return -1;
+
+    c = end + 1;
+    pause = strtol(c, &end, 10);
+    if (end == c)
+      return -1;
+
+    c = end;
+    times = 1;
+    if (*c == 'x')
+    {
+      times = strtol(c + 1, &end, 10);
+      if (end == c + 1)
+        return -1;
+      c = end;
+    }
+
+    if ((*c != '\0' && !isspace((unsigned char)*c)) || times <= 0 || times > SCHEDULE_SIZE)
+      return -1;
+
+    for (int i = 0; i < times; i++)
+      if (scheduleAdd(&parsed, SCHEDULE_STUDY, study) == -1 || scheduleAdd(&parsed, SCHEDULE_SHORTBREAK, pause) == -1)
+        return -1;
+  }
+
+  if (parsed.count == 0)
+    return -1;
+
+  // the last break ends the cycle
+  parsed.entries[parsed.count - 1].phase_id = SCHEDULE_LONGBREAK;
+
+  *s = parsed;
+  return 0;
+}
+
+/**
+ * @brief Finds the phase running at a time, provided that no phase is paused nor skipped.
+ * 
+ * @param s pointer to schedule
+ * @param seconds time since the start of the first cycle, in seconds
+ * @param offset pointer to the time elapsed in the phase, in seconds. Can be NULL
+ * @return int position of the phase in the cycle, -1 if the cycle is empty
+ */
+int scheduleAt(Schedule *s, unsigned long long seconds, int *offset)
+{
+  int low = 0, high, position;
+
+  if (s->count == 0)
+    return -1;
+
+  // the last phase starting before the time
+  position = seconds % s->length;
+  high = s->count - 1;
+  while (low < high)
+  {
+    const int mid = (low + high + 1) / 2;
+
+    if (s->entries[mid].start <= position)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+
+  if (offset != NULL)
+    *offset = position - s->entries[low].start;
+
+  return low;
+}
+
+/**
+ * @brief Finds a phase of the cycle, by id and by the number of study phases before it.
+ * 
+ * @param s pointer to schedule
+ * @param phase_id id of the phase
+ * @param studied number of study phases of the cycle before the phase, -1 to take the first one with that id
+ * @return int position of the phase in the cycle, -1 if not found
+ */
+int scheduleFind(Schedule *s, int phase_id, int studied)
+{
+  for (int i = 0; i < s->count; i++)
+    if (s->entries[i].phase_id == phase_id && (studied == -1 || s->entries[i].studied == studied))
+      return i;
+
+  return -1;
+}
+
+/**
+ * @brief Returns the time needed to complete a number of study phases,
+ * starting from the start of a phase of the cycle (the phase itself included).
+ * 
+ * @param s pointer to schedule
+ * @param entry position of the phase in the cycle
+ * @param sessions number of study phases to complete
+ * @return long long seconds, 0 if there's nothing to complete
+ */
+long long scheduleUntilStudied(Schedule *s, int entry, int sessions)
+{
+  int last;
+
+  if (sessions <= 0 || s->sessions == 0)
+    return 0;
+
+  // the last study phase to complete, counting from the start of the cycle of the entry
+  last = s->entries[entry].studied + sessions - 1;
+  return (long long)(last / s->sessions) * s->length + s->study_end[last % s->sessions] - s->entries[entry].start;
+}
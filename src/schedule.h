@@ -0,0 +1,60 @@
+/**
+ * @file schedule.h
+ * @brief Cycle of the phases, compiled once into a flat table of offsets.
+ * A cycle is a sequence of study phases and breaks, repeated all day long.
+ * Each entry knows when it starts in the cycle and how many study phases precede it,
+ * so that the phase at any time and the end of any number of study phases
+ * are found with a binary search or plain arithmetic, without walking the phases.
+ */
+
+#ifndef _SCHEDULE
+#define _SCHEDULE
+
+#include <stdlib.h> // for malloc(), free() and strtol()
+#include <string.h> // for memset()
+#include <ctype.h>  // for isspace()
+
+#define SCHEDULE_SIZE 64       // maximum number of phases in a cycle
+#define SCHEDULE_SPEC_SIZE 128 // maximum size of the description of a cycle, including the terminator
+
+static const int SCHEDULE_STUDY = 0;      // id of the study phases
+static const int SCHEDULE_SHORTBREAK = 1; // id of the short breaks
+static const int SCHEDULE_LONGBREAK = 2;  // id of the long break, ending the cycle
+
+/**
+ * @brief Struct containing a phase of the cycle.
+ * 
+ */
+typedef struct
+{
+  int phase_id; /**<  id of the phase, one of the SCHEDULE_ ids */
+  int duration; /**<  duration of the phase, in minutes */
+  int start;    /**<  start of the phase, in seconds since the start of the cycle */
+  int studied;  /**<  number of study phases of the cycle before this one */
+} ScheduleEntry;
+
+/**
+ * @brief Struct containing the compiled cycle.
+ * 
+ */
+typedef struct
+{
+  ScheduleEntry entries[SCHEDULE_SIZE]; /**<  phases of the cycle, in order */
+  int count;                            /**<  number of phases of the cycle */
+  int length;                           /**<  duration of the whole cycle, in seconds */
+  int sessions;                         /**<  number of study phases of the cycle */
+  int study_end[SCHEDULE_SIZE];         /**<  end of each study phase, in seconds since the start of the cycle */
+  int goal;                             /**<  number of study phases planned for the day */
+} Schedule;
+
+Schedule *createSchedule();
+void deleteSchedule(Schedule *s);
+void scheduleClear(Schedule *s);
+int scheduleAdd(Schedule *s, int phase_id, int duration);
+void scheduleDefault(Schedule *s, int study, int short_break, int long_break, int sessions);
+int scheduleParse(Schedule *s, const char *spec);
+int scheduleAt(Schedule *s, unsigned long long seconds, int *offset);
+int scheduleFind(Schedule *s, int phase_id, int studied);
+long long scheduleUntilStudied(Schedule *s, int entry, int sessions);
+
+#endif
@@ -0,0 +1,78 @@
+/** @file snapshot.c */
+
+#include "snapshot.h"
+
+/**
+ * @brief Creates a snapshot, with an empty state.
+ * 
+ * @return Snapshot* 
+ */
+Snapshot *createSnapshot()
+{
+  Snapshot *s;
+
+  s = malloc(sizeof(Snapshot));
+  if (s == NULL)
+    return NULL;
+
+  atomic_init(&s->sequence, 0);
+  memset(&s->state, 0, sizeof(TimerState));
+  return s;
+}
+
+/**
+ * @brief Deletes a snapshot.
+ * 
+ * @param s pointer to snapshot
+ */
+void deleteSnapshot(Snapshot *s)
+{
+  free(s);
+}
+
+/**
+ * @brief Publishes a new state. Must be called by a single writer.
+ * 
+ * @param s pointer to snapshot
+ * @param state pointer to the state to publish
+ */
+void snapshotPublish(Snapshot *s, const TimerState *state)
+{
+  unsigned int sequence;
+
+  sequence = atomic_load_explicit(&s->sequence, memory_order_relaxed);
+  // odd sequence, the readers will retry
+  atomic_store_explicit(&s->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  memcpy(&s->state, state, sizeof(TimerState));
+
+  // even sequence, the state is consistent again
+  atomic_store_explicit(&s->sequence, sequence + 2, memory_order_release);
+}
+
+/**
+ * @brief Copies the last published state.
+ * 
+ * @param s pointer to snapshot
+ * @param state pointer to the destination state
+ * @return unsigned int sequence number of the copied state, it changes every time a new state is published
+ */
+unsigned int snapshotRead(Snapshot *s, TimerState *state)
+{
+  unsigned int before, after;
+
+  do
+  {
+    // wait for the writer to finish
+    while ((before = atomic_load_explicit(&s->sequence, memory_order_acquire)) & 1)
+      ;
+
+    memcpy(state, &s->state, sizeof(TimerState));
+
+    atomic_thread_fence(memory_order_acquire);
+    after = atomic_load_explicit(&s->sequence, memory_order_relaxed);
+  } while (before != after);
+
+  return before;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file snapshot.h
+ * @brief Lock-free snapshot of the timer state.
+ * The state is published by a single writer, the event loop, through a seqlock.
+ * Readers copy the whole state without taking any lock and retry
+ * only if a write happened during the copy, so they always see a consistent state
+ * and can never stall the writer.
+ */
+
+#ifndef _SNAPSHOT
+#define _SNAPSHOT
+
+#include <stdlib.h>    // for malloc() and free()
+#include <string.h>    // for memcpy()
+#include <stdatomic.h> // for atomic_uint
+
+#include "terminal.h"
+
+#define SNAPSHOT_NAME_SIZE 32 // maximum size of the phase name, including the terminator
+
+/**
+ * @brief Struct containing the timer state, as seen by the readers.
+ * 
+ */
+typedef struct
+{
+  int phase_id;                        /**<  id of the current phase */
+  char phase_name[SNAPSHOT_NAME_SIZE]; /**<  name of the current phase */
+  int phase_duration;                  /**<  duration of the current phase, in minutes */
+  int phase_completed;                 /**<  number of times the current phase has been completed */
+  int phase_repetitions;               /**<  number of repetitions of the current phase */
+  int phase_is_study;                  /**<  is the current phase a study phase? */
+  style phase_fg_color;                /**<  text color of the current phase */
+  int phase_elapsed;                   /**<  time elapsed in the current phase, in seconds */
+  int phase_remaining;                 /**<  time remaining in the current phase, in seconds */
+  int study_elapsed;                   /**<  total time studied today, in seconds */
+  int study_phases;                    /**<  number of study phases completed today */
+  int goal_remaining;                  /**<  time until the study phases planned for the day are completed, in seconds, -1 if they are */
+  int time_paused;                     /**<  is the time paused? */
+  unsigned long long deadline;         /**<  end of the current phase (monotonic milliseconds), 0 if paused */
+  int quote_id;                        /**<  index of the displayed quote, -1 if none */
+  int transitions;                     /**<  number of phase transitions since the timer started */
+  int tone_repetitions;                /**<  number of tones of the last phase transition */
+  int tone_speed;                      /**<  speed of the tones of the last phase transition */
+} TimerState;
+
+/**
+ * @brief Struct containing the published state and its sequence number.
+ * The sequence is odd while a write is in progress.
+ * 
+ */
+typedef struct
+{
+  atomic_uint sequence; /**<  sequence number, incremented twice by every publish */
+  TimerState state;     /**<  last published state */
+} Snapshot;
+
+Snapshot *createSnapshot();
+void deleteSnapshot(Snapshot *s);
+void snapshotPublish(Snapshot *s, const TimerState *state);
+unsigned int snapshotRead(Snapshot *s, TimerState *state);
+
+#endif
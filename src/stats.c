@@ -0,0 +1,329 @@
+/** @file stats.c */
+
+#define _DEFAULT_SOURCE // for clock_gettime()
+
+#include "stats.h"
+
+// Definition of private functions, so that linter and compiler are happy
+
+unsigned long long _statsNow();
+void _histogramAdd(Histogram *h, unsigned long long us);
+unsigned long long _histogramPercentile(Histogram *h, int percentile);
+void _histogramDump(Histogram *h, const char *name, FILE *fp);
+
+/**
+ * @internal
+ * @brief Returns the time of a monotonic clock, in microseconds.
+ * 
+ * @return unsigned long long
+ */
+unsigned long long _statsNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @internal
+ * @brief Adds a sample to a histogram.
+ * 
+ * @param h pointer to histogram
+ * @param us duration, in microseconds
+ */
+void _histogramAdd(Histogram *h, unsigned long long us)
+{
+  int bucket;
+
+  // number of significant bits of the duration
+  bucket = 0;
+  for (unsigned long long v = us; v > 0 && bucket < STATS_BUCKETS - 1; v >>= 1)
+    bucket++;
+
+  h->buckets[bucket]++;
+  h->count++;
+  h->total += us;
+  if (us > h->max)
+    h->max = us;
+}
+
+/**
+ * @internal
+ * @brief Estimates a percentile of a histogram, as the upper bound of its bucket.
+ * 
+ * @param h pointer to histogram
+ * @param percentile percentile, in range [0-100]
+ * @return unsigned long long estimate, in microseconds
+ */
+unsigned long long _histogramPercentile(Histogram *h, int percentile)
+{
+  unsigned long long seen, target;
+
+  if (h->count == 0)
+    return 0;
+
+  target = (h->count * percentile + 99) / 100;
+  seen = 0;
+  for (int i = 0; i < STATS_BUCKETS; i++)
+  {
+    seen += h->buckets[i];
+    if (seen >= target)
+    {
+      unsigned long long bound = (1ULL << i) - 1;
+      // no bucket goes beyond the longest sample
+      return bound < h->max ? bound : h->max;
+    }
+  }
+
+  return h->max;
+}
+
+/**
+ * @internal
+ * @brief Writes a histogram to a file, one line per non empty bucket.
+ * 
+ * @param h pointer to histogram
+ * @param name name of the histogram
+ * @param fp pointer to file
+ */
+void _histogramDump(Histogram *h, const char *name, FILE *fp)
+{
+  fprintf(fp, "%s: count %llu, mean %llu us, p50 %llu us, p99 %llu us, max %llu us\n",
+          name, h->count, h->count ? h->total / h->count : 0,
+          _histogramPercentile(h, 50), _histogramPercentile(h, 99), h->max);
+
+  for (int i = 0; i < STATS_BUCKETS; i++)
+  {
+    if (h->buckets[i] == 0)
+      continue;
+
+    if (i == STATS_BUCKETS - 1)
+      fprintf(fp, "  >= %llu us: %llu\n", 1ULL << (i - 1), h->buckets[i]);
+    else
+      fprintf(fp, "  < %llu us: %llu\n", 1ULL << i, h->buckets[i]);
+  }
+}
+
+/**
+ * @brief Creates the counters, all set to zero.
+ * 
+ * @param enabled 1 to start recording immediately, 0 otherwise
+ * @return Stats*
+ */
+Stats *createStats(int enabled)
+{
+  Stats *s;
+
+  s = malloc(sizeof(Stats));
+  if (s == NULL)
+    return NULL;
+
+  memset(s, 0, sizeof(Stats));
+  if (enabled)
+    statsEnable(s);
+
+  return s;
+}
+
+/**
+ * @brief Deletes the counters.
+ * 
+ * @param s pointer to stats
+ */
+void deleteStats(Stats *s)
+{
+  free(s);
+}
+
+/**
+ * @brief Starts recording. Nothing happens if the recording has already started.
+ * 
+ * @param s pointer to stats
+ */
+void statsEnable(Stats *s)
+{
+  if (s->enabled)
+    return;
+
+  s->enabled = 1;
+  s->started = _statsNow();
+  s->second_start = s->started;
+}
+
+/**
+ * @brief Returns the clock of the probes, recording or not.
+ * 
+ * @return unsigned long long monotonic microseconds
+ */
+unsigned long long statsClock()
+{
+  return _statsNow();
+}
+
+/**
+ * @brief Records the time to the first frame, recording or not.
+ * Only the first call counts.
+ * 
+ * @param s pointer to stats
+ * @param started start of the process, as returned by statsClock()
+ */
+void statsStartup(Stats *s, unsigned long long started)
+{
+  if (s->startup == 0 && started != 0)
+    s->startup = _statsNow() - started;
+}
+
+/**
+ * @brief Starts timing an operation.
+ * 
+ * @param s pointer to stats
+ * @return unsigned long long start of the operation, to be passed to statsRecord(). 0 if disabled
+ */
+unsigned long long statsStart(Stats *s)
+{
+  if (!s->enabled)
+    return 0;
+
+  return _statsNow();
+}
+
+/**
+ * @brief Ends timing an operation, adding its duration to a histogram.
+ * 
+ * @param s pointer to stats
+ * @param h pointer to histogram
+ * @param start value returned by statsStart()
+ */
+void statsRecord(Stats *s, Histogram *h, unsigned long long start)
+{
+  // the recording started during the operation
+  if (!s->enabled || start == 0)
+    return;
+
+  _histogramAdd(h, _statsNow() - start);
+}
+
+/**
+ * @brief Counts a wakeup of the event loop.
+ * 
+ * @param s pointer to stats
+ */
+void statsWakeup(Stats *s)
+{
+  unsigned long long now;
+
+  if (!s->enabled)
+    return;
+
+  now = _statsNow();
+  s->wakeups++;
+
+  if (now - s->second_start >= 1000000)
+  {
+    // a second (or more) has passed, the rate refers to the last one
+    s->wakeups_rate = now - s->second_start < 2000000 ? s->second_wakeups : 0;
+    s->second_start = now;
+    s->second_wakeups = 0;
+  }
+
+  s->second_wakeups++;
+}
+
+/**
+ * @brief Counts a flushed frame.
+ * 
+ * @param s pointer to stats
+ * @param frame output of the frame, as returned by frame_get_stats()
+ */
+void statsFrame(Stats *s, FrameStats frame)
+{
+  if (!s->enabled)
+    return;
+
+  s->frames++;
+  s->bytes += frame.bytes;
+  s->writes += frame.writes;
+  s->last_frame = frame;
+}
+
+/**
+ * @brief Places a summary of the counters into a window, replacing its lines.
+ * 
+ * @param s pointer to stats
+ * @param w pointer to window
+ * @return int number of placed lines
+ */
+int statsPlace(Stats *s, Window *w)
+{
+  char line[STATS_LINE_SIZE];
+  double uptime;
+
+  windowDeleteAllLines(w);
+
+  uptime = (_statsNow() - s->started) / 1e6;
+
+  snprintf(line, STATS_LINE_SIZE, "wakeups: %llu, %llu/s, %.2f/s average",
+           s->wakeups, s->wakeups_rate, uptime > 0 ? s->wakeups / uptime : 0);
+  windowAddLine(w, line);
+
+  snprintf(line, STATS_LINE_SIZE, "frames: %llu, last %i B in %i writes",
+           s->frames, s->last_frame.bytes, s->last_frame.writes);
+  windowAddLine(w, line);
+
+  snprintf(line, STATS_LINE_SIZE, "build p50/p99: %llu/%llu us, flush p50/p99: %llu/%llu us",
+           _histogramPercentile(&s->frame_build, 50), _histogramPercentile(&s->frame_build, 99),
+           _histogramPercentile(&s->frame_flush, 50), _histogramPercentile(&s->frame_flush, 99));
+  windowAddLine(w, line);
+
+  snprintf(line, STATS_LINE_SIZE, "save max: %llu us, lock wait max: %llu us, startup: %.1f ms",
+           s->save.max, s->lock_wait.max, s->startup / 1e3);
+  windowAddLine(w, line);
+
+  return 4;
+}
+
+/**
+ * @brief Writes all the counters and histograms to a file, replacing it.
+ * 
+ * @param s pointer to stats
+ * @param path path of the file
+ * @return int -1 in case of error, 0 otherwise
+ */
+int statsDump(Stats *s, const char *path)
+{
+  FILE *fp;
+  double uptime;
+  int ret;
+
+  fp = fopen(path, "w");
+  if (fp == NULL)
+    return -1;
+
+  if (!s->enabled)
+  {
+    fprintf(fp, "recording disabled\n");
+    fprintf(fp, "startup: %.3f ms to the first frame\n", s->startup / 1e3);
+    return fclose(fp) == 0 ? 0 : -1;
+  }
+
+  uptime = (_statsNow() - s->started) / 1e6;
+
+  fprintf(fp, "uptime: %.3f s\n", uptime);
+  fprintf(fp, "startup: %.3f ms to the first frame\n", s->startup / 1e3);
+  fprintf(fp, "wakeups: %llu, last second %llu/s, average %.2f/s\n",
+          s->wakeups, s->wakeups_rate, uptime > 0 ? s->wakeups / uptime : 0);
+  fprintf(fp, "frames: %llu, bytes %llu, writes %llu, average %.1f B and %.2f writes per frame\n",
+          s->frames, s->bytes, s->writes,
+          s->frames ? (double)s->bytes / s->frames : 0, s->frames ? (double)s->writes / s->frames : 0);
+
+  _histogramDump(&s->frame_build, "frame build", fp);
+  _histogramDump(&s->frame_flush, "frame flush", fp);
+  _histogramDump(&s->save, "save", fp);
+  _histogramDump(&s->lock_wait, "terminal lock wait", fp);
+
+  ret = ferror(fp) ? -1 : 0;
+  if (fclose(fp) != 0)
+    ret = -1;
+
+  return ret;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file stats.h
+ * @brief Runtime instrumentation of the timer.
+ * Counters and histograms of the hot paths: wakeups of the event loop, time spent building
+ * and flushing frames, bytes and syscalls per frame, save latency and wait time on the terminal lock.
+ * While disabled, every probe is a single branch, and the clock is never read,
+ * except once to measure the time to the first frame.
+ */
+
+#ifndef _STATS
+#define _STATS
+
+#include <stdio.h>  // for fprintf()
+#include <stdlib.h> // for malloc() and free()
+#include <string.h> // for memset()
+#include <time.h>   // for clock_gettime()
+
+#include "terminal.h"
+
+#define STATS_BUCKETS 20 // buckets of the histograms, powers of two of microseconds
+
+static const int STATS_LINE_SIZE = 80; // maximum size of a line of the overlay
+
+/**
+ * @brief Struct containing a histogram of durations.
+ * Bucket i holds the durations in [2^(i-1), 2^i) microseconds, the last one everything longer.
+ * 
+ */
+typedef struct
+{
+  unsigned long long count;                  /**<  number of samples */
+  unsigned long long total;                  /**<  sum of the samples, in microseconds */
+  unsigned long long max;                    /**<  longest sample, in microseconds */
+  unsigned long long buckets[STATS_BUCKETS]; /**<  number of samples in each bucket */
+} Histogram;
+
+/**
+ * @brief Struct containing all the counters and histograms.
+ * 
+ */
+typedef struct
+{
+  int enabled;                       /**<  are the probes recording? */
+  unsigned long long started;        /**<  when the recording started, monotonic microseconds */
+  unsigned long long wakeups;        /**<  wakeups of the event loop */
+  unsigned long long second_start;   /**<  start of the current second, monotonic microseconds */
+  unsigned long long second_wakeups; /**<  wakeups in the current second */
+  unsigned long long wakeups_rate;   /**<  wakeups in the last complete second */
+  unsigned long long frames;         /**<  flushed frames */
+  unsigned long long bytes;          /**<  bytes written by the flushed frames */
+  unsigned long long writes;         /**<  write syscalls made by the flushed frames */
+  FrameStats last_frame;             /**<  output of the last flushed frame */
+  Histogram frame_build;             /**<  time spent building the frames */
+  Histogram frame_flush;             /**<  time spent flushing the frames */
+  Histogram save;                    /**<  time spent saving */
+  Histogram lock_wait;               /**<  time spent waiting for the terminal lock */
+  unsigned long long startup;        /**<  time from the start to the first frame, microseconds, 0 until known */
+} Stats;
+
+Stats *createStats(int enabled);
+void deleteStats(Stats *s);
+void statsEnable(Stats *s);
+unsigned long long statsClock();
+void statsStartup(Stats *s, unsigned long long started);
+unsigned long long statsStart(Stats *s);
+void statsRecord(Stats *s, Histogram *h, unsigned long long start);
+void statsWakeup(Stats *s);
+void statsFrame(Stats *s, FrameStats frame);
+int statsPlace(Stats *s, Window *w);
+int statsDump(Stats *s, const char *path);
+
+#endif
@@ -9,17 +9,14 @@
  */
 typedef struct phase
 {
-  char *name;               // name of the phase
-  int id;                   // id of the phase
-  int duration;             // duration of the phase
-  int repetitions;          // number of repetitions of the phase
-  int completed;            // number of time the phase has been completed
-  int is_study;             // is this a phase where I should study?
-  clock_t started;          // when the phase started
-  style fg_color;           // text color of the phase window
-  style bg_color;           // background color of the phase window
-  struct phase *next;       // pointer to next phase
-  struct phase *next_after; // pointer to phase when the repetitions have ended
+  const char *name;           // name of the phase
+  int id;                     // id of the phase
+  int duration;               // duration of the current phase of this kind, minutes
+  int is_study;               // is this a phase where I should study?
+  unsigned long long started; // when the phase started (monotonic milliseconds)
+  unsigned long long paused;  // milliseconds spent paused since the phase started
+  style fg_color;             // text color of the phase window
+  style bg_color;             // background color of the phase window
 } Phase;
 
 /**
@@ -30,9 +27,14 @@ typedef struct windows
 {
   Window *w_phase;    // window showing current phase
   Window *w_total;    // window showing total time studied
+  Window *w_timers;   // window showing the countdowns
   Window *w_quote;    // window showing a quote
   Window *w_controls; // window showing keyboard controls
   Window *w_paused;   // window telling if the timer is currently paused
+  Window *w_debug;    // hidden window showing the instrumentation
+  Bar *b_phase;       // progress bar below the phase window
+  style *ramps[3];    // colors of the progress bar, one ramp for each phase id
+  Layout *layout;     // placement of the windows, centered in the terminal
 } Windows;
 
 /**
@@ -46,16 +48,28 @@ typedef struct tone
 } Tone;
 
 /**
- * @brief Struct containing return values from routines
+ * @brief Struct containing the content of the save file
  * 
  */
-typedef struct return_values
+typedef struct save
 {
-  int show_routine;     // return value from show routine
-  int advance_routine;  // return value from advance routine
-  int save_routine;     // return value from save routine
-  int keypress_routine; // return value from keypress routine
-} ReturnValues;
+  int phase_elapsed;   // time elapsed in the saved phase
+  int study_elapsed;   // total time studied in the session, the saved phase included
+  int study_phases;    // amount of studied phases
+  int phase_id;        // id of the saved phase
+  int phase_completed; // number of study phases of the cycle before the saved phase
+} Save;
+
+/**
+ * @brief Struct containing the content of the settings file
+ * 
+ */
+typedef struct settings
+{
+  int durations[4];               // study, short break and long break durations (minutes), then study sessions
+  int goal;                       // study sessions planned for the day
+  char cycle[SCHEDULE_SPEC_SIZE]; // description of the cycle, empty to use the durations
+} Settings;
 
 /**
  * @brief Struct containing all parameters for the routines
@@ -63,18 +77,46 @@ typedef struct return_values
  */
 typedef struct parameters
 {
-  int loop;                        // are the routines looping?
+  int loop;                        // is the event loop running?
+  int headless;                    // is the timer running without interface?
+  int focused;                     // does the terminal have the focus? Nothing is drawn otherwise
+  int simulated;                   // is the time virtual? Dialogs are then answered yes at once
+  int remote;                      // socket of the remote timer shown by the interface, -1 if the timer is local
   int study_phases;                // amount of currently studied phases
   int windows_force_reload;        // flag to force redraw of the windows
+  unsigned long long resize_due;   // when the pending resize gets laid out (monotonic milliseconds), 0 if none
   int phase_elapsed;               // total time elapsed in the current phase
   int study_elapsed;               // total time studied in the session
   int previous_elapsed;            // elapsed loaded from file
-  int time_paused, frozen_elapsed; // flag to pause time
-  ReturnValues *return_values;     // return values of threads
+  int time_paused;                 // flag to pause time
+  unsigned long long paused_at;    // when the time was paused (monotonic milliseconds)
+  int save_pending;                // has the state changed since the last save?
+  int transitions;                 // number of phase transitions (last seen, if the timer is remote)
+  int quote_id;                    // index of the current quote
+  int quote_shown;                 // index of the quote shown in the quote window
+  int quote_pending;               // are the quotes yet to be loaded? They are after the first frame
+  unsigned long long last_save;    // time (monotonic milliseconds) of the last save
+  int fsync;                       // fsync policy of the saves, one of the FSYNC_ values
+  unsigned long long started;      // when the process started, as returned by statsClock(), 0 if unknown
   Phase *current_phase;            // current phase of the timer
+  Phase *phases;                   // kinds of phases, indexed by id, NULL if the timer is remote
+  Schedule *schedule;              // cycle of the phases, NULL if the timer is remote
+  int entry;                       // position of the current phase in the cycle
+  int goal_left;                   // seconds from the start of the current phase until the daily goal is reached, -1 if it is
   pthread_mutex_t *terminal_lock;  // terminal lock using mutex
   Windows *windows;                // displayed windows
-  Tone *tone;                      // handles tone parameters
+  QuoteIndex *quotes;              // index of the quotes file
+  History *history;                // history of the completed phases
+  Snapshot *snapshot;              // published timer state, read without locks
+  Server *server;                  // socket serving the timer state, NULL if not available
+  Tone *tone;                      // tone of the last phase transition
+  Stats *stats;                    // instrumentation of the hot paths
+  Notifier *notifier;              // worker playing the notifications of the phase transitions
+  Timers *timers;                  // deadlines of the phase and of the countdowns
+  Sync *sync;                      // logs shared with the other devices, NULL if not syncing
+  Dialog *dialog;                  // dialog waiting for an answer, NULL if none
+  int dialog_action;               // what the dialog is asking, one of the DIALOG_ values
+  Save save;                       // save found at startup, loaded if the session is resumed
 } Parameters;
 
 #endif
\ No newline at end of file
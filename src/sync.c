@@ -0,0 +1,424 @@
+/** @file sync.c */
+
+#define _DEFAULT_SOURCE // for pread()
+
+#include "sync.h"
+
+// Definition of private functions, so that linter and compiler are happy
+
+void _syncPut(unsigned char *buffer, uint64_t value, int bytes);
+uint64_t _syncGet(unsigned char *buffer, int bytes);
+void _syncEncode(SyncRecord *record, unsigned char *buffer);
+void _syncDecode(unsigned char *buffer, SyncRecord *record);
+int _syncNewer(Sync *s, SyncRecord *record, const char *name);
+SyncPeer *_syncPeer(Sync *s, const char *name);
+int _syncReadPeer(Sync *s, SyncPeer *peer, SyncHandler handler, void *args, int *changed);
+
+/**
+ * @internal
+ * @brief Stores an integer, little endian.
+ * 
+ * @param buffer destination buffer
+ * @param value value to store
+ * @param bytes size of the integer, in bytes
+ */
+void _syncPut(unsigned char *buffer, uint64_t value, int bytes)
+{
+  for (int i = 0; i < bytes; i++)
+    buffer[i] = value >> (8 * i);
+}
+
+/**
+ * @internal
+ * @brief Loads an integer, little endian.
+ * 
+ * @param buffer source buffer
+ * @param bytes size of the integer, in bytes
+ * @return uint64_t
+ */
+uint64_t _syncGet(unsigned char *buffer, int bytes)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++)
+    value |= (uint64_t)buffer[i] << (8 * i);
+  return value;
+}
+
+/**
+ * @internal
+ * @brief Encodes a record of the log.
+ * 
+ * @param record pointer to the record
+ * @param buffer SYNC_RECORD_SIZE bytes, as stored in the log
+ */
+void _syncEncode(SyncRecord *record, unsigned char *buffer)
+{
+  memset(buffer, 0, SYNC_RECORD_SIZE);
+  buffer[0] = record->version;
+  buffer[1] = record->type;
+  buffer[2] = record->flags;
+  buffer[3] = record->phase_id;
+  _syncPut(buffer + 4, record->sequence, 4);
+  _syncPut(buffer + 8, (uint32_t)record->entry, 4);
+  _syncPut(buffer + 12, (uint32_t)record->value, 4);
+  _syncPut(buffer + 16, (uint64_t)record->time, 8);
+  // the last bytes are reserved to the next versions
+}
+
+/**
+ * @internal
+ * @brief Decodes a record of the log.
+ * 
+ * @param buffer SYNC_RECORD_SIZE bytes, as stored in the log
+ * @param record pointer to the record to fill
+ */
+void _syncDecode(unsigned char *buffer, SyncRecord *record)
+{
+  *record = (SyncRecord){
+      .version = buffer[0],
+      .type = buffer[1],
+      .flags = buffer[2],
+      .phase_id = buffer[3],
+      .sequence = _syncGet(buffer + 4, 4),
+      .entry = (int32_t)_syncGet(buffer + 8, 4),
+      .value = (int32_t)_syncGet(buffer + 12, 4),
+      .time = (int64_t)_syncGet(buffer + 16, 8),
+  };
+}
+
+/**
+ * @internal
+ * @brief Checks if a state record is newer than the latest one.
+ * Records with the same sequence number have been written at the same time by two devices,
+ * the one with the greatest name wins, so that all the devices agree.
+ * 
+ * @param s pointer to sync
+ * @param record pointer to the record
+ * @param name name of the device that wrote the record
+ * @return int 1 if the record is newer, 0 otherwise
+ */
+int _syncNewer(Sync *s, SyncRecord *record, const char *name)
+{
+  if (record->sequence != s->state.sequence)
+    return record->sequence > s->state.sequence;
+
+  return strcmp(name, s->state_name) > 0;
+}
+
+/**
+ * @internal
+ * @brief Finds another device by name, adding it if it's new.
+ * 
+ * @param s pointer to sync
+ * @param name name of the device
+ * @return SyncPeer* pointer to the device, NULL if there's no room for it
+ */
+SyncPeer *_syncPeer(Sync *s, const char *name)
+{
+  for (int i = 0; i < s->peers_count; i++)
+    if (strcmp(s->peers[i].name, name) == 0)
+      return s->peers + i;
+
+  if (s->peers_count == SYNC_MAX_PEERS)
+    return NULL;
+
+  SyncPeer *peer = s->peers + s->peers_count++;
+  strncpy(peer->name, name, SYNC_NAME_SIZE - 1);
+  peer->name[SYNC_NAME_SIZE - 1] = '\0';
+  peer->offset = 0;
+  return peer;
+}
+
+/**
+ * @internal
+ * @brief Reads the records appended to the log of another device since the last read.
+ * The completed study phases are passed to the handler, while state records
+ * only replace the latest state, if newer.
+ * 
+ * @param s pointer to sync
+ * @param peer pointer to the device
+ * @param handler function handling the completed study phases
+ * @param args arguments of the handler
+ * @param changed pointer to a flag, set if the latest state has been replaced
+ * @return int number of records read, -1 in case of error
+ */
+int _syncReadPeer(Sync *s, SyncPeer *peer, SyncHandler handler, void *args, int *changed)
+{
+  unsigned char buffer[SYNC_BATCH_SIZE * SYNC_RECORD_SIZE];
+  char path[SYNC_PATH_SIZE];
+  struct stat st;
+  off_t size;
+  int fd, read_records = 0;
+
+  if (snprintf(path, SYNC_PATH_SIZE, "%s/%s.sync", s->dir, peer->name) >= SYNC_PATH_SIZE)
+    return -1;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    return -1;
+
+  // a record still being transferred is read later
+  fstat(fd, &st);
+  size = st.st_size - st.st_size % SYNC_RECORD_SIZE;
+
+  // a log replaced by a shorter one is read from its end
+  if (size < peer->offset)
+    peer->offset = size;
+
+  while (peer->offset < size)
+  {
+    const int count = (size - peer->offset) / SYNC_RECORD_SIZE < SYNC_BATCH_SIZE ? (size - peer->offset) / SYNC_RECORD_SIZE : SYNC_BATCH_SIZE;
+
+    if (pread(fd, buffer, (size_t)count * SYNC_RECORD_SIZE, peer->offset) != (ssize_t)count * SYNC_RECORD_SIZE)
+      break;
+
+    for (int i = 0; i < count; i++)
+    {
+      SyncRecord record;
+      _syncDecode(buffer + i * SYNC_RECORD_SIZE, &record);
+
+      // records of newer versions can't be understood
+      if (record.version == 0 || record.version > SYNC_VERSION)
+        continue;
+
+      if (record.sequence > s->sequence)
+        s->sequence = record.sequence;
+
+      if (record.type == SYNC_SESSION)
+      {
+        handler(args, &record);
+      }
+      else if (_syncNewer(s, &record, peer->name))
+      {
+        s->state = record;
+        strncpy(s->state_name, peer->name, SYNC_NAME_SIZE - 1);
+        *changed = 1;
+      }
+    }
+
+    peer->offset += (off_t)count * SYNC_RECORD_SIZE;
+    read_records += count;
+  }
+
+  close(fd);
+  return read_records;
+}
+
+/**
+ * @brief Opens the log of this device in a shared directory, creating it if needed.
+ * The logs of the other devices are read by the first call to syncPoll().
+ * 
+ * @param dir shared directory
+ * @param name name of this device, unique among the devices
+ * @return Sync* pointer to sync, NULL in case of error
+ */
+Sync *createSync(const char *dir, const char *name)
+{
+  unsigned char buffer[SYNC_RECORD_SIZE];
+  char path[SYNC_PATH_SIZE];
+  struct stat st;
+  Sync *s;
+
+  // the name is a file name
+  if (name[0] == '\0' || strchr(name, '/') != NULL || strlen(name) >= SYNC_NAME_SIZE || strlen(dir) >= SYNC_PATH_SIZE)
+    return NULL;
+
+  if (snprintf(path, SYNC_PATH_SIZE, "%s/%s.sync", dir, name) >= SYNC_PATH_SIZE)
+    return NULL;
+
+  s = malloc(sizeof(Sync));
+  if (s == NULL)
+    return NULL;
+
+  memset(s, 0, sizeof(Sync));
+  strncpy(s->dir, dir, SYNC_PATH_SIZE - 1);
+  strncpy(s->name, name, SYNC_NAME_SIZE - 1);
+  s->pending = 1;
+
+  s->fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (s->fd == -1)
+  {
+    free(s);
+    return NULL;
+  }
+
+  // a partially written record is discarded
+  fstat(s->fd, &st);
+  if (st.st_size % SYNC_RECORD_SIZE)
+    ftruncate(s->fd, st.st_size - st.st_size % SYNC_RECORD_SIZE);
+
+  // the sequence goes on from the last record, which holds the last state written
+  if (st.st_size >= SYNC_RECORD_SIZE &&
+      pread(s->fd, buffer, SYNC_RECORD_SIZE, st.st_size - st.st_size % SYNC_RECORD_SIZE - SYNC_RECORD_SIZE) == SYNC_RECORD_SIZE)
+  {
+    SyncRecord record;
+    _syncDecode(buffer, &record);
+    s->sequence = record.sequence;
+
+    if (record.type != SYNC_SESSION)
+    {
+      s->state = record;
+      strncpy(s->state_name, s->name, SYNC_NAME_SIZE - 1);
+    }
+  }
+
+  // without inotify, the other devices are read only once
+  s->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (s->watch_fd != -1 && inotify_add_watch(s->watch_fd, dir, IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1)
+  {
+    close(s->watch_fd);
+    s->watch_fd = -1;
+  }
+
+  return s;
+}
+
+/**
+ * @brief Closes the logs, freeing the memory.
+ * 
+ * @param s pointer to sync
+ */
+void deleteSync(Sync *s)
+{
+  if (!s)
+    return;
+
+  close(s->fd);
+  if (s->watch_fd != -1)
+    close(s->watch_fd);
+
+  free(s);
+}
+
+/**
+ * @brief Returns the descriptor to poll, readable when the shared directory changes.
+ * 
+ * @param s pointer to sync
+ * @return int file descriptor, -1 if not available
+ */
+int syncFd(Sync *s)
+{
+  return s->watch_fd;
+}
+
+/**
+ * @brief Appends a record to the log of this device, with a single write.
+ * 
+ * @param s pointer to sync
+ * @param type type of the record
+ * @param flags SYNC_PAUSED if the time is paused
+ * @param phase_id id of the phase
+ * @param entry position of the phase in the cycle
+ * @param value seconds elapsed in the phase, or duration of the completed study phase
+ * @param time wall clock time of the change, or start of the completed study phase
+ * @return int -1 in case of error, 0 otherwise
+ */
+int syncAppend(Sync *s, int type, int flags, int phase_id, int entry, int value, int64_t time)
+{
+  unsigned char buffer[SYNC_RECORD_SIZE];
+  SyncRecord record = {
+      .version = SYNC_VERSION,
+      .type = type,
+      .flags = flags,
+      .phase_id = phase_id,
+      .sequence = s->sequence + 1,
+      .entry = entry,
+      .value = value,
+      .time = time,
+  };
+
+  _syncEncode(&record, buffer);
+  if (write(s->fd, buffer, SYNC_RECORD_SIZE) != SYNC_RECORD_SIZE)
+    return -1;
+
+  s->sequence = record.sequence;
+  if (type != SYNC_SESSION)
+  {
+    s->state = record;
+    strncpy(s->state_name, s->name, SYNC_NAME_SIZE - 1);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Reads the records appended by the other devices since the last call.
+ * Every completed study phase is passed to the handler, followed by the latest state,
+ * only if it has been written by another device since the last call.
+ * Nothing is read unless a log of another device has changed.
+ * 
+ * @param s pointer to sync
+ * @param handler function handling the records
+ * @param args arguments of the handler
+ * @return int number of records read, -1 in case of error
+ */
+int syncPoll(Sync *s, SyncHandler handler, void *args)
+{
+  char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  struct dirent *entry;
+  ssize_t len;
+  int changed = 0, read_records = 0;
+  DIR *d;
+
+  // the changes of the log of this device are not worth a read
+  while (s->watch_fd != -1 && (len = read(s->watch_fd, events, sizeof(events))) > 0)
+  {
+    for (char *c = events; c < events + len;)
+    {
+      const struct inotify_event *event = (const struct inotify_event *)c;
+      const size_t name_len = strlen(s->name);
+
+      if (event->len == 0 || strncmp(event->name, s->name, name_len) != 0 || strcmp(event->name + name_len, ".sync") != 0)
+        s->pending = 1;
+
+      c += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  if (!s->pending)
+    return 0;
+
+  d = opendir(s->dir);
+  if (d == NULL)
+    return -1;
+
+  s->pending = 0;
+  while ((entry = readdir(d)) != NULL)
+  {
+    char name[SYNC_NAME_SIZE];
+    const int name_len = (int)strlen(entry->d_name) - 5;
+    SyncPeer *peer;
+    int ret;
+
+    // logs are named after their device
+    if (name_len <= 0 || name_len >= SYNC_NAME_SIZE || strcmp(entry->d_name + name_len, ".sync") != 0)
+      continue;
+
+    memcpy(name, entry->d_name, name_len);
+    name[name_len] = '\0';
+    if (strcmp(name, s->name) == 0 || (peer = _syncPeer(s, name)) == NULL)
+      continue;
+
+    if ((ret = _syncReadPeer(s, peer, handler, args, &changed)) > 0)
+      read_records += ret;
+  }
+
+  closedir(d);
+
+  if (changed)
+    handler(args, &s->state);
+
+  return read_records;
+}
+
+/**
+ * @brief Checks if the latest state has been written by another device,
+ * which is then the one counting the completed study phases.
+ * 
+ * @param s pointer to sync
+ * @return int 1 if this device is following another one, 0 otherwise
+ */
+int syncFollowing(Sync *s)
+{
+  return s->state.sequence != 0 && strcmp(s->state_name, s->name) != 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file sync.h
+ * @brief State sync across devices, through append-only logs of delta records.
+ * Each device appends a small record to its own log, in a shared directory, whenever its state
+ * changes (a phase is entered, paused or resumed, a study phase is completed), and reads only
+ * the records that the other devices have appended since the last read, when the directory changes.
+ * Every record carries a sequence number, greater than any one seen before it was written,
+ * so that the latest state wins whatever the order in which the logs are read.
+ * As logs are only appended to, a file sync tool transfers a few bytes for each change.
+ * All integers are stored little endian, so that files can be moved across machines.
+ */
+
+#ifndef _SYNC
+#define _SYNC
+
+#include <stdio.h>       // for snprintf()
+#include <stdlib.h>      // for malloc() and free()
+#include <string.h>      // for strncpy() and strcmp()
+#include <fcntl.h>       // for open()
+#include <unistd.h>      // for pread() and write()
+#include <dirent.h>      // for opendir()
+#include <sys/stat.h>    // for fstat()
+#include <sys/inotify.h> // for inotify_init1()
+#include <stdint.h>      // for int64_t
+
+#define SYNC_NAME_SIZE 64  // maximum size of the name of a device, including the terminator
+#define SYNC_PATH_SIZE 256 // maximum size of the path of a log, including the terminator
+#define SYNC_MAX_PEERS 16  // maximum number of other devices
+#define SYNC_BATCH_SIZE 64 // maximum number of records read at once
+
+static const int SYNC_RECORD_SIZE = 32; // size of a record of the log
+static const int SYNC_VERSION = 1;      // version of the records, older ones are read, newer ones skipped
+static const int SYNC_PHASE = 1;        // record of a phase being entered
+static const int SYNC_PAUSE = 2;        // record of the time being paused
+static const int SYNC_RESUME = 3;       // record of the time being resumed
+static const int SYNC_SESSION = 4;      // record of a completed study phase
+static const int SYNC_PAUSED = 1;       // flag of the records written while the time is paused
+
+/**
+ * @brief Struct containing a delta record.
+ * The phase, pause and resume records hold the whole state of the phase,
+ * so that the latest one alone is enough to follow another device.
+ * 
+ */
+typedef struct
+{
+  uint8_t version;   /**<  version of the record */
+  uint8_t type;      /**<  type of the record, one of SYNC_PHASE, SYNC_PAUSE, SYNC_RESUME or SYNC_SESSION */
+  uint8_t flags;     /**<  SYNC_PAUSED if the time is paused */
+  uint8_t phase_id;  /**<  id of the phase */
+  uint32_t sequence; /**<  sequence number, greater than any one seen by the device when it was written */
+  int32_t entry;     /**<  position of the phase in the cycle */
+  int32_t value;     /**<  seconds elapsed in the phase, or duration of the completed study phase */
+  int64_t time;      /**<  wall clock time of the change, or start of the completed study phase, seconds since epoch */
+} SyncRecord;
+
+/**
+ * @brief Function handling a record appended by another device.
+ * 
+ */
+typedef void (*SyncHandler)(void *args, SyncRecord *record);
+
+/**
+ * @brief Struct containing another device and how much of its log has been read.
+ * 
+ */
+typedef struct
+{
+  char name[SYNC_NAME_SIZE]; /**<  name of the device, the name of its log without extension */
+  off_t offset;              /**<  bytes of the log already read */
+} SyncPeer;
+
+/**
+ * @brief Struct containing the logs of all the devices.
+ * 
+ */
+typedef struct
+{
+  char dir[SYNC_PATH_SIZE];        /**<  shared directory holding the logs */
+  char name[SYNC_NAME_SIZE];       /**<  name of this device */
+  int fd;                          /**<  log of this device, append only */
+  int watch_fd;                    /**<  inotify watching the directory, readable when a log changes, -1 if not available */
+  int pending;                     /**<  might another device have appended records since the last read? */
+  uint32_t sequence;               /**<  greatest sequence number written or read */
+  SyncRecord state;                /**<  latest state record, written or read */
+  char state_name[SYNC_NAME_SIZE]; /**<  name of the device that wrote the latest state record */
+  SyncPeer peers[SYNC_MAX_PEERS];  /**<  other devices */
+  int peers_count;                 /**<  number of other devices */
+} Sync;
+
+Sync *createSync(const char *dir, const char *name);
+void deleteSync(Sync *s);
+int syncFd(Sync *s);
+int syncAppend(Sync *s, int type, int flags, int phase_id, int entry, int value, int64_t time);
+int syncPoll(Sync *s, SyncHandler handler, void *args);
+int syncFollowing(Sync *s);
+
+#endif
@@ -10,11 +10,13 @@ double _min(double a, double b);
 double _max_3(double a, double b, double c);
 double _min_3(double a, double b, double c);
 double _clamp(double val, double min, double max);
-int _stringCopyNBytes(char *dest, char *source, int start, int end);
 int _stringCopy(char *dest, char *source);
-int _stringFindFirstSpace(char *s, int start);
 void _stringPad(char *dest, char *source, int chars);
-int _stringTrim(char *dest, char *source);
+int _windowLineOffset(Window *w, int index);
+int _windowLineLength(Window *w, int offset);
+int _windowLineWidth(Window *w, int offset);
+int _windowArenaSplice(Window *w, int offset, int removed, char *line, int len, int width);
+int _windowPushSpan(Window *w, int start, int len, int width);
 int _windowCalculateLongestLine(Window *w);
 void _windowAutoWidth(Window *w, int longest);
 void _windowAutoHeight(Window *w);
@@ -22,7 +24,60 @@ void _windowDrawBorder(Window *w);
 int _windowCalculateSpacing(Window *w, int current_len);
 int _windowLinesWrap(Window *w);
 int _windowLinesUnbuffer(Window *w);
+int _windowLayout(Window *w);
 void _windowClearUnbuffered(Window *w);
+int _outputAppend(char *s, int len);
+int _outputPrintf(char *format, ...);
+int _outputWrite();
+int _fdOutputWrite(Output *o, char *data, int len);
+int _nullOutputWrite(Output *o, char *data, int len);
+int _recordingOutputWrite(Output *o, char *data, int len);
+void _frameEmpty(Cell *cells);
+void _frameCopy(Cell *dest, Cell *src, int width, int height, int screen);
+void _frameResize();
+int _cellSameStyle(Cell *a, Cell *b);
+int _cellEqual(Cell *a, Cell *b);
+void _frameMoveCursor(int from_x, int from_y, int to_x, int to_y, Cell *pen);
+int _styleParameter(char *dest, style s, int truecolor_base);
+int _textStyleOff(style text_style);
+void _frameSetStyle(Cell *pen, Cell *c);
+void _terminalSetStyle(style fg_color, style bg_color, style text_style);
+void _framePutCell(int x, int y, char *glyph, style fg_color, style bg_color, style text_style);
+void _framePutContinuation(int x, int y, style fg_color, style bg_color, style text_style);
+int _framePutString(int x, int y, char *s, int len, style fg_color, style bg_color, style text_style);
+void _frameErase(int x, int y, int length);
+Layout *_layoutAppend(Layout *l, Layout *child);
+int _layoutEmpty(Layout *l);
+int _layoutMeasure(Layout *l, int width);
+void _layoutPlace(Layout *l, int x, int y);
+
+// frame buffer shared by all windows and dialogs
+static Frame _frame = {
+    .pen = {.fg_color = style_UNKNOWN, .bg_color = style_UNKNOWN, .text_style = style_UNKNOWN},
+};
+
+// colors of the hues at full saturation and half lightness, filled on first use
+static RGB _hue_table[360];
+static int _hue_table_ready = 0;
+
+// block characters filling a cell from the left, in eighths
+static char *_bar_blocks[] = {" ", "▏", "▎", "▍", "▌", "▋", "▊", "▉", "█"};
+
+// default output, the standard output
+static Output _stdout_output = {
+    .write = _fdOutputWrite,
+    .fd = STDOUT_FILENO,
+    .size = {.width = -1, .height = -1},
+};
+
+// output currently in use
+static Output *_output = &_stdout_output;
+
+// size of the prefix of each line of the arena of a window: its length, then its width
+static const int _line_prefix = 2 * sizeof(int);
+
+// escape sequence being read, kept across reads: 0 if none, 1 after the escape, 2 inside a control sequence
+static int _escape = 0;
 
 /**
  * @internal
@@ -119,12 +174,7 @@ double _min_3(double a, double b, double c)
  */
 int _stringLength(char *s)
 {
-  int count = 0;
-  while (1)
-  {
-    if (s[++count] == '\0')
-      return count--;
-  }
+  return strlen(s);
 }
 
 /**
@@ -143,142 +193,181 @@ double _clamp(double val, double min, double max)
 
 /**
  * @internal
- * @brief Copies N bytes o a string.
- * Basically a redefinition of strncpy.
+ * @brief Copies a string.
  * The string is automatically character terminated.
  * 
  * @param dest Destination string, where the string will be saved
  * @param source Source string
- * @param start Starting character
- * @param end Ending character. If -1, end gets set to end of string.
  * @return int Number of copied characters
  */
-int _stringCopyNBytes(char *dest, char *source, int start, int end)
+int _stringCopy(char *dest, char *source)
 {
-  const int source_len = _stringLength(source);
+  const int len = _stringLength(source);
 
-  if (start < 0 || start > source_len)
-    return -1;
+  memmove(dest, source, len + 1);
+  return len;
+}
 
-  if (end > source_len || end == -1)
-    end = source_len;
+/**
+ * @internal
+ * @brief Pads string with spaces.
+ * 
+ * @param dest Destination string, where the string will be saved
+ * @param source Source string
+ * @param chars NUmber of spaces to be added
+ */
+void _stringPad(char *dest, char *source, int chars)
+{
+  char buffer[MAX_WIDTH];
+  const int len = _stringLength(source);
 
-  if (start >= end)
-    return -1;
+  for (int i = 0; i < chars; i++)
+    buffer[i] = ' ';
 
-  for (int i = start; i <= end; i++)
-    dest[i - start] = source[i];
+  for (int i = 0; i < len; i++)
+    buffer[i + chars] = source[i];
 
-  if (end < source_len)
-    dest[end - start + 1] = '\0';
+  for (int i = chars + len; i < 2 * chars + len; i++)
+    buffer[i] = ' ';
 
-  return end - start;
+  buffer[2 * chars + len] = '\0';
+  _stringCopy(dest, buffer);
 }
 
 /**
  * @internal
- * @brief Copies a string.
- * The string is automatically character terminated.
+ * @brief Returns the offset in the arena of a line of a window.
  * 
- * @param dest Destination string, where the string will be saved
- * @param source Source string
- * @return int Number of copied characters
+ * @param w Pointer to Window
+ * @param index Index of the line, the number of lines for the end of the arena
+ * @return int Offset of the length prefix of the line
  */
-int _stringCopy(char *dest, char *source)
+int _windowLineOffset(Window *w, int index)
 {
-  return _stringCopyNBytes(dest, source, 0, -1);
+  int offset = 0;
+
+  for (int i = 0; i < index; i++)
+    offset += _line_prefix + _windowLineLength(w, offset);
+
+  return offset;
 }
 
 /**
  * @internal
- * @brief Finds first space in string, going backwards from end.
+ * @brief Returns the length of a line of a window.
  * 
- * @param s String to test
- * @param start Starting position. If -1, then the starting position is the last character of the string.
- * @return int Position of the first space of -1 if no space found
+ * @param w Pointer to Window
+ * @param offset Offset of the length prefix of the line
+ * @return int Length of the line, in bytes
  */
-int _stringFindFirstSpace(char *s, int start)
+int _windowLineLength(Window *w, int offset)
 {
-  if (start == -1)
-    start = _stringLength(s);
+  int len;
+  // the prefix might not be aligned
+  memcpy(&len, w->arena + offset, sizeof(int));
+  return len;
+}
 
-  if (start < 0)
-    return -1;
+/**
+ * @internal
+ * @brief Returns the width of a line of a window, measuring it only the first time.
+ * 
+ * @param w Pointer to Window
+ * @param offset Offset of the length prefix of the line
+ * @return int Width of the line, in columns
+ */
+int _windowLineWidth(Window *w, int offset)
+{
+  int width;
 
-  for (int i = start; i >= 0; i--)
+  memcpy(&width, w->arena + offset + sizeof(int), sizeof(int));
+  if (width == -1)
   {
-    if (s[i] == ' ' || s[i] == '\0')
-      return i;
+    // unknown until now, kept for the next layouts
+    width = utf8Width(w->arena + offset + _line_prefix, _windowLineLength(w, offset));
+    memcpy(w->arena + offset + sizeof(int), &width, sizeof(int));
   }
 
-  return -1;
+  return width;
 }
 
 /**
  * @internal
- * @brief Pads string with spaces.
+ * @brief Replaces bytes of the arena of a window with a line, prefixed by its length and width.
+ * The arena grows as needed.
  * 
- * @param dest Destination string, where the string will be saved
- * @param source Source string
- * @param chars NUmber of spaces to be added
+ * @param w Pointer to Window
+ * @param offset Offset of the bytes to replace
+ * @param removed Number of bytes to remove
+ * @param line Line to insert, NULL to insert nothing
+ * @param len Length of the line
+ * @param width Width of the line in columns, -1 to measure it when needed
+ * @return int -1 in case of error, 0 otherwise
  */
-void _stringPad(char *dest, char *source, int chars)
+int _windowArenaSplice(Window *w, int offset, int removed, char *line, int len, int width)
 {
-  char buffer[MAX_WIDTH];
-  const int len = _stringLength(source);
+  const int inserted = line != NULL ? _line_prefix + len : 0;
+  const int needed = w->arena_len - removed + inserted;
 
-  for (int i = 0; i < chars; i++)
-    buffer[i] = ' ';
+  if (needed > w->arena_size)
+  {
+    int size = w->arena_size > 0 ? w->arena_size : 64;
+    while (size < needed)
+      size *= 2;
 
-  for (int i = 0; i < len; i++)
-    buffer[i + chars] = source[i];
+    char *arena = realloc(w->arena, size);
+    if (arena == NULL)
+      return -1;
 
-  for (int i = chars + len; i < 2 * chars + len; i++)
-    buffer[i] = ' ';
+    w->arena = arena;
+    w->arena_size = size;
+  }
 
-  _stringCopy(dest, buffer);
+  // move the following lines
+  memmove(w->arena + offset + inserted, w->arena + offset + removed, w->arena_len - offset - removed);
+
+  if (line != NULL)
+  {
+    memcpy(w->arena + offset, &len, sizeof(int));
+    memcpy(w->arena + offset + sizeof(int), &width, sizeof(int));
+    memcpy(w->arena + offset + _line_prefix, line, len);
+  }
+
+  w->arena_len = needed;
+  // the displayed lines might point to moved bytes
+  w->wrapped_lines = 0;
+  w->generation++;
+
+  return 0;
 }
 
 /**
  * @internal
- * @brief Trims string, removing start and end spaces.
+ * @brief Appends a line to the lines displayed in a window.
  * 
- * @param dest Destination string, where the string will be saved
- * @param source Source string
- * @return int Number of removed characters
+ * @param w Pointer to Window
+ * @param start Offset of the first byte of the line in the arena
+ * @param len Length of the line, in bytes
+ * @param width Width of the line, in columns
+ * @return int -1 in case of error, otherwise the number of displayed lines
  */
-int _stringTrim(char *dest, char *source)
+int _windowPushSpan(Window *w, int start, int len, int width)
 {
-  int start, end;
-  const int len = _stringLength(source);
-
-  start = 0;
-  end = len;
-
-  // find actual string start
-  for (int i = 0; i < len; i++)
+  if (w->wrapped_lines == w->wrapped_size)
   {
-    if (source[i] != ' ')
-    {
-      start = i;
-      break;
-    }
-  }
+    const int size = w->wrapped_size > 0 ? w->wrapped_size * 2 : 4;
+    Span *wrapped = realloc(w->wrapped, size * sizeof(Span));
+    if (wrapped == NULL)
+      return -1;
 
-  // find actual string end
-  for (int i = len - 1; i > 0; i--)
-  {
-    if (source[i - 1] != ' ')
-    {
-      end = i;
-      break;
-    }
+    w->wrapped = wrapped;
+    w->wrapped_size = size;
   }
 
-  int newlen;
-  newlen = _stringCopyNBytes(dest, source, start, end);
+  w->wrapped[w->wrapped_lines] = (Span){.start = start, .len = len, .width = width};
+  w->wrapped_lines++;
 
-  return newlen - len;
+  return w->wrapped_lines;
 }
 
 /**
@@ -292,12 +381,13 @@ int _windowCalculateLongestLine(Window *w)
 {
   int longest = 0;
 
-  for (int i = 0; i < w->lines; i++)
+  for (int offset = 0; offset < w->arena_len;)
   {
-    if (_stringLength(w->text_buffer[i]) > longest)
-    {
-      longest = _stringLength(w->text_buffer[i]);
-    }
+    const int width = _windowLineWidth(w, offset);
+    if (width > longest)
+      longest = width;
+
+    offset += _line_prefix + _windowLineLength(w, offset);
   }
 
   return longest;
@@ -318,21 +408,19 @@ void _windowAutoWidth(Window *w, int longest)
 
 /**
  * @internal
- * @brief Automatically sets window height.
+ * @brief Automatically sets window height, fitting the displayed lines.
  * 
  * @param w Pointer to Window
  */
 void _windowAutoHeight(Window *w)
 {
-  w->size.height = w->lines + 2;
+  w->size.height = w->wrapped_lines + 2;
   return;
 }
 
 /**
  * @internal
- * @brief Draws window border, without clearing the window body.
- * Text and background color must be set before calling this function.
- * Terminal is automatically flushed every line.
+ * @brief Draws window border into the frame, clearing the window body.
  * 
  * @param w Pointer to Window to be drawn
  */
@@ -345,39 +433,39 @@ void _windowDrawBorder(Window *w)
   {
     for (int x = 0; x < width; x++)
     {
-      move_cursor_to(x + w->position.x, y + w->position.y);
+      char *glyph;
 
       if (y == 0)
       {
         // top line
         if (x == 0)
-          printf("\u250c"); // top left corner
+          glyph = "\u250c"; // top left corner
         else if (x == width - 1)
-          printf("\u2510"); // top right corner
+          glyph = "\u2510"; // top right corner
         else
-          printf("\u2500"); // top line
+          glyph = "\u2500"; // top line
       }
       else if (y == height - 1)
       {
         // bottom line
         if (x == 0)
-          printf("\u2514"); // bottom left corner
+          glyph = "\u2514"; // bottom left corner
         else if (x == width - 1)
-          printf("\u2518"); // bottom right corner
+          glyph = "\u2518"; // bottom right corner
         else
-          printf("\u2500"); // bottom line
+          glyph = "\u2500"; // bottom line
       }
       else if (x == 0 || x == width - 1)
       {
-        printf("\u2502"); // vertical line
+        glyph = "\u2502"; // vertical line
       }
       else
       {
-        printf(" "); // empty space
+        glyph = " "; // empty space
       }
-    }
 
-    fflush(NULL);
+      _framePutCell(x + w->position.x, y + w->position.y, glyph, w->fg_color, w->bg_color, text_DEFAUlT);
+    }
   }
 }
 
@@ -387,7 +475,7 @@ void _windowDrawBorder(Window *w)
  * satisfy the current window alignment settings).
  * 
  * @param w Pointer to Window 
- * @param current_len Length of the current line
+ * @param current_len Width of the current line, in columns
  * @return int Number of spaces to be added
  */
 int _windowCalculateSpacing(Window *w, int current_len)
@@ -407,99 +495,819 @@ int _windowCalculateSpacing(Window *w, int current_len)
 /**
  * @internal
  * @brief Wrap lines in a window.
+ * Lines are trimmed and broken at the last space that fits the window,
+ * words longer than the window are broken anywhere. Widths are measured in columns.
  * 
  * @param w pointer to window
- * @return int Number of lines
+ * @return int Number of displayed lines
  */
 int _windowLinesWrap(Window *w)
 {
-  int lines_num = 0;
   const int width = w->size.width - 2 * w->padding - 2;
+
+  w->wrapped_lines = 0;
+
   // go over each line
-  for (int i = 0; i < w->lines; i++)
+  for (int offset = 0; offset < w->arena_len;)
   {
-    _stringTrim(w->text_buffer[i], w->text_buffer[i]);
-    const int len = _stringLength(w->text_buffer[i]);
+    const int start = offset + _line_prefix;
+    const int line_offset = offset;
+    char *s = w->arena + start;
+    int first, len, full_len;
+
+    full_len = len = _windowLineLength(w, offset);
+    offset = start + len;
+
+    // trim the spaces on both sides
+    for (first = 0; first < len && s[first] == ' '; first++)
+      ;
+    while (len > first && s[len - 1] == ' ')
+      len--;
+
+    if (len == first || width <= 0)
+    {
+      // empty line, or no room for any text
+      _windowPushSpan(w, start + first, len - first, utf8Width(s + first, len - first));
+      continue;
+    }
+
+    if (first == 0 && len == full_len && _windowLineWidth(w, line_offset) <= width)
+    {
+      // the whole line fits, its width is already known
+      _windowPushSpan(w, start, len, _windowLineWidth(w, line_offset));
+      continue;
+    }
 
-    // if the line is too long
-    if (len > width)
+    // break it into parts that fit the window
+    for (int pos = first; pos < len;)
     {
-      // break it into smaller parts
-      int current_pos = 0;
+      int part_width;
+      int stop = pos + utf8Fit(s + pos, len - pos, width, &part_width);
 
-      while (current_pos < len)
+      if (stop < len && s[stop] != ' ')
       {
-        // try to look for the first break point, the closest space
-        int end = _stringFindFirstSpace(w->text_buffer[i], current_pos + width);
+        // look for the closest space, so that the part fits
+        const int space = utf8LastSpace(s, pos + 1, stop - 1);
 
-        if (end == -1 || end < current_pos)
-        {
-          // if there isn't any space, take the whole line
-          // make sure it's in bound of the buffer
-          end = len;
-        }
-        else
+        if (space != -1)
+          stop = space;
+        else if (stop == pos)
+          // a single character wider than the window
+          stop = pos + utf8CharLength(s[pos]);
+
+        // otherwise, no space: break the word
+        part_width = utf8Width(s + pos, stop - pos);
+      }
+
+      _windowPushSpan(w, start + pos, stop - pos, part_width);
+
+      // skip the spaces at the break point
+      for (pos = stop; pos < len && s[pos] == ' '; pos++)
+        ;
+    }
+  }
+
+  // check if the window has to be resized or some lines have to be hidden
+  if (w->wrapped_lines > w->size.height - 2 && w->auto_height)
+    w->size.height = w->wrapped_lines + 2;
+  else if (w->wrapped_lines > w->size.height - 2)
+    w->wrapped_lines = w->size.height > 2 ? w->size.height - 2 : 0;
+
+  return w->wrapped_lines;
+}
+
+/**
+ * @internal
+ * @brief Displays the lines of a window as they are, without wrapping.
+ * 
+ * @param w pointer to window
+ * @return int Number of lines of text
+ */
+int _windowLinesUnbuffer(Window *w)
+{
+  w->wrapped_lines = 0;
+
+  for (int offset = 0; offset < w->arena_len;)
+  {
+    const int len = _windowLineLength(w, offset);
+    _windowPushSpan(w, offset + _line_prefix, len, _windowLineWidth(w, offset));
+    offset += _line_prefix + len;
+  }
+
+  return w->wrapped_lines;
+}
+
+/**
+ * @internal
+ * @brief Clears a window buffer.
+ * 
+ * @param w pointer to window
+ */
+void _windowClearUnbuffered(Window *w)
+{
+  w->lines = 0;
+  w->arena_len = 0;
+  w->wrapped_lines = 0;
+  w->generation++;
+}
+
+/**
+ * @internal
+ * @brief Computes the size of a window and its displayed lines.
+ * Nothing is done if neither the text nor the size have changed since the last time.
+ * 
+ * @param w pointer to window
+ * @return int 1 if the layout has been computed, 0 if the cached one is still valid
+ */
+int _windowLayout(Window *w)
+{
+  // the longest line depends only on the text
+  if (w->longest_generation != w->generation)
+  {
+    w->longest = _windowCalculateLongestLine(w);
+    w->longest_generation = w->generation;
+  }
+
+  // auto resize window
+  if (w->auto_width)
+    _windowAutoWidth(w, w->longest);
+
+  if (w->layout_generation == w->generation &&
+      w->layout_size.width == w->size.width &&
+      w->layout_size.height == w->size.height)
+    return 0;
+
+  // check if lines need to be wrapped
+  const int width = w->size.width - 2 * w->padding;
+  if (w->longest >= width && w->line_wrap)
+  {
+    // windows are auto resized if needed
+    _windowLinesWrap(w);
+  }
+  else
+  {
+    // simply display the lines as they are
+    _windowLinesUnbuffer(w);
+    // lines that do not fit are hidden
+    if (!w->auto_height && w->wrapped_lines > w->size.height - 2)
+      w->wrapped_lines = w->size.height > 2 ? w->size.height - 2 : 0;
+  }
+
+  if (w->auto_height)
+    _windowAutoHeight(w);
+
+  w->layout_generation = w->generation;
+  w->layout_size = w->size;
+
+  return 1;
+}
+
+/**
+ * @internal
+ * @brief Appends bytes to the frame output.
+ * 
+ * @param s Bytes to append
+ * @param len Number of bytes to append
+ * @return int -1 if the buffer could not grow, leaving the output as it was, 0 otherwise
+ */
+int _outputAppend(char *s, int len)
+{
+  if (_frame.output_len + len > _frame.output_size)
+  {
+    // grow the buffer geometrically
+    int new_size = _frame.output_size > 0 ? _frame.output_size : 4096;
+    while (new_size < _frame.output_len + len)
+      new_size *= 2;
+
+    char *output = realloc(_frame.output, new_size);
+    if (output == NULL)
+    {
+      _frame.output_failed = 1;
+      return -1;
+    }
+
+    _frame.output = output;
+    _frame.output_size = new_size;
+  }
+
+  memcpy(_frame.output + _frame.output_len, s, len);
+  _frame.output_len += len;
+  return 0;
+}
+
+/**
+ * @internal
+ * @brief Appends a formatted string to the frame output.
+ * 
+ * @param format Format string, as in printf
+ * @param ... Format arguments
+ * @return int -1 if the buffer could not grow, 0 otherwise
+ */
+int _outputPrintf(char *format, ...)
+{
+  char buffer[64];
+  va_list v;
+
+  va_start(v, format);
+  const int len = vsnprintf(buffer, sizeof(buffer), format, v);
+  va_end(v);
+
+  if (len <= 0)
+    return 0;
+
+  return _outputAppend(buffer, len < (int)sizeof(buffer) ? len : (int)sizeof(buffer) - 1);
+}
+
+/**
+ * @internal
+ * @brief Writes the frame output to the current sink and empties it.
+ * 
+ * @return int Number of write syscalls
+ */
+int _outputWrite()
+{
+  int writes;
+
+  writes = 0;
+  if (_frame.output_len > 0)
+    writes = _output->write(_output, _frame.output, _frame.output_len);
+
+  _frame.output_len = 0;
+  return writes;
+}
+
+/**
+ * @internal
+ * @brief Writes bytes to the file descriptor of a fd sink.
+ * 
+ * @param o Pointer to output
+ * @param data Bytes to write
+ * @param len Number of bytes to write
+ * @return int Number of write syscalls, -1 in case of error
+ */
+int _fdOutputWrite(Output *o, char *data, int len)
+{
+  int written, writes;
+
+  written = 0;
+  writes = 0;
+  while (written < len)
+  {
+    const int ret = write(o->fd, data + written, len - written);
+    writes++;
+
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      return -1;
+
+    written += ret;
+  }
+
+  return writes;
+}
+
+/**
+ * @internal
+ * @brief Discards bytes. Counts as a single write, like a fd sink would need.
+ * 
+ * @param o Pointer to output
+ * @param data Bytes to write
+ * @param len Number of bytes to write
+ * @return int Number of write syscalls
+ */
+int _nullOutputWrite(Output *o, char *data, int len)
+{
+  return len > 0 ? 1 : 0;
+}
+
+/**
+ * @internal
+ * @brief Appends bytes to the recording of a recording sink. Counts as a single write, like a fd sink would need.
+ * 
+ * @param o Pointer to output
+ * @param data Bytes to write
+ * @param len Number of bytes to write
+ * @return int Number of write syscalls, -1 in case of error
+ */
+int _recordingOutputWrite(Output *o, char *data, int len)
+{
+  if (o->recording_len + len > o->recording_size)
+  {
+    // grow the recording geometrically
+    int new_size = o->recording_size > 0 ? o->recording_size : 4096;
+    while (new_size < o->recording_len + len)
+      new_size *= 2;
+
+    char *recording = realloc(o->recording, new_size);
+    if (recording == NULL)
+      return -1;
+
+    o->recording = recording;
+    o->recording_size = new_size;
+  }
+
+  memcpy(o->recording + o->recording_len, data, len);
+  o->recording_len += len;
+  return len > 0 ? 1 : 0;
+}
+
+/**
+ * @internal
+ * @brief Fills an array of frame cells with blank cells.
+ * 
+ * @param cells Pointer to the cells, either the frame or the screen
+ */
+void _frameEmpty(Cell *cells)
+{
+  for (int i = 0; i < _frame.width * _frame.height; i++)
+  {
+    cells[i] = (Cell){
+        .glyph = " ",
+        .fg_color = fg_DEFAULT,
+        .bg_color = bg_DEFAULT,
+        .text_style = text_DEFAUlT,
+    };
+  }
+}
+
+/**
+ * @internal
+ * @brief Copies the cells shared by two frames of different sizes.
+ * Wide characters split by the right border of the new frame are replaced by a blank,
+ * unknown on the screen so that it differs from anything drawn on it.
+ * 
+ * @param dest cells of the new frame, already emptied
+ * @param src cells of the old frame
+ * @param width width of the old frame
+ * @param height height of the old frame
+ * @param screen 1 if the cells are the ones shown on the terminal, 0 if they are being drawn
+ */
+void _frameCopy(Cell *dest, Cell *src, int width, int height, int screen)
+{
+  const int columns = width < _frame.width ? width : _frame.width;
+  const int rows = height < _frame.height ? height : _frame.height;
+
+  for (int y = 0; y < rows; y++)
+  {
+    memcpy(dest + y * _frame.width, src + y * width, sizeof(Cell) * columns);
+
+    // the right half of the character is gone
+    if (columns < width && src[y * width + columns].glyph[0] == '\0')
+    {
+      Cell *c = dest + y * _frame.width + columns - 1;
+      strcpy(c->glyph, " ");
+      if (screen)
+        c->fg_color = style_UNKNOWN;
+    }
+  }
+}
+
+/**
+ * @internal
+ * @brief Sizes the frame to the terminal. 
+ * If the size has changed, the cells shared by the old and the new size are kept,
+ * since the terminal keeps them too, and the new ones are empty. The terminal is cleared
+ * on the next flush only the first time, when its content is not known.
+ * 
+ */
+void _frameResize()
+{
+  Rectangle size = get_terminal_size();
+  Cell *cells, *screen;
+  int width, height;
+
+  if (size.width == -1 || size.height == -1)
+    size = createRectangle(FRAME_FALLBACK_WIDTH, FRAME_FALLBACK_HEIGHT);
+
+  if (_frame.cells != NULL && size.width == _frame.width && size.height == _frame.height)
+    return;
+
+  cells = _frame.cells;
+  screen = _frame.screen;
+  width = _frame.width;
+  height = _frame.height;
+
+  _frame.cells = malloc(sizeof(Cell) * size.width * size.height);
+  _frame.screen = malloc(sizeof(Cell) * size.width * size.height);
+  _frame.width = size.width;
+  _frame.height = size.height;
+  _frameEmpty(_frame.cells);
+  _frameEmpty(_frame.screen);
+
+  if (cells == NULL)
+  {
+    // the content of the terminal is unknown, start from a clean one
+    _frame.clear_pending = 1;
+  }
+  else
+  {
+    // only the differences with what's already shown will be flushed
+    _frameCopy(_frame.cells, cells, width, height, 0);
+    _frameCopy(_frame.screen, screen, width, height, 1);
+  }
+
+  free(cells);
+  free(screen);
+}
+
+/**
+ * @internal
+ * @brief Draws a single cell into the frame. Cells outside the frame are discarded.
+ * 
+ * @param x x coordinate of the cell
+ * @param y y coordinate of the cell
+ * @param glyph UTF-8 encoded character, NUL terminated
+ * @param fg_color text color of the cell
+ * @param bg_color background color of the cell
+ * @param text_style text style of the cell
+ */
+void _framePutCell(int x, int y, char *glyph, style fg_color, style bg_color, style text_style)
+{
+  if (_frame.cells == NULL)
+    _frameResize();
+
+  if (x < 0 || y < 0 || x >= _frame.width || y >= _frame.height)
+    return;
+
+  Cell *c = _frame.cells + y * _frame.width + x;
+  int i;
+
+  // overwriting half of a wide character, the other half is left blank
+  if (c->glyph[0] == '\0' && x > 0)
+    _stringCopy((c - 1)->glyph, " ");
+  if (x + 1 < _frame.width && (c + 1)->glyph[0] == '\0')
+    _stringCopy((c + 1)->glyph, " ");
+
+  for (i = 0; i < 4 && glyph[i] != '\0'; i++)
+    c->glyph[i] = glyph[i];
+  c->glyph[i] = '\0';
+  c->fg_color = fg_color;
+  c->bg_color = bg_color;
+  c->text_style = text_style;
+}
+
+/**
+ * @internal
+ * @brief Marks a cell of the frame as the right half of the wide character on its left.
+ * 
+ * @param x x coordinate of the cell
+ * @param y y coordinate of the cell
+ * @param fg_color text color of the cell
+ * @param bg_color background color of the cell
+ * @param text_style text style of the cell
+ */
+void _framePutContinuation(int x, int y, style fg_color, style bg_color, style text_style)
+{
+  if (x < 0 || y < 0 || x >= _frame.width || y >= _frame.height)
+    return;
+
+  Cell *c = _frame.cells + y * _frame.width + x;
+
+  // overwriting the left half of another wide character
+  if (x + 1 < _frame.width && (c + 1)->glyph[0] == '\0')
+    _stringCopy((c + 1)->glyph, " ");
+
+  c->glyph[0] = '\0';
+  c->fg_color = fg_color;
+  c->bg_color = bg_color;
+  c->text_style = text_style;
+}
+
+/**
+ * @internal
+ * @brief Draws a string into the frame, one character per cell.
+ * Wide characters take two cells, zero width characters are appended to the previous cell if there's room.
+ * 
+ * @param x x coordinate of the first character
+ * @param y y coordinate of the first character
+ * @param s string to draw
+ * @param len length of the string, in bytes
+ * @param fg_color text color of the string
+ * @param bg_color background color of the string
+ * @param text_style text style of the string
+ * @return int Number of cells used
+ */
+int _framePutString(int x, int y, char *s, int len, style fg_color, style bg_color, style text_style)
+{
+  char glyph[5];
+  int cells = 0;
+
+  if (_frame.cells == NULL)
+    _frameResize();
+
+  for (int i = 0; i < len;)
+  {
+    // runs of ASCII need no decoding
+    const int ascii = utf8AsciiPrefix(s + i, len - i);
+
+    glyph[1] = '\0';
+    for (int j = 0; j < ascii; j++)
+    {
+      glyph[0] = s[i + j];
+      _framePutCell(x + cells, y, glyph, fg_color, bg_color, text_style);
+      cells++;
+    }
+
+    i += ascii;
+    if (i >= len)
+      break;
+
+    unsigned int codepoint;
+    const int glyph_len = utf8Decode(s + i, len - i, &codepoint);
+    const int width = utf8CodepointWidth(codepoint);
+
+    if (codepoint == UTF8_REPLACEMENT && glyph_len == 1)
+      _stringCopy(glyph, "\xEF\xBF\xBD");
+    else
+    {
+      memcpy(glyph, s + i, glyph_len);
+      glyph[glyph_len] = '\0';
+    }
+    i += glyph_len;
+
+    if (width == 0)
+    {
+      // combining character, joined to the previous cell
+      const int px = x + cells - 1;
+      if (px >= 0 && px < _frame.width && y >= 0 && y < _frame.height)
+      {
+        Cell *c = _frame.cells + y * _frame.width + px;
+        const int cell_len = _stringLength(c->glyph);
+
+        if (cell_len > 0 && cell_len + glyph_len <= 4)
+          memcpy(c->glyph + cell_len, glyph, glyph_len + 1);
+      }
+      continue;
+    }
+
+    if (width == 2 && x + cells + 1 < _frame.width)
+    {
+      _framePutCell(x + cells, y, glyph, fg_color, bg_color, text_style);
+      _framePutContinuation(x + cells + 1, y, fg_color, bg_color, text_style);
+    }
+    else
+    {
+      // a wide character does not fit the last column
+      _framePutCell(x + cells, y, width == 2 ? " " : glyph, fg_color, bg_color, text_style);
+    }
+
+    cells += width;
+  }
+
+  return cells;
+}
+
+/**
+ * @internal
+ * @brief Erases a set number of cells in the frame.
+ * 
+ * @param x x coordinate of the first cell to erase
+ * @param y y coordinate of the first cell to erase
+ * @param length number of cells to erase
+ */
+void _frameErase(int x, int y, int length)
+{
+  for (int i = 0; i < length; i++)
+    _framePutCell(x + i, y, " ", fg_DEFAULT, bg_DEFAULT, text_DEFAUlT);
+}
+
+/**
+ * @internal
+ * @brief Checks if two cells share the same style.
+ * 
+ * @param a Pointer to the first cell
+ * @param b Pointer to the second cell
+ * @return int 1 if the styles are the same, 0 otherwise
+ */
+int _cellSameStyle(Cell *a, Cell *b)
+{
+  return a->fg_color == b->fg_color && a->bg_color == b->bg_color && a->text_style == b->text_style;
+}
+
+/**
+ * @internal
+ * @brief Checks if two cells are identical.
+ * 
+ * @param a Pointer to the first cell
+ * @param b Pointer to the second cell
+ * @return int 1 if the cells are identical, 0 otherwise
+ */
+int _cellEqual(Cell *a, Cell *b)
+{
+  return _cellSameStyle(a, b) && strcmp(a->glyph, b->glyph) == 0;
+}
+
+/**
+ * @internal
+ * @brief Appends to the frame output the cheapest sequence moving the cursor between two cells.
+ * Unchanged cells between the two positions may be written again if that's shorter than
+ * an escape sequence.
+ * 
+ * @param from_x Current x coordinate of the cursor, -1 if unknown
+ * @param from_y Current y coordinate of the cursor, -1 if unknown
+ * @param to_x x coordinate of the destination
+ * @param to_y y coordinate of the destination
+ * @param pen Pointer to a cell containing the current style of the terminal
+ */
+void _frameMoveCursor(int from_x, int from_y, int to_x, int to_y, Cell *pen)
+{
+  char best[MAX_WIDTH], candidate[MAX_WIDTH];
+  int best_len, candidate_len;
+
+  // absolute positioning always works
+  best_len = snprintf(best, sizeof(best), ESCAPE "[%i;%iH", to_y + 1, to_x + 1);
+
+  if (from_x == -1 || from_y == -1)
+  {
+    _outputAppend(best, best_len);
+    return;
+  }
+
+  if (from_y == to_y)
+  {
+    // horizontal absolute
+    if (to_x == 0)
+      candidate_len = snprintf(candidate, sizeof(candidate), "\r");
+    else
+      candidate_len = snprintf(candidate, sizeof(candidate), ESCAPE "[%iG", to_x + 1);
+
+    if (candidate_len < best_len)
+    {
+      memcpy(best, candidate, candidate_len);
+      best_len = candidate_len;
+    }
+
+    if (to_x > from_x)
+    {
+      // horizontal relative
+      const int dx = to_x - from_x;
+
+      if (dx == 1)
+        candidate_len = snprintf(candidate, sizeof(candidate), ESCAPE "[C");
+      else
+        candidate_len = snprintf(candidate, sizeof(candidate), ESCAPE "[%iC", dx);
+
+      if (candidate_len < best_len)
+      {
+        memcpy(best, candidate, candidate_len);
+        best_len = candidate_len;
+      }
+
+      // write again the cells in between, if they share the current style
+      candidate_len = 0;
+      for (int x = from_x; x < to_x && candidate_len < best_len; x++)
+      {
+        Cell *s = _frame.screen + to_y * _frame.width + x;
+        const int glyph_len = _stringLength(s->glyph);
+        // wide characters cannot be written in halves
+        const int split = (glyph_len == 0 && x == from_x) || (x + 1 == to_x && (s + 1)->glyph[0] == '\0');
+
+        if (split || !_cellSameStyle(s, pen) || candidate_len + glyph_len >= best_len)
         {
-          // decrement by one to not include the space itself
-          end--;
+          candidate_len = best_len;
+          break;
         }
 
-        // copy to display lines
-        _stringCopyNBytes(w->text[lines_num], w->text_buffer[i], current_pos, end);
+        memcpy(candidate + candidate_len, s->glyph, glyph_len);
+        candidate_len += glyph_len;
+      }
 
-        // continue to following lines
-        lines_num++;
-        // keep going to the char after the space
-        current_pos += end - current_pos + 2;
+      if (candidate_len < best_len)
+      {
+        memcpy(best, candidate, candidate_len);
+        best_len = candidate_len;
       }
     }
-    else
+  }
+  else if (to_y > from_y && to_x == 0 && to_y - from_y < 4)
+  {
+    // beginning of one of the following lines
+    candidate_len = 0;
+    candidate[candidate_len++] = '\r';
+    for (int y = from_y; y < to_y; y++)
+      candidate[candidate_len++] = '\n';
+
+    if (candidate_len < best_len)
     {
-      // simply copy into display line
-      _stringCopy(w->text[lines_num], w->text_buffer[i]);
-      lines_num++;
+      memcpy(best, candidate, candidate_len);
+      best_len = candidate_len;
     }
   }
 
-  // check if the window has to be resized or some lines have to be hidden
-  if (lines_num > w->size.height - 2 && w->auto_height)
-    w->size.height = lines_num + 2;
-  else if (lines_num > w->size.height - 2)
-    lines_num = w->size.height - 2;
+  _outputAppend(best, best_len);
+}
+
+/**
+ * @internal
+ * @brief Formats the parameter of a SGR sequence setting a color.
+ * 
+ * @param dest destination buffer, at least 20 bytes long
+ * @param s color, either a SGR code or a truecolor style
+ * @param truecolor_base 38 for text colors, 48 for background colors
+ * @return int length of the parameter
+ */
+int _styleParameter(char *dest, style s, int truecolor_base)
+{
+  if (s & style_RGB)
+    return sprintf(dest, ";%i;2;%i;%i;%i", truecolor_base, (s >> 16) & 0xFF, (s >> 8) & 0xFF, s & 0xFF);
+
+  return sprintf(dest, ";%i", s);
+}
+
+/**
+ * @internal
+ * @brief Returns the SGR code turning off a text style.
+ * 
+ * @param text_style text style
+ * @return int SGR code
+ */
+int _textStyleOff(style text_style)
+{
+  // bold and faint share the same code
+  if (text_style == text_BOLD)
+    return 22;
+
+  return text_style + 20;
+}
+
+/**
+ * @internal
+ * @brief Appends to the frame output the escape sequence needed to switch to the style of a cell.
+ * Only the styles that differ are changed, all in a single sequence.
+ * 
+ * @param pen Pointer to a cell containing the current style of the terminal, updated accordingly
+ * @param c Pointer to the cell whose style is needed
+ */
+void _frameSetStyle(Cell *pen, Cell *c)
+{
+  char parameters[64];
+  int len;
+
+  if (_cellSameStyle(pen, c))
+    return;
+
+  len = 0;
+
+  if (pen->fg_color == style_UNKNOWN || pen->bg_color == style_UNKNOWN || pen->text_style == style_UNKNOWN ||
+      (c->fg_color == fg_DEFAULT && c->bg_color == bg_DEFAULT && c->text_style == text_DEFAUlT))
+  {
+    // a complete reset, followed by the styles that are not the default ones
+    len += sprintf(parameters + len, ";%i", text_DEFAUlT);
+    *pen = (Cell){.fg_color = fg_DEFAULT, .bg_color = bg_DEFAULT, .text_style = text_DEFAUlT};
+  }
+
+  if (c->text_style != pen->text_style)
+  {
+    if (pen->text_style != text_DEFAUlT)
+      len += sprintf(parameters + len, ";%i", _textStyleOff(pen->text_style));
+    if (c->text_style != text_DEFAUlT)
+      len += sprintf(parameters + len, ";%i", c->text_style);
+  }
+
+  if (c->fg_color != pen->fg_color)
+    len += _styleParameter(parameters + len, c->fg_color, 38);
 
-  w->lines = lines_num;
+  if (c->bg_color != pen->bg_color)
+    len += _styleParameter(parameters + len, c->bg_color, 48);
 
-  // copy back into display lines to prevent double wrapping
-  for (int i = 0; i < w->lines; i++)
-    _stringCopy(w->text_buffer[i], w->text[i]);
+  pen->fg_color = c->fg_color;
+  pen->bg_color = c->bg_color;
+  pen->text_style = c->text_style;
 
-  return lines_num;
+  // the first parameter has no separator
+  _outputPrintf(ESCAPE "[%sm", parameters + 1);
 }
 
 /**
  * @internal
- * @brief Copies lines from buffer to actual display.
+ * @brief Switches the terminal to a style, writing only what changes.
  * 
- * @param w pointer to window
- * @return int Number of lines of text
+ * @param fg_color text color, style_UNKNOWN to keep the current one
+ * @param bg_color background color, style_UNKNOWN to keep the current one
+ * @param text_style text style, style_UNKNOWN to keep the current one
  */
-int _windowLinesUnbuffer(Window *w)
+void _terminalSetStyle(style fg_color, style bg_color, style text_style)
 {
-  for (int i = 0; i < w->lines; i++)
-    _stringCopy(w->text[i], w->text_buffer[i]);
+  Cell target = _frame.pen;
 
-  return w->lines;
-}
+  if (fg_color != style_UNKNOWN)
+    target.fg_color = fg_color;
+  if (bg_color != style_UNKNOWN)
+    target.bg_color = bg_color;
+  if (text_style != style_UNKNOWN)
+    target.text_style = text_style;
 
-/**
- * @internal
- * @brief Clears a window buffer.
- * 
- * @param w pointer to window
- */
-void _windowClearUnbuffered(Window *w)
-{
-  w->lines = 0;
+  // the styles still unknown are reset
+  if (target.fg_color == style_UNKNOWN)
+    target.fg_color = fg_DEFAULT;
+  if (target.bg_color == style_UNKNOWN)
+    target.bg_color = bg_DEFAULT;
+  if (target.text_style == style_UNKNOWN)
+    target.text_style = text_DEFAUlT;
+
+  _frameSetStyle(&_frame.pen, &target);
+  _outputWrite();
 }
 
 /* 
@@ -590,6 +1398,11 @@ Window *createWindow(int x, int y)
       .fg_color = fg_DEFAULT,
       .bg_color = bg_DEFAULT,
       .text_style = text_DEFAUlT,
+      .arena = NULL,
+      .wrapped = NULL,
+      .generation = 0,
+      .longest_generation = -1,
+      .layout_generation = -1,
       .size = size,
       .position = position,
   };
@@ -605,7 +1418,11 @@ Window *createWindow(int x, int y)
 void deleteWindow(Window *w)
 {
   if (w)
+  {
+    free(w->arena);
+    free(w->wrapped);
     free(w);
+  }
   return;
 }
 
@@ -698,29 +1515,363 @@ RGB HUEtoRGB(double hue)
   return HSLtoRGB(color);
 }
 
+/**
+ * @brief Converts a RGB color into a truecolor style, usable as text or background color of windows.
+ * 
+ * @param color RGB color
+ * @return style 
+ */
+style RGBtoStyle(RGB color)
+{
+  return style_RGB | color.R << 16 | color.G << 8 | color.B;
+}
+
+/**
+ * @brief Converts a HSL color into a truecolor style, usable as text or background color of windows.
+ * 
+ * @param color HSL color
+ * @return style 
+ */
+style HSLtoStyle(HSL color)
+{
+  return RGBtoStyle(HSLtoRGB(color));
+}
+
+/**
+ * @brief Converts hue into the RGB color space, like HUEtoRGB, with a lookup table.
+ * The table is computed on the first call, later calls do no floating point maths at all.
+ * 
+ * @param hue hue in degrees, any integer
+ * @return RGB 
+ */
+RGB HUEtoRGBfast(int hue)
+{
+  if (!_hue_table_ready)
+  {
+    for (int i = 0; i < HUE_TABLE_SIZE; i++)
+      _hue_table[i] = HUEtoRGB(i);
+
+    _hue_table_ready = 1;
+  }
+
+  hue %= HUE_TABLE_SIZE;
+  if (hue < 0)
+    hue += HUE_TABLE_SIZE;
+
+  return _hue_table[hue];
+}
+
+/**
+ * @brief Creates a ramp of truecolor styles, fading between two hues along the shortest way.
+ * 
+ * @param from_hue hue of the first color, in degrees
+ * @param to_hue hue of the last color, in degrees
+ * @param len number of colors, at least 1
+ * @return style* array of styles, NULL in case of error
+ */
+style *createRamp(int from_hue, int to_hue, int len)
+{
+  style *ramp;
+  int delta;
+
+  if (len < 1)
+    return NULL;
+
+  ramp = malloc(sizeof(style) * len);
+  if (ramp == NULL)
+    return NULL;
+
+  // difference between the hues, in range [-180, 180)
+  delta = ((to_hue - from_hue) % HUE_TABLE_SIZE + HUE_TABLE_SIZE + 180) % HUE_TABLE_SIZE - 180;
+
+  for (int i = 0; i < len; i++)
+  {
+    const int hue = len > 1 ? from_hue + delta * i / (len - 1) : from_hue;
+    ramp[i] = RGBtoStyle(HUEtoRGBfast(hue));
+  }
+
+  return ramp;
+}
+
+/**
+ * @brief Deletes a ramp of styles.
+ * 
+ * @param ramp array of styles
+ */
+void deleteRamp(style *ramp)
+{
+  free(ramp);
+}
+
+/**
+ * @brief Creates a sink writing to a file descriptor. The size of the screen is asked to the terminal, if any.
+ * 
+ * @param fd file descriptor
+ * @return Output* 
+ */
+Output *createFdOutput(int fd)
+{
+  Output *o = malloc(sizeof(Output));
+  *o = (Output){
+      .write = _fdOutputWrite,
+      .fd = fd,
+      .size = createRectangle(-1, -1),
+  };
+
+  return o;
+}
+
+/**
+ * @brief Creates a sink discarding everything, with a screen of the fallback size.
+ * 
+ * @return Output* 
+ */
+Output *createNullOutput()
+{
+  Output *o = malloc(sizeof(Output));
+  *o = (Output){
+      .write = _nullOutputWrite,
+      .fd = -1,
+      .size = createRectangle(FRAME_FALLBACK_WIDTH, FRAME_FALLBACK_HEIGHT),
+  };
+
+  return o;
+}
+
+/**
+ * @brief Creates a sink capturing everything, with a screen of the fallback size.
+ * 
+ * @return Output* 
+ */
+Output *createRecordingOutput()
+{
+  Output *o = malloc(sizeof(Output));
+  *o = (Output){
+      .write = _recordingOutputWrite,
+      .fd = -1,
+      .size = createRectangle(FRAME_FALLBACK_WIDTH, FRAME_FALLBACK_HEIGHT),
+  };
+
+  return o;
+}
+
+/**
+ * @brief Deletes a sink. If it's in use, the output goes back to stdout.
+ * 
+ * @param o pointer to output
+ */
+void deleteOutput(Output *o)
+{
+  if (o == _output)
+    set_output(NULL);
+
+  free(o->recording);
+  free(o);
+}
+
+/**
+ * @brief Sets the size of the screen of a sink. Pass -1 to ask it to the terminal.
+ * 
+ * @param o pointer to output
+ * @param width width of the screen
+ * @param height height of the screen
+ */
+void outputSetSize(Output *o, int width, int height)
+{
+  o->size = createRectangle(width, height);
+}
+
+/**
+ * @brief Returns the bytes captured by a recording sink.
+ * 
+ * @param o pointer to output
+ * @param len pointer to the number of captured bytes
+ * @return char* captured bytes, not NUL terminated
+ */
+char *outputGetRecording(Output *o, int *len)
+{
+  *len = o->recording_len;
+  return o->recording;
+}
+
+/**
+ * @brief Empties the recording of a recording sink.
+ * 
+ * @param o pointer to output
+ */
+void outputClearRecording(Output *o)
+{
+  o->recording_len = 0;
+}
+
+/**
+ * @brief Replays the recording of a recording sink into another sink.
+ * 
+ * @param source pointer to the recording sink
+ * @param destination pointer to the destination sink
+ * @return int number of write syscalls, -1 in case of error
+ */
+int outputReplay(Output *source, Output *destination)
+{
+  if (source->recording_len == 0)
+    return 0;
+
+  return destination->write(destination, source->recording, source->recording_len);
+}
+
+/**
+ * @brief Sets the sink used by all the terminal functions.
+ * The next flushed frame is a complete redraw.
+ * 
+ * @param o pointer to output, NULL for stdout
+ */
+void set_output(Output *o)
+{
+  _output = o != NULL ? o : &_stdout_output;
+
+  // the new sink has never seen the frame, nor its styles
+  _frame.clear_pending = 1;
+  _frame.pen = (Cell){.fg_color = style_UNKNOWN, .bg_color = style_UNKNOWN, .text_style = style_UNKNOWN};
+}
+
+/**
+ * @brief Returns the sink in use.
+ * 
+ * @return Output* 
+ */
+Output *get_output()
+{
+  return _output;
+}
+
 /**
  * @brief Makes the terminal beep.
  * 
  */
 void terminal_beep()
 {
-  fflush(NULL);
-  printf(BELL);
-  fflush(NULL);
+  _outputAppend(BELL, sizeof(BELL) - 1);
+  _outputWrite();
 }
 
 /**
- * @brief Clears the terminal and moves cursor to upper-left position.
+ * @brief Clears the frame. On the next flush, the terminal gets cleared
+ * and the cursor is moved to the upper-left position.
  * 
  */
 void clear_terminal()
 {
-  printf(CLEARALL);
-  printf(MOVEHOME);
+  _frameResize();
+  _frameEmpty(_frame.cells);
 
   return;
 };
 
+/**
+ * @brief Forgets what the terminal is showing. On the next flush,
+ * the terminal gets cleared and the whole frame is written again.
+ * 
+ */
+void repaint_terminal()
+{
+  _frame.clear_pending = 1;
+  _frame.pen = (Cell){.fg_color = style_UNKNOWN, .bg_color = style_UNKNOWN, .text_style = style_UNKNOWN};
+}
+
+/**
+ * @brief Flushes the frame to the terminal with a single write.
+ * Only the cells that changed since the previous flush are emitted,
+ * and styles are changed only when they differ from the ones set on the terminal.
+ * 
+ * @return int number of bytes written, -1 if the output could not be buffered
+ */
+int frame_flush()
+{
+  int cursor_x, cursor_y, changed;
+  Cell *pen = &_frame.pen;
+
+  // the position of the cursor is unknown
+  cursor_x = -1;
+  cursor_y = -1;
+  changed = 0;
+
+  if (_frame.clear_pending)
+  {
+    // the terminal is cleared with the current background color
+    _frameSetStyle(pen, &(Cell){.fg_color = fg_DEFAULT, .bg_color = bg_DEFAULT, .text_style = text_DEFAUlT});
+    _outputAppend(CLEARALL MOVEHOME, sizeof(CLEARALL MOVEHOME) - 1);
+    _frameEmpty(_frame.screen);
+    _frame.clear_pending = 0;
+    cursor_x = 0;
+    cursor_y = 0;
+  }
+
+  for (int y = 0; y < _frame.height; y++)
+  {
+    for (int x = 0; x < _frame.width; x++)
+    {
+      Cell *c = _frame.cells + y * _frame.width + x;
+      Cell *s = _frame.screen + y * _frame.width + x;
+
+      if (_cellEqual(c, s))
+        continue;
+
+      // right half of a wide character, written along with its left half
+      if (c->glyph[0] == '\0')
+      {
+        *s = *c;
+        continue;
+      }
+
+      const int width = x + 1 < _frame.width && (c + 1)->glyph[0] == '\0' ? 2 : 1;
+
+      if (x != cursor_x || y != cursor_y)
+        _frameMoveCursor(cursor_x, cursor_y, x, y, pen);
+
+      _frameSetStyle(pen, c);
+      _outputAppend(c->glyph, _stringLength(c->glyph));
+      *s = *c;
+      if (width == 2)
+        *(s + 1) = *(c + 1);
+      changed++;
+
+      // the cursor position is not reliable after writing the last column
+      cursor_x = x + width < _frame.width ? x + width : -1;
+      cursor_y = y;
+      x += width - 1;
+    }
+  }
+
+  // styles are left as they are, the next frame will likely need them again
+  if (_frame.output_len > 0)
+    _outputAppend(MOVEHOME, sizeof(MOVEHOME) - 1);
+
+  if (_frame.output_failed)
+  {
+    // the output misses some bytes, the whole terminal is drawn again by the next flush
+    _frame.output_len = 0;
+    _frame.output_failed = 0;
+    repaint_terminal();
+    return -1;
+  }
+
+  _frame.stats.bytes = _frame.output_len;
+  _frame.stats.cells = changed;
+  _frame.stats.writes = _outputWrite();
+
+  return _frame.stats.bytes;
+}
+
+/**
+ * @brief Returns the output statistics of the last flushed frame.
+ * 
+ * @return FrameStats 
+ */
+FrameStats frame_get_stats()
+{
+  return _frame.stats;
+}
+
 /**
  * @brief Hides the blinking cursor from the terminal, disabling also echo.
  * 
@@ -733,8 +1884,8 @@ void hide_cursor()
   term.c_lflag &= ~ECHO;
   tcsetattr(0, TCSANOW, &term);
 
-  printf(HIDECURSOR);
-  fflush(NULL);
+  _outputAppend(HIDECURSOR, sizeof(HIDECURSOR) - 1);
+  _outputWrite();
 
   return;
 }
@@ -751,12 +1902,32 @@ void show_cursor()
   term.c_lflag |= ECHO;
   tcsetattr(0, TCSANOW, &term);
 
-  printf(SHOWCURSOR);
-  fflush(NULL);
+  _outputAppend(SHOWCURSOR, sizeof(SHOWCURSOR) - 1);
+  _outputWrite();
 
   return;
 }
 
+/**
+ * @brief Asks the terminal to report when it gains or loses the focus.
+ * 
+ */
+void enable_focus_events()
+{
+  _outputAppend(FOCUSON, sizeof(FOCUSON) - 1);
+  _outputWrite();
+}
+
+/**
+ * @brief Stops the reports of the focus of the terminal.
+ * 
+ */
+void disable_focus_events()
+{
+  _outputAppend(FOCUSOFF, sizeof(FOCUSOFF) - 1);
+  _outputWrite();
+}
+
 /**
  * @brief Enters terminal raw mode.
  * 
@@ -809,7 +1980,14 @@ void move_cursor_to_bottom()
 Rectangle get_terminal_size()
 {
   struct winsize size;
-  ioctl(STDOUT_FILENO, TIOCGWINSZ, &size);
+
+  // the size of the sink is known
+  if (_output->size.width > 0 && _output->size.height > 0)
+    return _output->size;
+
+  // not a terminal
+  if (_output->fd == -1 || ioctl(_output->fd, TIOCGWINSZ, &size) == -1)
+    return createRectangle(-1, -1);
 
   if (size.ws_row > 0 && size.ws_col > 0)
   {
@@ -827,8 +2005,8 @@ Rectangle get_terminal_size()
  */
 void move_cursor_to(int x, int y)
 {
-  printf(ESCAPE "[%i;%iH", y + 1, x + 1);
-  fflush(NULL);
+  _outputPrintf(ESCAPE "[%i;%iH", y + 1, x + 1);
+  _outputWrite();
 
   return;
 };
@@ -839,9 +2017,7 @@ void move_cursor_to(int x, int y)
  */
 void reset_styles()
 {
-  reset_fg();
-  reset_bg();
-  reset_textmode();
+  _terminalSetStyle(fg_DEFAULT, bg_DEFAULT, text_DEFAUlT);
   return;
 }
 
@@ -853,16 +2029,37 @@ void reset_styles()
  */
 void set_styles(style styles, ...)
 {
+  style fg_color, bg_color, text_style;
   va_list v;
+
+  fg_color = style_UNKNOWN;
+  bg_color = style_UNKNOWN;
+  text_style = style_UNKNOWN;
+
   va_start(v, styles);
 
+  // all the styles are merged in a single sequence
   for (int i = 0; i < styles; i++)
   {
-    printf(ESCAPE "[%im", va_arg(v, style));
+    const style s = va_arg(v, style);
+
+    if ((s >= 30 && s <= 39) || (s >= 90 && s <= 97))
+      fg_color = s;
+    else if ((s >= 40 && s <= 49) || (s >= 100 && s <= 107))
+      bg_color = s;
+    else if (s == text_DEFAUlT)
+    {
+      fg_color = fg_DEFAULT;
+      bg_color = bg_DEFAULT;
+      text_style = text_DEFAUlT;
+    }
+    else if (s >= 1 && s <= 9)
+      text_style = s;
   }
 
   va_end(v);
 
+  _terminalSetStyle(fg_color, bg_color, text_style);
   return;
 }
 
@@ -874,7 +2071,7 @@ void set_styles(style styles, ...)
 void set_fg(style color)
 {
   if ((color >= 30 && color <= 39) || (color >= 90 && color <= 97))
-    printf(ESCAPE "[%im", color);
+    _terminalSetStyle(color, style_UNKNOWN, style_UNKNOWN);
   return;
 }
 
@@ -886,19 +2083,21 @@ void set_fg(style color)
 void set_bg(style color)
 {
   if ((color >= 40 && color <= 49) || (color >= 100 && color <= 107))
-    printf(ESCAPE "[%im", color);
+    _terminalSetStyle(style_UNKNOWN, color, style_UNKNOWN);
   return;
 }
 
 /**
- * @brief Sets the text mode.
+ * @brief Sets the text mode. The default mode resets the colors too.
  * 
  * @param mode 
  */
 void set_textmode(style mode)
 {
-  if (mode >= 0 && mode <= 9)
-    printf(ESCAPE "[%im", mode);
+  if (mode == text_DEFAUlT)
+    _terminalSetStyle(fg_DEFAULT, bg_DEFAULT, text_DEFAUlT);
+  else if (mode >= 1 && mode <= 9)
+    _terminalSetStyle(style_UNKNOWN, style_UNKNOWN, mode);
 }
 
 /**
@@ -937,7 +2136,7 @@ void reset_textmode()
  */
 void set_fg_RGB(RGB color)
 {
-  printf(ESCAPE "[38;2;%i;%i;%im", color.R, color.G, color.B);
+  _terminalSetStyle(RGBtoStyle(color), style_UNKNOWN, style_UNKNOWN);
   return;
 }
 
@@ -948,7 +2147,7 @@ void set_fg_RGB(RGB color)
  */
 void set_bg_RGB(RGB color)
 {
-  printf(ESCAPE "[48;2;%i;%i;%im", color.R, color.G, color.B);
+  _terminalSetStyle(style_UNKNOWN, RGBtoStyle(color), style_UNKNOWN);
   return;
 }
 
@@ -983,8 +2182,9 @@ void set_bg_HSL(HSL color)
  */
 void write_at(int x, int y, char *s)
 {
-  move_cursor_to(x, y);
-  printf(s);
+  _outputPrintf(ESCAPE "[%i;%iH", y + 1, x + 1);
+  _outputAppend(s, _stringLength(s));
+  _outputWrite();
 
   return;
 };
@@ -998,11 +2198,10 @@ void write_at(int x, int y, char *s)
  */
 void erase_at(int x, int y, int length)
 {
+  _outputPrintf(ESCAPE "[%i;%iH", y + 1, x + 1);
   for (int i = 0; i < length; i++)
-  {
-    move_cursor_to(x + i, y);
-    printf(" ");
-  }
+    _outputAppend(" ", 1);
+  _outputWrite();
 
   return;
 }
@@ -1023,6 +2222,76 @@ char poll_keypress()
   return buf;
 }
 
+/**
+ * @brief Polls a key press or a focus event. Needs to be in raw mode.
+ * Escape sequences are read as a whole, so that their characters are not taken for keys,
+ * even if they are split across reads: a control sequence is resumed by the next call.
+ * After a lone escape, the rest of the sequence is waited for at most event_TIMEOUT milliseconds.
+ * 
+ * @param key pointer to the pressed key, set only for event_KEY
+ * @return int one of the event_ values, event_NONE if no (complete) input is available
+ */
+int poll_event(char *key)
+{
+  unsigned char c;
+
+  while (1)
+  {
+    // bytes above 127 (UTF-8 sequences) are keys too, only a failed read means no input
+    if (read(0, &c, 1) != 1)
+    {
+      // the escape is alone, unless the rest of the sequence is on its way
+      if (_escape == 1 && wait_input(event_TIMEOUT) == 1)
+        continue;
+
+      if (_escape == 1)
+      {
+        _escape = 0;
+        return event_IGNORED;
+      }
+
+      return event_NONE;
+    }
+
+    if (_escape == 0 && c == 27)
+    {
+      _escape = 1;
+    }
+    else if (_escape == 0)
+    {
+      *key = c;
+      return event_KEY;
+    }
+    else if (_escape == 1 && c == '[')
+    {
+      _escape = 2;
+    }
+    else if (_escape == 1)
+    {
+      // escape followed by a key, as sent with alt: the key is kept
+      _escape = 0;
+      *key = c;
+      return event_KEY;
+    }
+    else if (c < 0x20 || c > 0x3F)
+    {
+      // control sequence: parameters, then a final character
+      _escape = 0;
+
+      if (c == 'I')
+        return event_FOCUS_IN;
+      if (c == 'O')
+        return event_FOCUS_OUT;
+      if (c == 'C')
+        return event_RIGHT;
+      if (c == 'D')
+        return event_LEFT;
+
+      return event_IGNORED;
+    }
+  }
+}
+
 /**
  * @brief Polls special key presses.Needs to be in raw mode. 
  * 
@@ -1107,31 +2376,89 @@ char poll_special_keypress()
       break;
   }
 
-  return pressed;
+  return pressed;
+}
+
+/**
+ * @brief Waits (inside the kernel, without polling) until some input is available.
+ * 
+ * @param timeout_ms maximum time to wait in milliseconds, -1 to wait forever
+ * @return int 1 if input is available, 0 if the timeout expired, -1 if input is not available anymore
+ */
+int wait_input(int timeout_ms)
+{
+  struct pollfd fd = {.fd = 0, .events = POLLIN};
+  int ret;
+
+  do
+  {
+    ret = poll(&fd, 1, timeout_ms);
+  } while (ret == -1 && errno == EINTR);
+
+  if (ret <= 0)
+    return ret;
+
+  if (fd.revents & POLLIN)
+    return 1;
+
+  // hang up or error
+  return -1;
+}
+
+/**
+ * @brief Waits for a keypress. Returns the code corresponding to the key. Needs to be in raw mode.
+ * This function does not wait for enter and does not work with special characters.
+ * 
+ * @param timeout_ms maximum time to wait in milliseconds, -1 to wait forever
+ * @return char code of the key, 0 if no key was pressed
+ */
+char wait_keypress(int timeout_ms)
+{
+  if (wait_input(timeout_ms) != 1)
+    return 0;
+
+  return poll_keypress();
+}
+
+/**
+ * @brief Waits for a special key press. Needs to be in raw mode.
+ * 
+ * @param timeout_ms maximum time to wait in milliseconds, -1 to wait forever
+ * @return char Same as poll_special_keypress(), 0 if no key was pressed
+ */
+char wait_special_keypress(int timeout_ms)
+{
+  if (wait_input(timeout_ms) != 1)
+    return 0;
+
+  return poll_special_keypress();
 }
 
 /**
  * @brief Awaits a keypress. A message is prompted on the terminal. Needs to be in raw mode.
  * 
  * @param s String to print, pass NULL to skip
- * @return int Code of the pressed key
+ * @return int Code of the pressed key, -1 if input is not available anymore
  */
 int await_keypress(char *s)
 {
   if (s != NULL)
-    printf("%s", s);
+  {
+    _outputAppend(s, _stringLength(s));
+    _outputWrite();
+  }
 
-  int read_bytes;
-  char buffer[1];
+  char key;
 
   do
   {
-    read_bytes = read(0, buffer, 1);
-  } while (read_bytes == 0);
+    if (wait_input(-1) == -1)
+      return -1;
 
-  fflush(NULL);
+    key = poll_keypress();
+  } while (key == 0);
 
-  return (int)buffer[0];
+  return (int)key;
 }
 
 /**
@@ -1143,7 +2470,10 @@ int await_keypress(char *s)
 int await_enter(char *s)
 {
   if (s != NULL)
-    printf("%s", s);
+  {
+    _outputAppend(s, _stringLength(s));
+    _outputWrite();
+  }
 
   return getchar();
 }
@@ -1328,6 +2658,9 @@ void windowSetPadding(Window *w, int padding)
   if (padding > 0)
     w->padding = padding;
 
+  // the room for the text has changed
+  w->layout_generation = -1;
+
   return;
 }
 
@@ -1358,6 +2691,7 @@ void windowSetAutoSize(Window *w, int auto_size)
 
   w->auto_height = auto_size;
   w->auto_width = auto_size;
+  w->layout_generation = -1;
 }
 
 /**
@@ -1372,6 +2706,7 @@ void windowSetAutoWidth(Window *w, int auto_size)
     return;
 
   w->auto_width = auto_size;
+  w->layout_generation = -1;
 }
 
 /**
@@ -1386,6 +2721,7 @@ void windowSetAutoHeight(Window *w, int auto_size)
     return;
 
   w->auto_height = auto_size;
+  w->layout_generation = -1;
 }
 
 /**
@@ -1400,6 +2736,7 @@ void windowSetLineWrap(Window *w, int line_wrap)
     return;
 
   w->line_wrap = line_wrap;
+  w->layout_generation = -1;
 }
 
 /**
@@ -1409,18 +2746,7 @@ void windowSetLineWrap(Window *w, int line_wrap)
  */
 void windowAutoResize(Window *w)
 {
-  if (w->auto_width)
-  {
-    int longest;
-    longest = _windowCalculateLongestLine(w);
-    _windowAutoWidth(w, longest);
-  }
-
-  if (w->auto_height)
-  {
-    _windowLinesWrap(w);
-    _windowAutoHeight(w);
-  }
+  _windowLayout(w);
 }
 
 /**
@@ -1479,13 +2805,28 @@ int windowGetLines(Window *w)
  */
 int windowAddLine(Window *w, char *line)
 {
-  if (w->lines > MAX_LINES)
+  return windowAddLineLen(w, line, _stringLength(line), -1);
+}
+
+/**
+ * @brief Adds a line of text to the window, given its length. The line needs no terminator,
+ * so that it can be copied straight from a larger buffer, whatever its length.
+ * A known width spares measuring the line when the window is laid out.
+ * 
+ * @param w pointer to window
+ * @param line line to add
+ * @param len length of the line, in bytes
+ * @param width width of the line in columns, -1 to measure it when needed
+ * @return int -1 in case of error, otherwise length of the line
+ */
+int windowAddLineLen(Window *w, char *line, int len, int width)
+{
+  if (len < 0 || _windowArenaSplice(w, w->arena_len, 0, line, len, width) == -1)
     return -1;
 
-  _stringCopy(w->text_buffer[w->lines], line);
   w->lines++;
 
-  return sizeof(w->text_buffer[w->lines - 1]);
+  return len;
 }
 
 /**
@@ -1498,12 +2839,16 @@ int windowAddLine(Window *w, char *line)
  */
 int windowChangeLine(Window *w, char *line, int line_count)
 {
-  if (line_count > w->lines)
+  if (line_count < 0 || line_count >= w->lines)
     return -1;
 
-  _stringCopy(w->text_buffer[line_count], line);
+  const int offset = _windowLineOffset(w, line_count);
+  const int len = _stringLength(line);
+
+  if (_windowArenaSplice(w, offset, _line_prefix + _windowLineLength(w, offset), line, len, -1) == -1)
+    return -1;
 
-  return sizeof(w->text_buffer[line_count]);
+  return len;
 }
 
 /**
@@ -1515,14 +2860,13 @@ int windowChangeLine(Window *w, char *line, int line_count)
  */
 int windowDeleteLine(Window *w, int line_index)
 {
-  if (line_index >= w->lines)
+  if (line_index < 0 || line_index >= w->lines)
     return -1;
 
+  const int offset = _windowLineOffset(w, line_index);
+  _windowArenaSplice(w, offset, _line_prefix + _windowLineLength(w, offset), NULL, 0, -1);
   w->lines--;
 
-  for (int i = line_index; i < w->lines; i++)
-    _stringCopy(w->text_buffer[i], w->text_buffer[i + 1]);
-
   return w->lines;
 }
 
@@ -1534,12 +2878,13 @@ int windowDeleteLine(Window *w, int line_index)
  */
 int windowDeleteAllLines(Window *w)
 {
-  w->lines = 0;
+  _windowClearUnbuffered(w);
   return 0;
 }
 
 /**
- * @brief Shows a window on the terminal.
+ * @brief Draws a window into the frame.
+ * The terminal is updated on the next frame_flush().
  * 
  * @param w pointer to window
  */
@@ -1549,71 +2894,34 @@ void windowShow(Window *w)
   if (!w->visible)
     return;
 
-  int longest;
-  // calculate longest line
-  longest = _windowCalculateLongestLine(w);
-  // auto resize window
-  if (w->auto_width)
-    _windowAutoWidth(w, longest);
-  if (w->auto_height)
-    _windowAutoHeight(w);
-
-  // check if lines need to be wrapped
-  const int width = w->size.width - 2 * w->padding;
-  if (longest >= width && w->line_wrap)
-  {
-    // windows are auto resized if needed
-    _windowLinesWrap(w);
-    // re calculate longest line
-    longest = _windowCalculateLongestLine(w);
-  }
-  else
-  {
-    // simply copy the buffer onto the screen
-    _windowLinesUnbuffer(w);
-  }
-
-  // set styles
-  set_fg(w->fg_color);
-  set_bg(w->bg_color);
+  // wrap the lines, if the text or the size have changed
+  _windowLayout(w);
 
   // draw outer border
   _windowDrawBorder(w);
 
-  // set text style
-  // prevent complete reset
-  if (w->text_style != text_DEFAUlT)
-    set_textmode(w->text_style);
-
-  for (int i = 0; i < w->lines; i++)
+  for (int i = 0; i < w->wrapped_lines; i++)
   {
-    // calculate line length
-    const int ll = _stringLength(w->text[i]);
+    const Span line = w->wrapped[i];
     // calculate spacing according to alignment
-    int spacing = _windowCalculateSpacing(w, ll);
+    int spacing = _windowCalculateSpacing(w, line.width);
     // calculate line coordinates
     const int lx = w->position.x + w->padding + spacing + 1;
     const int ly = w->position.y + i + 1;
     // draw text
-    move_cursor_to(lx, ly);
-    printf("%s", w->text[i]);
-    fflush(NULL);
+    _framePutString(lx, ly, w->arena + line.start, line.len, w->fg_color, w->bg_color, w->text_style);
   }
-
-  reset_styles();
-  move_cursor_to(0, 0);
 }
 
 /**
- * @brief Clears a window from terminal.
+ * @brief Clears a window from the frame.
  * 
  * @param w pointer to window
  */
 void windowClear(Window *w)
 {
-  reset_bg();
   for (int y = -1; y < w->size.height + 1; y++)
-    erase_at(w->position.x, y + w->position.y, w->size.width);
+    _frameErase(w->position.x, y + w->position.y, w->size.width);
 }
 
 /**
@@ -1832,30 +3140,456 @@ void dialogSetText(Dialog *d, char *text, int v_padding)
   return;
 }
 
-/* Polls a response for for the dialog. Needs raw mode. */
 /**
- * @brief Polls a response for the dialog. Needs to be in dialog mode
+ * @brief Handles an input event while the dialog is shown, moving the selection between the buttons.
+ * The dialog is not drawn, so that it can be answered while the timer keeps running.
  * 
  * @param d pointer to dialog
- * @return int returns the id of the pressed button
+ * @param event one of the event_ values, as returned by poll_event()
+ * @param key pressed key, for event_KEY
+ * @return int id of the chosen button if enter was pressed, -1 otherwise
  */
-int dialogWaitResponse(Dialog *d)
+int dialogHandleEvent(Dialog *d, int event, char key)
 {
-  while (1)
+  if (event == event_RIGHT)
+    d->active_button = 1;
+  else if (event == event_LEFT)
+    d->active_button = 0;
+  else if (event == event_KEY && key == '\t')
+    d->active_button = !d->active_button;
+  else if (event == event_KEY && (key == '\n' || key == '\r'))
+    return d->active_button;
+
+  return -1;
+}
+
+/**
+ * @brief Creates a progress bar, empty and visible.
+ * 
+ * @param x x coordinate of the leftmost cell
+ * @param y y coordinate of the bar
+ * @return Bar* 
+ */
+Bar *createBar(int x, int y)
+{
+  Bar *b = malloc(sizeof(Bar));
+  if (b == NULL)
+    return NULL;
+
+  *b = (Bar){
+      .visible = 1,
+      .width = 10,
+      .eighths = 0,
+      .ramp = NULL,
+      .ramp_len = 0,
+      .fg_color = fg_DEFAULT,
+      .bg_color = bg_DEFAULT,
+      .position = createPosition(x, y),
+  };
+
+  return b;
+}
+
+/**
+ * @brief Deletes a progress bar. Its ramp is not deleted.
+ * 
+ * @param b pointer to bar
+ */
+void deleteBar(Bar *b)
+{
+  free(b);
+}
+
+/**
+ * @brief Sets the position of a progress bar.
+ * 
+ * @param b pointer to bar
+ * @param x x coordinate of the leftmost cell
+ * @param y y coordinate of the bar
+ */
+void barSetPosition(Bar *b, int x, int y)
+{
+  b->position = createPosition(x, y);
+}
+
+/**
+ * @brief Sets the width of a progress bar, keeping its progress.
+ * 
+ * @param b pointer to bar
+ * @param width width, in cells
+ */
+void barSetWidth(Bar *b, int width)
+{
+  if (width < 1)
+    return;
+
+  b->eighths = b->eighths * width / b->width;
+  b->width = width;
+}
+
+/**
+ * @brief Sets progress bar visibility.
+ * 
+ * @param b pointer to bar
+ * @param visibility 1 for visible, 0 for hidden
+ */
+void barSetVisibility(Bar *b, int visibility)
+{
+  if (visibility != 0 && visibility != 1)
+    return;
+
+  b->visible = visibility;
+}
+
+/**
+ * @brief Sets the filled part of a progress bar.
+ * 
+ * @param b pointer to bar
+ * @param progress filled part, in range [0-1]
+ */
+void barSetProgress(Bar *b, double progress)
+{
+  b->eighths = _clamp(progress, 0, 1) * b->width * 8;
+}
+
+/**
+ * @brief Sets the colors of the filled part of a progress bar.
+ * The first color goes to the leftmost cell, the last one to the rightmost.
+ * 
+ * @param b pointer to bar
+ * @param ramp array of styles, as made by createRamp(). NULL to use the text color
+ * @param len number of styles
+ */
+void barSetRamp(Bar *b, style *ramp, int len)
+{
+  b->ramp = ramp;
+  b->ramp_len = ramp != NULL ? len : 0;
+}
+
+/**
+ * @brief Sets progress bar text color, used for the empty part.
+ * 
+ * @param b pointer to bar
+ * @param fg_color text style color
+ */
+void barSetFGcolor(Bar *b, style fg_color)
+{
+  b->fg_color = fg_color;
+}
+
+/**
+ * @brief Sets progress bar background color.
+ * 
+ * @param b pointer to bar
+ * @param bg_color background style color
+ */
+void barSetBGcolor(Bar *b, style bg_color)
+{
+  b->bg_color = bg_color;
+}
+
+/**
+ * @brief Draws a progress bar into the frame.
+ * Colors are looked up in the ramp, and the flush writes only the cells
+ * whose fill level or color changed.
+ * 
+ * @param b pointer to bar
+ */
+void barShow(Bar *b)
+{
+  const int full = b->eighths / 8;
+
+  if (!b->visible)
+    return;
+
+  for (int i = 0; i < b->width; i++)
+  {
+    style fg_color = b->fg_color;
+    char *glyph = "─";
+
+    if (i < full || (i == full && b->eighths % 8 > 0))
+    {
+      // filled cell, colored by its position
+      if (b->ramp_len > 0)
+        fg_color = b->ramp[b->width > 1 ? i * (b->ramp_len - 1) / (b->width - 1) : 0];
+      glyph = _bar_blocks[i < full ? 8 : b->eighths % 8];
+    }
+
+    _framePutCell(b->position.x + i, b->position.y, glyph, fg_color, b->bg_color, text_DEFAUlT);
+  }
+}
+
+/**
+ * @internal
+ * @brief Appends a node to the children of a row or a column.
+ * 
+ * @param l pointer to the parent
+ * @param child pointer to the node to append
+ * @return Layout* the appended node, NULL in case of error (the node is deleted)
+ */
+Layout *_layoutAppend(Layout *l, Layout *child)
+{
+  Layout **children;
+
+  if (child == NULL)
+    return NULL;
+
+  if (l->kind != layout_ROW && l->kind != layout_COLUMN)
+  {
+    deleteLayout(child);
+    return NULL;
+  }
+
+  children = realloc(l->children, sizeof(Layout *) * (l->children_count + 1));
+  if (children == NULL)
+  {
+    deleteLayout(child);
+    return NULL;
+  }
+
+  l->children = children;
+  l->children[l->children_count++] = child;
+  return child;
+}
+
+/**
+ * @internal
+ * @brief Checks whether a measured node takes no space.
+ * 
+ * @param l pointer to the node
+ * @return int 1 if the node is empty, 0 otherwise
+ */
+int _layoutEmpty(Layout *l)
+{
+  return l->size.width == 0 && l->size.height == 0;
+}
+
+/**
+ * @internal
+ * @brief Measures a node and all its children, bottom up.
+ * The children of a column are measured first, then the stretched ones get its width.
+ * Window text is wrapped only if its size or content changed since the last time.
+ * 
+ * @param l pointer to the node
+ * @param width width imposed by the parent column, -1 if the node is not stretched
+ * @return int 1 if the size of the node or of any of its children changed, 0 otherwise
+ */
+int _layoutMeasure(Layout *l, int width)
+{
+  Rectangle size = createRectangle(0, 0);
+  int changed = 0, count = 0;
+
+  if (l->kind == layout_WINDOW && l->window->visible)
+  {
+    if (width != -1)
+      windowSetWidth(l->window, width);
+
+    _windowLayout(l->window);
+    size = l->window->size;
+  }
+  else if (l->kind == layout_BAR && l->bar->visible)
+  {
+    if (width != -1)
+      barSetWidth(l->bar, width);
+
+    size = createRectangle(l->bar->width, 1);
+  }
+  else if (l->kind == layout_ROW)
+  {
+    for (int i = 0; i < l->children_count; i++)
+    {
+      Layout *child = l->children[i];
+      changed |= _layoutMeasure(child, -1);
+
+      if (_layoutEmpty(child))
+        continue;
+
+      size.width += child->size.width + (count++ > 0 ? l->gap : 0);
+      if (child->size.height > size.height)
+        size.height = child->size.height;
+    }
+  }
+  else if (l->kind == layout_COLUMN)
+  {
+    // the width of the column is set by the children that are not stretched
+    for (int i = 0; i < l->children_count; i++)
+    {
+      Layout *child = l->children[i];
+      if (child->stretch)
+        continue;
+
+      changed |= _layoutMeasure(child, -1);
+      if (child->size.width > size.width)
+        size.width = child->size.width;
+    }
+
+    for (int i = 0; i < l->children_count; i++)
+    {
+      Layout *child = l->children[i];
+      if (child->stretch)
+        changed |= _layoutMeasure(child, size.width);
+
+      if (!_layoutEmpty(child))
+        size.height += child->size.height + (count++ > 0 ? l->gap : 0);
+    }
+  }
+
+  changed |= size.width != l->size.width || size.height != l->size.height;
+  l->size = size;
+  return changed;
+}
+
+/**
+ * @internal
+ * @brief Places a measured node and all its children, top down.
+ * 
+ * @param l pointer to the node
+ * @param x x coordinate of the top left corner
+ * @param y y coordinate of the top left corner
+ */
+void _layoutPlace(Layout *l, int x, int y)
+{
+  l->position = createPosition(x, y);
+
+  if (l->kind == layout_WINDOW)
+    windowSetPosition(l->window, x, y);
+  else if (l->kind == layout_BAR)
+    barSetPosition(l->bar, x, y);
+
+  for (int i = 0; i < l->children_count; i++)
   {
+    Layout *child = l->children[i];
+    if (_layoutEmpty(child))
+      continue;
+
+    _layoutPlace(child, x, y);
+
+    if (l->kind == layout_ROW)
+      x += child->size.width + l->gap;
+    else
+      y += child->size.height + l->gap;
+  }
+}
 
-    int special = poll_special_keypress();
+/**
+ * @brief Creates an empty row or column, the root of a layout tree.
+ * 
+ * @param kind layout_ROW or layout_COLUMN
+ * @param gap cells between two children
+ * @return Layout* 
+ */
+Layout *createLayout(int kind, int gap)
+{
+  Layout *l = malloc(sizeof(Layout));
+  if (l == NULL)
+    return NULL;
+
+  *l = (Layout){
+      .kind = kind,
+      .gap = gap,
+      .stretch = 0,
+      .window = NULL,
+      .bar = NULL,
+      .children = NULL,
+      .children_count = 0,
+      // never solved
+      .size = createRectangle(-1, -1),
+      .position = createPosition(0, 0),
+      .terminal = createRectangle(-1, -1),
+  };
+
+  return l;
+}
 
-    if (special & 0b00000100) // left
-      d->active_button = 1;
-    else if (special & 0b00001000) // right
-      d->active_button = 0;
-    else if (special & 0b00010000) // tab
-      d->active_button = !d->active_button;
-    else if (special & 0b00100000) // enter
-      return d->active_button;
+/**
+ * @brief Deletes a layout tree, freeing the memory. Windows and bars are not deleted.
+ * 
+ * @param l pointer to the root of the tree
+ */
+void deleteLayout(Layout *l)
+{
+  if (l)
+  {
+    for (int i = 0; i < l->children_count; i++)
+      deleteLayout(l->children[i]);
 
-    if (special)
-      dialogShow(d);
+    free(l->children);
+    free(l);
   }
-}
\ No newline at end of file
+  return;
+}
+
+/**
+ * @brief Adds an empty row or column to a row or a column.
+ * 
+ * @param l pointer to the parent
+ * @param kind layout_ROW or layout_COLUMN
+ * @param gap cells between two children
+ * @return Layout* the new node, NULL in case of error
+ */
+Layout *layoutAddLayout(Layout *l, int kind, int gap)
+{
+  return _layoutAppend(l, createLayout(kind, gap));
+}
+
+/**
+ * @brief Adds a window to a row or a column.
+ * Stretched windows take the width of their column, and their height follows their text.
+ * 
+ * @param l pointer to the parent
+ * @param w pointer to the window
+ * @param stretch 1 to take the whole width of the parent column, 0 to keep the window width
+ * @return int -1 in case of error, 0 otherwise
+ */
+int layoutAddWindow(Layout *l, Window *w, int stretch)
+{
+  Layout *leaf = createLayout(layout_WINDOW, 0);
+  if (leaf == NULL)
+    return -1;
+
+  leaf->window = w;
+  leaf->stretch = stretch;
+  return _layoutAppend(l, leaf) != NULL ? 0 : -1;
+}
+
+/**
+ * @brief Adds a progress bar to a row or a column.
+ * 
+ * @param l pointer to the parent
+ * @param b pointer to the bar
+ * @param stretch 1 to take the whole width of the parent column, 0 to keep the bar width
+ * @return int -1 in case of error, 0 otherwise
+ */
+int layoutAddBar(Layout *l, Bar *b, int stretch)
+{
+  Layout *leaf = createLayout(layout_BAR, 0);
+  if (leaf == NULL)
+    return -1;
+
+  leaf->bar = b;
+  leaf->stretch = stretch;
+  return _layoutAppend(l, leaf) != NULL ? 0 : -1;
+}
+
+/**
+ * @brief Solves the geometry of a layout tree, centered horizontally in the terminal.
+ * Windows and bars are moved only if the size of the terminal or the size of one of them
+ * changed since the last time, otherwise the cached geometry is kept as it is.
+ * 
+ * @param l pointer to the root of the tree
+ * @param top y coordinate of the top of the tree
+ * @return int 1 if the windows have been moved or resized, 0 otherwise
+ */
+int layoutSolve(Layout *l, int top)
+{
+  const Rectangle terminal = get_terminal_size();
+  const int changed = _layoutMeasure(l, -1);
+
+  if (!changed && terminal.width == l->terminal.width &&
+      terminal.height == l->terminal.height && top == l->position.y)
+    return 0;
+
+  l->terminal = terminal;
+  _layoutPlace(l, (terminal.width - l->size.width) / 2, top);
+  return 1;
+}
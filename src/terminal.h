@@ -19,6 +19,10 @@
 #include <stdarg.h>    // for multiple parameters
 #include <string.h>    // for strcpy()
 #include <stdlib.h>    // for malloc() and free()
+#include <errno.h>     // for EINTR
+#include <poll.h>      // for poll()
+
+#include "utf8.h"
 
 typedef int style;
 
@@ -70,18 +74,39 @@ static const style text_HIDDEN = 8;
 static const style text_STRIKETHROUGH = 9;
 static const style text_DEFAUlT = 0;
 
+static const style style_RGB = 1 << 24; // flag of the truecolor styles, the color is in the lowest 24 bits
+static const style style_UNKNOWN = -1;  // style of the terminal before the first sequence
+
+static const int layout_ROW = 0;    // node placing its children side by side
+static const int layout_COLUMN = 1; // node stacking its children
+static const int layout_WINDOW = 2; // leaf holding a window
+static const int layout_BAR = 3;    // leaf holding a progress bar
+
+static const int event_NONE = 0;      // no input available
+static const int event_KEY = 1;       // key pressed
+static const int event_FOCUS_IN = 2;  // the terminal gained the focus
+static const int event_FOCUS_OUT = 3; // the terminal lost the focus
+static const int event_IGNORED = 4;   // escape sequence not handled
+static const int event_LEFT = 5;      // left arrow key pressed
+static const int event_RIGHT = 6;     // right arrow key pressed
+static const int event_TIMEOUT = 50;  // time left to the rest of an escape sequence to arrive, msec
+
 #define ESCAPE "\x1b"
 #define CLEARALL ESCAPE "[2J"
 #define RESET ESCAPE "[0M"
 #define MOVEHOME ESCAPE "[H"
 #define HIDECURSOR ESCAPE "[?25l"
 #define SHOWCURSOR ESCAPE "[?25h"
+#define FOCUSON ESCAPE "[?1004h"
+#define FOCUSOFF ESCAPE "[?1004l"
 #define BELL "\a"
-#define MAX_LINES 10
 #define MAX_WIDTH 250
 
 static const int DIALOG_MAX_WIDTH = 40;
 static const int DIALOG_MAX_HEIGHT = 10;
+static const int HUE_TABLE_SIZE = 360; // entries of the hue lookup table, one per degree
+static const int FRAME_FALLBACK_WIDTH = 80;  // frame width when the terminal size is not available
+static const int FRAME_FALLBACK_HEIGHT = 24; // frame height when the terminal size is not available
 
 /**
  * @brief Struct containing width and height.
@@ -130,26 +155,50 @@ typedef struct
   int L; /**< Lightness, range [0-99] */
 } HSL;
 
+/**
+ * @brief Struct containing a span of bytes of the text of a window.
+ * 
+ */
+typedef struct
+{
+  int start; /**<  offset of the first byte in the arena */
+  int len;   /**<  number of bytes */
+  int width; /**<  number of columns */
+} Span;
+
 /**
  * @brief Struct containing a window.
+ * Lines of text are stored one after the other in a growing arena, each one preceded by its length
+ * and by its width, measured once.
+ * Lines as displayed, after wrapping, are spans of the arena, so text is never copied.
+ * The layout is computed again only when the text or the size of the window changes.
  * 
  */
 typedef struct
 {
-  int auto_width;                         /**<  auto width resizing  */
-  int auto_height;                        /**<  auto height resizing  */
-  int padding;                            /**<  text padding in window */
-  int alignment;                          /**<  text alignment in window */
-  int line_wrap;                          /**<  sets line wrapping */
-  int visible;                            /**<  sets window visibility */
-  style fg_color;                         /**<  color for the window text */
-  style bg_color;                         /**<  color for the window background */
-  style text_style;                       /**<  style for the window text */
-  int lines;                              /**<  number of lines currently in the buffer */
-  char text_buffer[MAX_LINES][MAX_WIDTH]; /**<  buffer for text */
-  char text[MAX_LINES][MAX_WIDTH];        /**<  text as displayed on the window */
-  Rectangle size;                         /**<  size of the window */
-  Position position;                      /**<  position of the top left corner */
+  int auto_width;         /**<  auto width resizing  */
+  int auto_height;        /**<  auto height resizing  */
+  int padding;            /**<  text padding in window */
+  int alignment;          /**<  text alignment in window */
+  int line_wrap;          /**<  sets line wrapping */
+  int visible;            /**<  sets window visibility */
+  style fg_color;         /**<  color for the window text */
+  style bg_color;         /**<  color for the window background */
+  style text_style;       /**<  style for the window text */
+  int lines;              /**<  number of lines of text */
+  char *arena;            /**<  length and width prefixed lines of text */
+  int arena_len;          /**<  used bytes of the arena */
+  int arena_size;         /**<  allocated bytes of the arena */
+  Span *wrapped;          /**<  lines as displayed on the window */
+  int wrapped_lines;      /**<  number of displayed lines */
+  int wrapped_size;       /**<  allocated displayed lines */
+  int generation;         /**<  incremented on every change of the text */
+  int longest;            /**<  width of the longest line of text, in columns */
+  int longest_generation; /**<  generation of the text the longest line was computed for */
+  int layout_generation;  /**<  generation of the text the displayed lines were computed for, -1 if invalid */
+  Rectangle layout_size;  /**<  size of the window the displayed lines were computed for */
+  Rectangle size;         /**<  size of the window */
+  Position position;      /**<  position of the top left corner */
 } Window;
 
 /**
@@ -165,6 +214,104 @@ typedef struct
   Window *buttons[2]; /**<  buttons, stored as window */
 } Dialog;
 
+/**
+ * @brief Struct containing a progress bar, one cell high.
+ * Filled cells are colored along a ramp, the last one is partially filled with block characters.
+ * 
+ */
+typedef struct
+{
+  int visible;       /**<  is the bar visible? */
+  int width;         /**<  width of the bar, in cells */
+  int eighths;       /**<  filled part of the bar, in eighths of cell */
+  style *ramp;       /**<  colors of the filled part, from the first to the last cell. Not owned by the bar */
+  int ramp_len;      /**<  number of colors in the ramp */
+  style fg_color;    /**<  color of the empty part and, without a ramp, of the filled part */
+  style bg_color;    /**<  background color of the bar */
+  Position position; /**<  position of the leftmost cell */
+} Bar;
+
+/**
+ * @brief Struct containing a node of a layout tree.
+ * Rows and columns place their children, while leaves hold a window or a progress bar.
+ * Hidden leaves take no space. Geometry is solved by layoutSolve() and kept until
+ * the size of the terminal or the size of a leaf changes.
+ * 
+ */
+typedef struct layout
+{
+  int kind;                 /**<  one of the layout_ kinds */
+  int gap;                  /**<  cells between two children of a row or a column */
+  int stretch;              /**<  does the leaf take the whole width of its column? */
+  Window *window;           /**<  window of a layout_WINDOW leaf. Not owned by the layout */
+  Bar *bar;                 /**<  bar of a layout_BAR leaf. Not owned by the layout */
+  struct layout **children; /**<  children of a row or a column */
+  int children_count;       /**<  number of children */
+  Rectangle size;           /**<  solved size, empty if hidden */
+  Position position;        /**<  solved position of the top left corner */
+  Rectangle terminal;       /**<  size of the terminal when the tree was last solved, on the root only */
+} Layout;
+
+/**
+ * @brief Struct containing an output sink, where everything sent to the terminal is written.
+ * The sink in use is set with set_output(). By default, the output goes to stdout.
+ * 
+ */
+typedef struct output
+{
+  int (*write)(struct output *o, char *data, int len); /**<  writes the bytes, returns the number of write syscalls or -1 in case of error */
+  int fd;                                             /**<  file descriptor of a fd sink, -1 for the other sinks */
+  Rectangle size;                                     /**<  size of the screen, -1 if it has to be asked to the terminal */
+  char *recording;                                    /**<  bytes captured by a recording sink */
+  int recording_len;                                  /**<  number of captured bytes */
+  int recording_size;                                 /**<  allocated size of the recording */
+} Output;
+
+/**
+ * @brief Struct containing a single cell of the frame buffer.
+ * 
+ */
+typedef struct
+{
+  char glyph[5];    /**<  UTF-8 encoded character, NUL terminated. Empty for the right half of a wide character */
+  style fg_color;   /**<  text color of the cell */
+  style bg_color;   /**<  background color of the cell */
+  style text_style; /**<  text style of the cell */
+} Cell;
+
+/**
+ * @brief Struct containing the output statistics of a flushed frame.
+ * 
+ */
+typedef struct
+{
+  int bytes;  /**<  number of bytes emitted */
+  int writes; /**<  number of write syscalls */
+  int cells;  /**<  number of changed cells */
+} FrameStats;
+
+/**
+ * @brief Struct containing the off-screen frame buffer.
+ * All the windows and dialogs are drawn into it, then only the cells
+ * that differ from the previous frame are flushed to the terminal
+ * with a single write.
+ * 
+ */
+typedef struct
+{
+  int width;         /**<  width of the frame, in cells */
+  int height;        /**<  height of the frame, in cells */
+  int clear_pending; /**<  must the terminal be cleared before the next flush? */
+  Cell *cells;       /**<  cells of the frame being drawn, row by row */
+  Cell *screen;      /**<  cells currently shown on the terminal, row by row */
+  char *output;      /**<  bytes to be written to the terminal */
+  int output_len;    /**<  number of bytes currently in the output */
+  int output_size;   /**<  allocated size of the output */
+  int output_failed; /**<  has the output failed to grow since the last flush? Some bytes are then missing */
+  FrameStats stats;  /**<  statistics of the last flushed frame */
+  Cell pen;          /**<  styles currently set on the terminal, style_UNKNOWN if not known */
+} Frame;
+
 Rectangle createRectangle(int w, int h);
 Position createPosition(int x, int y);
 RGB createRGBcolor(int R, int G, int B);
@@ -173,11 +320,30 @@ HSL createHSLcolor(int H, int S, int L);
 RGB HSLtoRGB(HSL color);
 RGB HUEtoRGB(double hue);
 HSL RGBtoHSL(RGB color);
+style RGBtoStyle(RGB color);
+style HSLtoStyle(HSL color);
+RGB HUEtoRGBfast(int hue);
+style *createRamp(int from_hue, int to_hue, int len);
+void deleteRamp(style *ramp);
+
+Output *createFdOutput(int fd);
+Output *createNullOutput();
+Output *createRecordingOutput();
+void deleteOutput(Output *o);
+void outputSetSize(Output *o, int width, int height);
+char *outputGetRecording(Output *o, int *len);
+void outputClearRecording(Output *o);
+int outputReplay(Output *source, Output *destination);
+void set_output(Output *o);
+Output *get_output();
 
 Rectangle get_terminal_size();
 void clear_terminal();
+void repaint_terminal();
 void hide_cursor();
 void show_cursor();
+void enable_focus_events();
+void disable_focus_events();
 void move_cursor_to_bottom();
 void move_cursor_to(int x, int y);
 void enter_raw_mode();
@@ -198,9 +364,15 @@ void write_at(int x, int y, char *s);
 void erase_at(int x, int y, int length);
 char poll_keypress();
 char poll_special_keypress();
+int poll_event(char *key);
+int wait_input(int timeout_ms);
+char wait_keypress(int timeout_ms);
+char wait_special_keypress(int timeout_ms);
 int await_keypress(char *s);
 int await_enter(char *s);
 void terminal_beep();
+int frame_flush();
+FrameStats frame_get_stats();
 
 Window *createWindow(int x, int y);
 void deleteWindow(Window *w);
@@ -227,6 +399,7 @@ void windowSetBGcolor(Window *w, style bg_color);
 void windowSetTextStyle(Window *w, style textstyle);
 int windowGetLines(Window *w);
 int windowAddLine(Window *w, char *line);
+int windowAddLineLen(Window *w, char *line, int len, int width);
 int windowChangeLine(Window *w, char *line, int line_count);
 int windowDeleteLine(Window *w, int line_index);
 int windowDeleteAllLines(Window *w);
@@ -241,6 +414,24 @@ void dialogClear(Dialog *d);
 void dialogSetButtons(Dialog *d, char *yes, char *no);
 void dialogSetPadding(Dialog *d, int padding);
 void dialogSetText(Dialog *d, char *text, int v_padding);
-int dialogWaitResponse(Dialog *d);
+int dialogHandleEvent(Dialog *d, int event, char key);
+
+Bar *createBar(int x, int y);
+void deleteBar(Bar *b);
+void barSetPosition(Bar *b, int x, int y);
+void barSetWidth(Bar *b, int width);
+void barSetVisibility(Bar *b, int visibility);
+void barSetProgress(Bar *b, double progress);
+void barSetRamp(Bar *b, style *ramp, int len);
+void barSetFGcolor(Bar *b, style fg_color);
+void barSetBGcolor(Bar *b, style bg_color);
+void barShow(Bar *b);
+
+Layout *createLayout(int kind, int gap);
+void deleteLayout(Layout *l);
+Layout *layoutAddLayout(Layout *l, int kind, int gap);
+int layoutAddWindow(Layout *l, Window *w, int stretch);
+int layoutAddBar(Layout *l, Bar *b, int stretch);
+int layoutSolve(Layout *l, int top);
 
 #endif
@@ -0,0 +1,339 @@
+/** @file timers.c */
+
+#include "timers.h"
+
+// Definition of private functions, so that linter and compiler are happy
+
+void _timersSwap(Timers *t, int a, int b);
+void _timersUp(Timers *t, int position);
+void _timersDown(Timers *t, int position);
+void _timersRemove(Timers *t, int id);
+
+/**
+ * @internal
+ * @brief Swaps two deadlines of the heap, keeping the index up to date.
+ * 
+ * @param t pointer to timers
+ * @param a position of the first deadline
+ * @param b position of the second deadline
+ */
+void _timersSwap(Timers *t, int a, int b)
+{
+  const Deadline d = t->heap[a];
+
+  t->heap[a] = t->heap[b];
+  t->heap[b] = d;
+  t->index[t->heap[a].id] = a;
+  t->index[t->heap[b].id] = b;
+}
+
+/**
+ * @internal
+ * @brief Moves a deadline toward the root of the heap, until its parent is earlier.
+ * 
+ * @param t pointer to timers
+ * @param position position of the deadline
+ */
+void _timersUp(Timers *t, int position)
+{
+  while (position > 0)
+  {
+    const int parent = (position - 1) / 2;
+    if (t->heap[parent].deadline <= t->heap[position].deadline)
+      break;
+
+    _timersSwap(t, parent, position);
+    position = parent;
+  }
+}
+
+/**
+ * @internal
+ * @brief Moves a deadline toward the leaves of the heap, until its children are later.
+ * 
+ * @param t pointer to timers
+ * @param position position of the deadline
+ */
+void _timersDown(Timers *t, int position)
+{
+  while (1)
+  {
+    const int left = 2 * position + 1, right = left + 1;
+    int earliest = position;
+
+    if (left < t->count && t->heap[left].deadline < t->heap[earliest].deadline)
+      earliest = left;
+    if (right < t->count && t->heap[right].deadline < t->heap[earliest].deadline)
+      earliest = right;
+
+    if (earliest == position)
+      return;
+
+    _timersSwap(t, earliest, position);
+    position = earliest;
+  }
+}
+
+/**
+ * @internal
+ * @brief Removes the deadline of a timer from the heap, if scheduled.
+ * 
+ * @param t pointer to timers
+ * @param id id of the timer
+ */
+void _timersRemove(Timers *t, int id)
+{
+  const int position = t->index[id];
+
+  if (position == -1)
+    return;
+
+  // the last deadline takes its place
+  _timersSwap(t, position, --t->count);
+  t->index[id] = -1;
+
+  if (position < t->count)
+  {
+    const int moved = t->heap[position].id;
+    _timersUp(t, position);
+    _timersDown(t, t->index[moved]);
+  }
+}
+
+/**
+ * @brief Creates the timers, with no deadline and no countdown.
+ * 
+ * @return Timers*
+ */
+Timers *createTimers()
+{
+  Timers *t = malloc(sizeof(Timers));
+  if (t == NULL)
+    return NULL;
+
+  memset(t, 0, sizeof(Timers));
+  for (int i = 0; i < TIMERS_SIZE; i++)
+    t->index[i] = -1;
+
+  return t;
+}
+
+/**
+ * @brief Deletes the timers, freeing the memory.
+ * 
+ * @param t pointer to timers
+ */
+void deleteTimers(Timers *t)
+{
+  free(t);
+}
+
+/**
+ * @brief Schedules the deadline of a timer, replacing the previous one.
+ * 
+ * @param t pointer to timers
+ * @param id id of the timer
+ * @param deadline monotonic milliseconds, 0 to unschedule the timer
+ */
+void timersSchedule(Timers *t, int id, unsigned long long deadline)
+{
+  if (id < 0 || id >= TIMERS_SIZE)
+    return;
+
+  if (deadline == 0)
+  {
+    _timersRemove(t, id);
+    return;
+  }
+
+  if (t->index[id] == -1)
+  {
+    // new deadline, appended as a leaf
+    t->heap[t->count] = (Deadline){.deadline = deadline, .id = id};
+    t->index[id] = t->count++;
+    _timersUp(t, t->index[id]);
+    return;
+  }
+
+  // moved deadline, either earlier or later
+  t->heap[t->index[id]].deadline = deadline;
+  _timersUp(t, t->index[id]);
+  _timersDown(t, t->index[id]);
+}
+
+/**
+ * @brief Returns the earliest scheduled deadline.
+ * 
+ * @param t pointer to timers
+ * @return unsigned long long monotonic milliseconds, 0 if nothing is scheduled
+ */
+unsigned long long timersNext(Timers *t)
+{
+  return t->count > 0 ? t->heap[0].deadline : 0;
+}
+
+/**
+ * @brief Removes the earliest deadline, if it has passed.
+ * An ended countdown is freed, so that its name can be started again.
+ * 
+ * @param t pointer to timers
+ * @param now monotonic milliseconds
+ * @return int id of the ended timer, -1 if none has ended
+ */
+int timersPop(Timers *t, unsigned long long now)
+{
+  int id;
+
+  if (t->count == 0 || t->heap[0].deadline > now)
+    return -1;
+
+  id = t->heap[0].id;
+  _timersRemove(t, id);
+
+  if (id != TIMERS_PHASE)
+    t->countdowns[id].active = 0;
+
+  return id;
+}
+
+/**
+ * @brief Starts a countdown. A countdown with the same name is restarted.
+ * 
+ * @param t pointer to timers
+ * @param name name of the countdown, truncated to TIMERS_NAME_SIZE
+ * @param seconds duration of the countdown
+ * @param now monotonic milliseconds
+ * @return int id of the countdown, -1 if there is no room for it
+ */
+int timersStart(Timers *t, const char *name, int seconds, unsigned long long now)
+{
+  int id = timersFind(t, name);
+
+  if (seconds <= 0)
+    return -1;
+
+  // first free slot
+  for (int i = TIMERS_PHASE + 1; id == -1 && i < TIMERS_SIZE; i++)
+    if (!t->countdowns[i].active)
+      id = i;
+
+  if (id == -1)
+    return -1;
+
+  t->countdowns[id] = (Countdown){
+      .active = 1,
+      .duration = seconds,
+      .deadline = now + (unsigned long long)seconds * 1000,
+      .left = 0,
+  };
+  strncpy(t->countdowns[id].name, name, TIMERS_NAME_SIZE - 1);
+
+  timersSchedule(t, id, t->countdowns[id].deadline);
+  return id;
+}
+
+/**
+ * @brief Finds a countdown by name.
+ * 
+ * @param t pointer to timers
+ * @param name name of the countdown
+ * @return int id of the countdown, -1 if not found
+ */
+int timersFind(Timers *t, const char *name)
+{
+  for (int i = TIMERS_PHASE + 1; i < TIMERS_SIZE; i++)
+    if (t->countdowns[i].active && strncmp(t->countdowns[i].name, name, TIMERS_NAME_SIZE - 1) == 0)
+      return i;
+
+  return -1;
+}
+
+/**
+ * @brief Cancels a countdown.
+ * 
+ * @param t pointer to timers
+ * @param id id of the countdown
+ * @return int -1 if the countdown is not active, 0 otherwise
+ */
+int timersCancel(Timers *t, int id)
+{
+  if (id <= TIMERS_PHASE || id >= TIMERS_SIZE || !t->countdowns[id].active)
+    return -1;
+
+  _timersRemove(t, id);
+  t->countdowns[id].active = 0;
+  return 0;
+}
+
+/**
+ * @brief Pauses a running countdown, or resumes a paused one.
+ * 
+ * @param t pointer to timers
+ * @param id id of the countdown
+ * @param now monotonic milliseconds
+ * @return int -1 if the countdown is not active, 1 if it has been paused, 0 if it has been resumed
+ */
+int timersToggle(Timers *t, int id, unsigned long long now)
+{
+  Countdown *c;
+
+  if (id <= TIMERS_PHASE || id >= TIMERS_SIZE || !t->countdowns[id].active)
+    return -1;
+
+  c = t->countdowns + id;
+  if (c->deadline != 0)
+  {
+    // stop the time, an ended countdown is about to be popped anyway
+    c->left = c->deadline > now ? c->deadline - now : 0;
+    c->deadline = 0;
+  }
+  else
+  {
+    c->deadline = now + c->left;
+  }
+
+  timersSchedule(t, id, c->deadline);
+  return c->deadline == 0;
+}
+
+/**
+ * @brief Returns the time left in a countdown, rounded up.
+ * 
+ * @param t pointer to timers
+ * @param id id of the countdown
+ * @param now monotonic milliseconds
+ * @return int seconds, -1 if the countdown is not active
+ */
+int timersRemaining(Timers *t, int id, unsigned long long now)
+{
+  const Countdown *c;
+  unsigned long long left;
+
+  if (id <= TIMERS_PHASE || id >= TIMERS_SIZE || !t->countdowns[id].active)
+    return -1;
+
+  c = t->countdowns + id;
+
+  if (c->deadline == 0)
+    left = c->left;
+  else
+    left = c->deadline > now ? c->deadline - now : 0;
+
+  return (left + 999) / 1000;
+}
+
+/**
+ * @brief Returns the number of active countdowns.
+ * 
+ * @param t pointer to timers
+ * @return int
+ */
+int timersCount(Timers *t)
+{
+  int count = 0;
+
+  for (int i = TIMERS_PHASE + 1; i < TIMERS_SIZE; i++)
+    count += t->countdowns[i].active;
+
+  return count;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file timers.h
+ * @brief Deadlines of all the timers of the process, kept in a single min-heap.
+ * The end of the current phase has a reserved id, while the other ids belong to countdowns,
+ * independent timers started by name (a meeting, a call...) along with the pomodoro.
+ * The event loop sleeps until the earliest deadline, so each timer costs one wakeup
+ * when it ends and a logarithmic update when it's started, paused or cancelled.
+ */
+
+#ifndef _TIMERS
+#define _TIMERS
+
+#include <stdlib.h> // for malloc() and free()
+#include <string.h> // for strncpy() and strcmp()
+
+#define TIMERS_SIZE 32      // maximum number of deadlines, the phase included
+#define TIMERS_NAME_SIZE 32 // maximum size of the name of a countdown, including the terminator
+
+static const int TIMERS_PHASE = 0; // id of the end of the current phase
+
+/**
+ * @brief Struct containing a countdown.
+ * 
+ */
+typedef struct
+{
+  int active;                  /**<  is the countdown in use? */
+  char name[TIMERS_NAME_SIZE]; /**<  name of the countdown, unique */
+  int duration;                /**<  duration of the countdown, in seconds */
+  unsigned long long deadline; /**<  end of the countdown (monotonic milliseconds), 0 if paused */
+  unsigned long long left;     /**<  time left when the countdown was paused, in milliseconds */
+} Countdown;
+
+/**
+ * @brief Struct containing a scheduled deadline.
+ * 
+ */
+typedef struct
+{
+  unsigned long long deadline; /**<  monotonic milliseconds */
+  int id;                      /**<  id of the timer */
+} Deadline;
+
+/**
+ * @brief Struct containing the heap of the deadlines and the countdowns.
+ * 
+ */
+typedef struct
+{
+  Deadline heap[TIMERS_SIZE];        /**<  scheduled deadlines, the earliest first */
+  int count;                         /**<  number of scheduled deadlines */
+  int index[TIMERS_SIZE];            /**<  position of each id in the heap, -1 if not scheduled */
+  Countdown countdowns[TIMERS_SIZE]; /**<  countdowns by id, the one of TIMERS_PHASE is never used */
+} Timers;
+
+Timers *createTimers();
+void deleteTimers(Timers *t);
+void timersSchedule(Timers *t, int id, unsigned long long deadline);
+unsigned long long timersNext(Timers *t);
+int timersPop(Timers *t, unsigned long long now);
+int timersStart(Timers *t, const char *name, int seconds, unsigned long long now);
+int timersFind(Timers *t, const char *name);
+int timersCancel(Timers *t, int id);
+int timersToggle(Timers *t, int id, unsigned long long now);
+int timersRemaining(Timers *t, int id, unsigned long long now);
+int timersCount(Timers *t);
+
+#endif
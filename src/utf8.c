@@ -0,0 +1,256 @@
+/** @file utf8.c */
+
+#define _GNU_SOURCE // for memrchr()
+
+#include "utf8.h"
+#include "widths.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h> // for _mm256_movemask_epi8()
+#elif defined(__SSE2__)
+#include <emmintrin.h> // for _mm_movemask_epi8()
+#endif
+
+// Definition of private functions, so that linter and compiler are happy
+
+int _utf8InRanges(const unsigned int ranges[][2], int count, unsigned int codepoint);
+
+/**
+ * @internal
+ * @brief Looks for a code point in a sorted table of ranges, with a binary search.
+ * 
+ * @param ranges table of inclusive ranges
+ * @param count number of ranges
+ * @param codepoint code point to look for
+ * @return int 1 if the code point is in one of the ranges, 0 otherwise
+ */
+int _utf8InRanges(const unsigned int ranges[][2], int count, unsigned int codepoint)
+{
+  int low = 0, high = count - 1;
+
+  if (count == 0 || codepoint < ranges[0][0] || codepoint > ranges[count - 1][1])
+    return 0;
+
+  while (low <= high)
+  {
+    const int mid = (low + high) / 2;
+
+    if (codepoint < ranges[mid][0])
+      high = mid - 1;
+    else if (codepoint > ranges[mid][1])
+      low = mid + 1;
+    else
+      return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Returns the length (in bytes) of an UTF-8 character, given its first byte.
+ * Invalid leading bytes are considered 1 byte long.
+ * 
+ * @param c first byte of the character
+ * @return int length of the character
+ */
+int utf8CharLength(char c)
+{
+  const unsigned char u = c;
+
+  if (u >= 0xF0 && u <= 0xF7)
+    return 4;
+  if (u >= 0xE0 && u <= 0xEF)
+    return 3;
+  if (u >= 0xC0 && u <= 0xDF)
+    return 2;
+
+  return 1;
+}
+
+/**
+ * @brief Decodes the first character of a string.
+ * Invalid or truncated sequences decode to the replacement character, consuming a single byte.
+ * 
+ * @param s string
+ * @param len length of the string, in bytes, at least 1
+ * @param codepoint pointer to the decoded code point
+ * @return int number of consumed bytes
+ */
+int utf8Decode(const char *s, int len, unsigned int *codepoint)
+{
+  const unsigned char *u = (const unsigned char *)s;
+  const int n = utf8CharLength(s[0]);
+  unsigned int cp;
+
+  if (u[0] < 0x80)
+  {
+    *codepoint = u[0];
+    return 1;
+  }
+
+  if (n == 1 || n > len)
+  {
+    *codepoint = UTF8_REPLACEMENT;
+    return 1;
+  }
+
+  cp = u[0] & (0x7F >> n);
+  for (int i = 1; i < n; i++)
+  {
+    // continuation bytes are 10xxxxxx
+    if ((u[i] & 0xC0) != 0x80)
+    {
+      *codepoint = UTF8_REPLACEMENT;
+      return 1;
+    }
+    cp = (cp << 6) | (u[i] & 0x3F);
+  }
+
+  *codepoint = cp;
+  return n;
+}
+
+/**
+ * @brief Returns the number of columns a code point takes in the terminal.
+ * 
+ * @param codepoint code point
+ * @return int 0 for combining and format characters, 2 for wide characters, 1 otherwise
+ */
+int utf8CodepointWidth(unsigned int codepoint)
+{
+  // ASCII and Latin-1 letters, no lookup
+  if (codepoint < 0x300)
+    return 1;
+
+  // most pages of the BMP share a single width
+  if (codepoint < 0x10000 && WIDTHS_PAGES[codepoint >> 8] != WIDTHS_PAGE_MIXED)
+    return WIDTHS_PAGES[codepoint >> 8];
+
+  if (_utf8InRanges(WIDTHS_ZERO, WIDTHS_ZERO_COUNT, codepoint))
+    return 0;
+
+  if (_utf8InRanges(WIDTHS_WIDE, WIDTHS_WIDE_COUNT, codepoint))
+    return 2;
+
+  return 1;
+}
+
+/**
+ * @brief Returns the number of leading ASCII bytes of a string.
+ * Bytes are checked 32 or 16 at a time when SIMD is available, 8 at a time otherwise.
+ * 
+ * @param s string
+ * @param len length of the string, in bytes
+ * @return int number of ASCII bytes before the first non ASCII one
+ */
+int utf8AsciiPrefix(const char *s, int len)
+{
+  int i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 32 <= len; i += 32)
+  {
+    const unsigned int mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(s + i)));
+    if (mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+#elif defined(__SSE2__)
+  for (; i + 16 <= len; i += 16)
+  {
+    const unsigned int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+    if (mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+
+  for (; i + 8 <= len; i += 8)
+  {
+    uint64_t word;
+    memcpy(&word, s + i, sizeof(word));
+    if (word & 0x8080808080808080ULL)
+      break;
+  }
+
+  while (i < len && (unsigned char)s[i] < 0x80)
+    i++;
+
+  return i;
+}
+
+/**
+ * @brief Returns the number of columns a string takes in the terminal.
+ * 
+ * @param s string
+ * @param len length of the string, in bytes
+ * @return int width of the string, in columns
+ */
+int utf8Width(const char *s, int len)
+{
+  int width;
+
+  utf8Fit(s, len, -1, &width);
+  return width;
+}
+
+/**
+ * @brief Returns the longest prefix of a string that fits in a number of columns,
+ * without splitting characters. Zero width characters following the prefix are included.
+ * 
+ * @param s string
+ * @param len length of the string, in bytes
+ * @param columns available columns, -1 for no limit
+ * @param width pointer to the width of the prefix, in columns. Can be NULL
+ * @return int length of the prefix, in bytes
+ */
+int utf8Fit(const char *s, int len, int columns, int *width)
+{
+  int i = 0, w = 0;
+
+  while (i < len)
+  {
+    // a run of ASCII, one column per byte
+    int ascii = utf8AsciiPrefix(s + i, len - i);
+    if (columns != -1 && ascii > columns - w)
+      ascii = columns - w;
+
+    i += ascii;
+    w += ascii;
+
+    if (i >= len || (columns != -1 && w >= columns && (unsigned char)s[i] < 0x80))
+      break;
+
+    unsigned int codepoint;
+    const int n = utf8Decode(s + i, len - i, &codepoint);
+    const int cw = utf8CodepointWidth(codepoint);
+
+    if (columns != -1 && w + cw > columns)
+      break;
+
+    i += n;
+    w += cw;
+  }
+
+  if (width != NULL)
+    *width = w;
+
+  return i;
+}
+
+/**
+ * @brief Finds the last space in a range of a string.
+ * 
+ * @param s string
+ * @param start first byte of the range
+ * @param end last byte of the range, included
+ * @return int position of the last space, -1 if there are none
+ */
+int utf8LastSpace(const char *s, int start, int end)
+{
+  const char *space;
+
+  if (end < start)
+    return -1;
+
+  space = memrchr(s + start, ' ', end - start + 1);
+  return space != NULL ? space - s : -1;
+}
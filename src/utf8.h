@@ -0,0 +1,24 @@
+/**
+ * @file utf8.h
+ * @brief UTF-8 strings measured in terminal columns.
+ * Display widths come from the tables in widths.h, generated by widths.py.
+ * ASCII text, by far the most common, is detected many bytes at a time and never looked up.
+ */
+
+#ifndef _UTF8
+#define _UTF8
+
+#include <string.h> // for memchr()
+#include <stdint.h> // for uint64_t
+
+static const unsigned int UTF8_REPLACEMENT = 0xFFFD; // code point of invalid sequences
+
+int utf8CharLength(char c);
+int utf8Decode(const char *s, int len, unsigned int *codepoint);
+int utf8CodepointWidth(unsigned int codepoint);
+int utf8AsciiPrefix(const char *s, int len);
+int utf8Width(const char *s, int len);
+int utf8Fit(const char *s, int len, int columns, int *width);
+int utf8LastSpace(const char *s, int start, int end);
+
+#endif
@@ -0,0 +1,130 @@
+import argparse
+import sys
+import unicodedata
+
+HEADER_PATH = "src/widths.h"
+PAGE_MIXED = 3
+
+
+def char_width(c):
+    # number of terminal columns needed to display a character
+    cp = ord(c)
+    if cp == 0x00AD:
+        # soft hyphen, displayed by most terminals
+        return 1
+    if 0x1160 <= cp <= 0x11FF or cp == 0x200B:
+        # hangul medial vowels and final consonants, zero width space
+        return 0
+    if unicodedata.category(c) in ("Mn", "Me", "Cf"):
+        return 0
+    if unicodedata.east_asian_width(c) in ("W", "F"):
+        return 2
+    return 1
+
+
+def display_width(s):
+    # number of terminal columns needed to display a string
+    return sum(char_width(c) for c in s)
+
+
+def ranges(width):
+    # merged ranges of the code points with a given width,
+    # unassigned code points between two ranges are merged too to keep the table small
+    result = []
+    gap = True
+    for cp in range(0x80, sys.maxunicode + 1):
+        c = chr(cp)
+        if unicodedata.category(c) == "Cn":
+            continue
+        if char_width(c) != width:
+            gap = True
+            continue
+        if result and not gap:
+            result[-1][1] = cp
+        else:
+            result.append([cp, cp])
+        gap = False
+    return result
+
+
+def lookup(zero, wide, cp):
+    # width of a code point according to the tables, as computed by src/utf8.c
+    if cp < 0x300:
+        return 1
+    for table, width in ((zero, 0), (wide, 2)):
+        if any(a <= cp <= b for a, b in table):
+            return width
+    return 1
+
+
+def pages(zero, wide):
+    # width shared by all the code points of each page of 256 of the BMP,
+    # PAGE_MIXED if they differ and the tables have to be searched
+    result = []
+    for page in range(0x100):
+        widths = {lookup(zero, wide, cp) for cp in range(page << 8, (page + 1) << 8)}
+        result.append(widths.pop() if len(widths) == 1 else PAGE_MIXED)
+    return result
+
+
+def format_pages(name, table):
+    lines = [f"static const unsigned char {name}[] = {{"]
+    for i in range(0, len(table), 32):
+        lines.append("    " + ", ".join(str(w) for w in table[i : i + 32]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def format_table(name, table):
+    lines = [f"static const unsigned int {name}[][2] = {{"]
+    for i in range(0, len(table), 4):
+        row = ", ".join(f"{{0x{a:05X}, 0x{b:05X}}}" for a, b in table[i : i + 4])
+        lines.append(f"    {row},")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generates the display width tables of src/utf8.c"
+    )
+    parser.parse_args()
+
+    zero = ranges(0)
+    wide = ranges(2)
+    bmp = pages(zero, wide)
+
+    with open(HEADER_PATH, "w") as f:
+        f.write(
+            f"""/**
+ * @file widths.h
+ * @brief Display width of the non ASCII code points, as ranges sorted by code point.
+ * Generated by widths.py from the Unicode {unicodedata.unidata_version} database, do not edit.
+ * Code points not listed are one column wide.
+ */
+
+#ifndef _WIDTHS
+#define _WIDTHS
+
+#define WIDTHS_ZERO_COUNT {len(zero):<4} // number of ranges of zero width code points
+#define WIDTHS_WIDE_COUNT {len(wide):<4} // number of ranges of two columns wide code points
+#define WIDTHS_PAGE_MIXED {PAGE_MIXED:<4} // page of code points with different widths
+
+// width of the code points of each page of 256 of the BMP, before searching the ranges
+{format_pages("WIDTHS_PAGES", bmp)}
+
+// zero width code points: combining marks, format characters
+{format_table("WIDTHS_ZERO", zero)}
+
+// two columns wide code points: East Asian wide and fullwidth
+{format_table("WIDTHS_WIDE", wide)}
+
+#endif
+"""
+        )
+
+    print(f"Written {len(zero)} zero width and {len(wide)} wide ranges to {HEADER_PATH}")
+
+
+if __name__ == "__main__":
+    main()